@@ -0,0 +1,255 @@
+/*
+ * Measures the latency, throughput and memory of the api layer
+ * (SeafileApiRequest and its subclasses) against a server, usually the
+ * stand-in server of tools/fake-seahub.
+ *
+ * usage: seafile-api-bench <server url> [request] [count] [concurrency] [token]
+ *
+ *   request      repos (default), starred, events, commit, avatar, login,
+ *                download-info
+ *   count        number of requests to send, default 100
+ *   concurrency  number of requests in flight, default 1
+ *
+ * Set SEAFILE_API_BENCH_INSECURE=1 to accept any tls certificate.
+ *
+ * Prints one line of "key=value" pairs, e.g.
+ *
+ *   api-bench request=repos count=100 concurrency=4 ok=100 failed=0
+ *     network_errors=0 ssl_errors=0 http_errors=0 elapsed_ms=... req_per_sec=...
+ *     p50_ms=... p99_ms=... max_ms=... rss_start_kb=... rss_peak_kb=... rss_end_kb=...
+ *     compressed_bytes=... decompressed_bytes=...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QSslConfiguration>
+#include <QSslSocket>
+#include <QStringList>
+#include <QUrl>
+
+#include "seafile-applet.h"
+#include "account.h"
+#include "api/api-client.h"
+#include "api/api-error.h"
+#include "api/requests.h"
+#include "utils/process.h"
+
+namespace {
+
+const char *kRequestKinds[] = {
+    "repos", "starred", "events", "commit", "avatar", "login", "download-info",
+};
+
+const char *kBenchRepoId = "00000000-0000-4000-8000-000000000000";
+
+qint64 percentile(const std::vector<qint64>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[(size_t)(p * (sorted.size() - 1))];
+}
+
+} // namespace
+
+
+class ApiBench : public QObject {
+    Q_OBJECT
+public:
+    ApiBench(const Account& account, const QString& kind, int count, int concurrency)
+        : account_(account),
+          kind_(kind),
+          count_(count),
+          concurrency_(concurrency),
+          sent_(0),
+          done_(0),
+          ok_(0),
+          network_errors_(0),
+          ssl_errors_(0),
+          http_errors_(0),
+          rss_start_(process_resident_memory()),
+          rss_peak_(rss_start_) {
+    }
+
+    void start() {
+        clock_.start();
+        for (int i = 0; i < concurrency_ && sent_ < count_; i++) {
+            sendOne();
+        }
+    }
+
+    void report() {
+        qint64 elapsed_us = clock_.nsecsElapsed() / 1000;
+        std::sort(latencies_us_.begin(), latencies_us_.end());
+
+        printf("api-bench request=%s count=%d concurrency=%d ok=%d failed=%d "
+               "network_errors=%d ssl_errors=%d http_errors=%d "
+               "elapsed_ms=%.1f req_per_sec=%.1f "
+               "p50_ms=%.2f p99_ms=%.2f max_ms=%.2f "
+               "rss_start_kb=%lld rss_peak_kb=%lld rss_end_kb=%lld "
+               "compressed_bytes=%llu decompressed_bytes=%llu\n",
+               kind_.toUtf8().data(), count_, concurrency_, ok_, done_ - ok_,
+               network_errors_, ssl_errors_, http_errors_,
+               elapsed_us / 1000.0, done_ / (elapsed_us / 1000000.0),
+               percentile(latencies_us_, 0.50) / 1000.0,
+               percentile(latencies_us_, 0.99) / 1000.0,
+               latencies_us_.empty() ? 0 : latencies_us_.back() / 1000.0,
+               rss_start_ / 1024, rss_peak_ / 1024,
+               process_resident_memory() / 1024,
+               (unsigned long long)SeafileApiClient::compressedBytesTotal(),
+               (unsigned long long)SeafileApiClient::decompressedBytesTotal());
+        fflush(stdout);
+    }
+
+private slots:
+    void onSuccess() {
+        ok_++;
+        finishOne();
+    }
+
+    void onFailed(const ApiError& error) {
+        switch (error.type()) {
+        case ApiError::NETWORK_ERROR:
+            network_errors_++;
+            break;
+        case ApiError::SSL_ERROR:
+            ssl_errors_++;
+            break;
+        case ApiError::HTTP_ERROR:
+            http_errors_++;
+            break;
+        }
+        finishOne();
+    }
+
+private:
+    void sendOne() {
+        SeafileApiRequest *req = createRequest();
+        if (kind_ == "login") {
+            connect(req, SIGNAL(success(const QString&)), this, SLOT(onSuccess()));
+        } else if (kind_ == "repos") {
+            connect(req, SIGNAL(success(const std::vector<ServerRepo>&)), this, SLOT(onSuccess()));
+        } else if (kind_ == "starred") {
+            connect(req, SIGNAL(success(const std::vector<StarredFile>&)), this, SLOT(onSuccess()));
+        } else if (kind_ == "events") {
+            connect(req, SIGNAL(success(const std::vector<SeafEvent>&, int)), this, SLOT(onSuccess()));
+        } else if (kind_ == "commit") {
+            connect(req, SIGNAL(success(const CommitDetails&)), this, SLOT(onSuccess()));
+        } else if (kind_ == "avatar") {
+            connect(req, SIGNAL(success(const QImage&)), this, SLOT(onSuccess()));
+        } else {
+            connect(req, SIGNAL(success(const RepoDownloadInfo&)), this, SLOT(onSuccess()));
+        }
+        connect(req, SIGNAL(failed(const ApiError&)), this, SLOT(onFailed(const ApiError&)));
+
+        QElapsedTimer timer;
+        timer.start();
+        timers_[req] = timer;
+        sent_++;
+        req->send();
+    }
+
+    SeafileApiRequest *createRequest() {
+        if (kind_ == "login") {
+            return new LoginRequest(account_.serverUrl, "bench@example.com", "bench", "api-bench");
+        } else if (kind_ == "repos") {
+            return new ListReposRequest(account_);
+        } else if (kind_ == "starred") {
+            return new GetStarredFilesRequest(account_);
+        } else if (kind_ == "events") {
+            return new GetEventsRequest(account_);
+        } else if (kind_ == "commit") {
+            return new GetCommitDetailsRequest(account_, kBenchRepoId,
+                                               "0123456789abcdef0123456789abcdef01234567");
+        } else if (kind_ == "avatar") {
+            // distinct users, like the avatars of a long events list
+            return new GetAvatarRequest(account_, QString("user%1@example.com").arg(sent_), 36);
+        }
+        return new DownloadRepoRequest(account_, kBenchRepoId);
+    }
+
+    void finishOne() {
+        QObject *req = sender();
+        if (timers_.contains(req)) {
+            latencies_us_.push_back(timers_.take(req).nsecsElapsed() / 1000);
+            req->deleteLater();
+        }
+
+        done_++;
+        rss_peak_ = qMax(rss_peak_, process_resident_memory());
+
+        if (sent_ < count_) {
+            sendOne();
+        } else if (done_ >= count_) {
+            report();
+            qApp->quit();
+        }
+    }
+
+    Account account_;
+    QString kind_;
+    int count_;
+    int concurrency_;
+
+    int sent_;
+    int done_;
+    int ok_;
+    int network_errors_;
+    int ssl_errors_;
+    int http_errors_;
+
+    QElapsedTimer clock_;
+    QHash<QObject *, QElapsedTimer> timers_;
+    std::vector<qint64> latencies_us_;
+
+    long long rss_start_;
+    long long rss_peak_;
+};
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv, false);
+
+    QStringList args = app.arguments();
+    QString kind = args.value(2, "repos");
+    int count = args.value(3, "100").toInt();
+    int concurrency = args.value(4, "1").toInt();
+    QString token = args.value(5, "0123456789abcdef0123456789abcdef01234567");
+
+    bool known_kind = false;
+    for (size_t i = 0; i < sizeof(kRequestKinds) / sizeof(kRequestKinds[0]); i++) {
+        known_kind = known_kind || kind == kRequestKinds[i];
+    }
+
+    QUrl server(args.value(1));
+    if (!server.isValid() || server.scheme().isEmpty() || !known_kind
+        || count <= 0 || concurrency <= 0) {
+        fprintf(stderr, "usage: %s <server url> [repos|starred|events|commit|avatar|login|download-info]"
+                " [count] [concurrency] [token]\n", argv[0]);
+        return 1;
+    }
+
+    if (qgetenv("SEAFILE_API_BENCH_INSECURE") == "1") {
+        QSslConfiguration conf = QSslConfiguration::defaultConfiguration();
+        conf.setPeerVerifyMode(QSslSocket::VerifyNone);
+        QSslConfiguration::setDefaultConfiguration(conf);
+    }
+
+    // Constructed but not started: no daemon. Untrusted certificates are
+    // rejected, as the applet does in headless mode.
+    seafApplet = new SeafileApplet(true);
+
+    ApiBench bench(Account(server, "bench@example.com", token), kind, count, concurrency);
+    bench.start();
+
+    return app.exec();
+}
+
+#include "api-bench.moc"
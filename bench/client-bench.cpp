@@ -0,0 +1,391 @@
+/*
+ * Benchmarks of the code paths of the applet which scale with the size of
+ * the account: parsing the api responses, rebuilding the libraries model and
+ * painting the libraries view.
+ *
+ * usage: seafile-client-bench [QTestLib options] [benchmark[:data tag]]
+ *
+ * The results are written in the QTestLib xml format to stdout, unless one
+ * of the -txt, -xml, -lightxml, -xunitxml or -o options is given, so that the
+ * results of two builds can be diffed, e.g.
+ *
+ *   seafile-client-bench > before.xml
+ *   seafile-client-bench -txt parseServerRepos:50k
+ *
+ * Painting needs a display. On a headless machine run it with xvfb-run.
+ */
+
+#include <jansson.h>
+
+#include <vector>
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStandardItem>
+#include <QStyleOptionViewItem>
+
+#include "seafile-applet.h"
+#include "api/server-repo.h"
+#include "api/event.h"
+#include "api/commit-details.h"
+#include "ui/repo-tree-model.h"
+#include "ui/repo-item.h"
+#include "ui/repo-item-delegate.h"
+#include "utils/file-utils.h"
+#include "utils/process.h"
+#include "utils/string-pool.h"
+#include "utils/translate-commit-desc.h"
+#include "utils/utils.h"
+
+namespace {
+
+const int kPaintWidth = 400;
+
+const char *kFileNames[] = {
+    "report.docx", "budget.xlsx", "slides.pptx", "paper.pdf", "notes.txt",
+    "photo.jpg", "scan.png", "song.mp3", "movie.mkv", "backup.tar.gz",
+    "main.cpp", "README", "index.html", "style.css", "data.json",
+};
+
+const char *kCommitDescs[] = {
+    "Added \"report.docx\".",
+    "Deleted \"old-notes.txt\" and 3 more files.",
+    "Modified \"budget.xlsx\".",
+    "Renamed \"a.txt\" to \"b.txt\"",
+    "Added directory \"photos\"",
+    "Reverted library to status at 2014-01-01 10:00:00.",
+    "Merged with server",
+    "Added \"paper.pdf\" and 12 more files.\nModified \"notes.txt\".",
+};
+
+QString repoId(int i)
+{
+    return QString("%1-0000-4000-8000-000000000000").arg(i, 8, 16, QChar('0'));
+}
+
+/**
+ * The response of GET /api2/repos/ of an account with @n libraries, split
+ * between the personal, shared and group libraries
+ */
+QByteArray serverReposJSON(int n)
+{
+    json_t *array = json_array();
+    for (int i = 0; i < n; i++) {
+        json_t *repo = json_object();
+        const char *type = i % 4 == 0 ? "srepo" : (i % 4 == 1 ? "grepo" : "repo");
+        json_object_set_new(repo, "id", json_string(toCStr(repoId(i))));
+        json_object_set_new(repo, "name", json_string(toCStr(QString("library %1").arg(i))));
+        json_object_set_new(repo, "desc", json_string("a library for the benchmarks"));
+        json_object_set_new(repo, "mtime", json_integer(1400000000 + i));
+        json_object_set_new(repo, "size", json_integer(1024 * i));
+        json_object_set_new(repo, "root", json_string("0000000000000000000000000000000000000000"));
+        json_object_set_new(repo, "encrypted", i % 10 == 0 ? json_true() : json_false());
+        json_object_set_new(repo, "type", json_string(type));
+        json_object_set_new(repo, "owner",
+                            json_string(toCStr(QString("user%1@example.com").arg(i % 50))));
+        json_object_set_new(repo, "permission", json_string(i % 3 == 0 ? "r" : "rw"));
+        json_object_set_new(repo, "virtual", i % 20 == 0 ? json_true() : json_false());
+        if (i % 4 == 1) {
+            json_object_set_new(repo, "groupid", json_integer(i % 30));
+        }
+        json_array_append_new(array, repo);
+    }
+
+    char *dump = json_dumps(array, JSON_COMPACT);
+    QByteArray ret(dump);
+    free(dump);
+    json_decref(array);
+    return ret;
+}
+
+/**
+ * The response of GET /api2/events/ with @n events
+ */
+QByteArray eventsJSON(int n)
+{
+    int n_descs = sizeof(kCommitDescs) / sizeof(kCommitDescs[0]);
+
+    json_t *array = json_array();
+    for (int i = 0; i < n; i++) {
+        json_t *event = json_object();
+        json_object_set_new(event, "author",
+                            json_string(toCStr(QString("user%1@example.com").arg(i % 50))));
+        json_object_set_new(event, "nick", json_string(toCStr(QString("user %1").arg(i % 50))));
+        json_object_set_new(event, "repo_id", json_string(toCStr(repoId(i % 1000))));
+        json_object_set_new(event, "repo_name", json_string(toCStr(QString("library %1").arg(i % 1000))));
+        json_object_set_new(event, "commit_id", json_string("0123456789abcdef0123456789abcdef01234567"));
+        json_object_set_new(event, "etype", json_string(i % 100 == 0 ? "repo-create" : "repo-update"));
+        json_object_set_new(event, "desc", json_string(kCommitDescs[i % n_descs]));
+        json_object_set_new(event, "time", json_integer(1400000000 + i));
+        json_array_append_new(array, event);
+    }
+
+    char *dump = json_dumps(array, JSON_COMPACT);
+    QByteArray ret(dump);
+    free(dump);
+    json_decref(array);
+    return ret;
+}
+
+/**
+ * The response of GET /api2/repo_history_changes/ for a commit touching
+ * @n files
+ */
+QByteArray commitDetailsJSON(int n)
+{
+    int n_names = sizeof(kFileNames) / sizeof(kFileNames[0]);
+    const char *lists[] = { "added_files", "deleted_files", "modified_files" };
+
+    json_t *details = json_object();
+    for (int l = 0; l < 3; l++) {
+        json_t *array = json_array();
+        for (int i = l; i < n; i += 4) {
+            QString path = QString("/dir%1/%2-%3").arg(i % 100).arg(i).arg(kFileNames[i % n_names]);
+            json_array_append_new(array, json_string(toCStr(path)));
+        }
+        json_object_set_new(details, lists[l], array);
+    }
+
+    json_t *renamed = json_array();
+    for (int i = 3; i < n; i += 4) {
+        json_array_append_new(renamed, json_string(toCStr(QString("/old/%1.txt").arg(i))));
+        json_array_append_new(renamed, json_string(toCStr(QString("/new/%1.txt").arg(i))));
+    }
+    json_object_set_new(details, "renamed_files", renamed);
+    json_object_set_new(details, "added_dirs", json_array());
+    json_object_set_new(details, "deleted_dirs", json_array());
+
+    char *dump = json_dumps(details, JSON_COMPACT);
+    QByteArray ret(dump);
+    free(dump);
+    json_decref(details);
+    return ret;
+}
+
+json_t *loadJSON(const QByteArray& data)
+{
+    json_error_t error;
+    json_t *root = json_loadb(data.data(), data.size(), 0, &error);
+    if (!root) {
+        qFatal("failed to parse the fixture: %s", error.text);
+    }
+    return root;
+}
+
+std::vector<ServerRepo> serverRepos(int n)
+{
+    json_error_t error;
+    json_t *root = loadJSON(serverReposJSON(n));
+    std::vector<ServerRepo> repos = ServerRepo::listFromJSON(root, &error);
+    json_decref(root);
+    return repos;
+}
+
+} // namespace
+
+
+class ClientBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void parseServerRepos_data();
+    void parseServerRepos();
+
+    void parseEvents();
+
+    void parseCommitDetails();
+
+    void translateCommitDescs();
+
+    void iconByFileName();
+
+    void setRepos_data();
+    void setRepos();
+
+    void paintRepoItems();
+};
+
+void ClientBench::parseServerRepos_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("50k") << 50000;
+}
+
+void ClientBench::parseServerRepos()
+{
+    QFETCH(int, count);
+    QByteArray data = serverReposJSON(count);
+
+    QBENCHMARK {
+        json_error_t error;
+        json_t *root = loadJSON(data);
+        std::vector<ServerRepo> repos = ServerRepo::listFromJSON(root, &error);
+        json_decref(root);
+        QCOMPARE((int)repos.size(), count);
+    }
+
+    // What keeping the parsed libraries around costs
+    StringPool *pool = StringPool::instance();
+    pool->clear();
+    long long rss_before = process_resident_memory();
+    json_error_t error;
+    json_t *root = loadJSON(data);
+    std::vector<ServerRepo> repos = ServerRepo::listFromJSON(root, &error);
+    json_decref(root);
+    long long rss_after = process_resident_memory();
+
+    qDebug("%d libraries: rss +%lld KB, %d interned strings (%lld bytes)",
+           (int)repos.size(), (rss_after - rss_before) / 1024,
+           pool->size(), pool->bytesUsed());
+}
+
+void ClientBench::parseEvents()
+{
+    QByteArray data = eventsJSON(10000);
+
+    QBENCHMARK {
+        json_error_t error;
+        json_t *root = loadJSON(data);
+        std::vector<SeafEvent> events = SeafEvent::listFromJSON(root, &error);
+        json_decref(root);
+        QCOMPARE((int)events.size(), 10000);
+    }
+}
+
+void ClientBench::parseCommitDetails()
+{
+    QByteArray data = commitDetailsJSON(200000);
+
+    QBENCHMARK {
+        json_error_t error;
+        json_t *root = loadJSON(data);
+        CommitDetails details = CommitDetails::fromJSON(root, &error);
+        json_decref(root);
+        QCOMPARE((int)details.added_files.size(), 50000);
+    }
+}
+
+void ClientBench::translateCommitDescs()
+{
+    int n_descs = sizeof(kCommitDescs) / sizeof(kCommitDescs[0]);
+    QStringList descs;
+    for (int i = 0; i < 10000; i++) {
+        descs << QString::fromUtf8(kCommitDescs[i % n_descs]);
+    }
+
+    QBENCHMARK {
+        foreach (const QString& desc, descs) {
+            translateCommitDesc(desc);
+        }
+    }
+}
+
+void ClientBench::iconByFileName()
+{
+    int n_names = sizeof(kFileNames) / sizeof(kFileNames[0]);
+    QStringList names;
+    for (int i = 0; i < 200000; i++) {
+        names << QString("%1-%2").arg(i).arg(kFileNames[i % n_names]);
+    }
+
+    QBENCHMARK {
+        foreach (const QString& name, names) {
+            getIconByFileName(name);
+        }
+    }
+}
+
+void ClientBench::setRepos_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("update");
+    QTest::newRow("1k") << 1000 << false;
+    QTest::newRow("10k") << 10000 << false;
+    QTest::newRow("50k") << 50000 << false;
+    // setRepos() again with the same libraries, as in the periodic refresh
+    QTest::newRow("10k-update") << 10000 << true;
+    QTest::newRow("50k-update") << 50000 << true;
+}
+
+void ClientBench::setRepos()
+{
+    QFETCH(int, count);
+    QFETCH(bool, update);
+    std::vector<ServerRepo> repos = serverRepos(count);
+
+    RepoTreeModel model;
+    if (update) {
+        model.setRepos(repos);
+        QBENCHMARK {
+            model.setRepos(repos);
+        }
+    } else {
+        QBENCHMARK {
+            model.clear();
+            model.setRepos(repos);
+        }
+    }
+}
+
+void ClientBench::paintRepoItems()
+{
+    std::vector<ServerRepo> repos = serverRepos(1000);
+    RepoTreeModel model;
+    model.setRepos(repos);
+    RepoItemDelegate delegate;
+
+    // Only the libraries, painting a category needs the tree view
+    QList<QModelIndex> indexes;
+    for (int i = 0; i < model.rowCount(); i++) {
+        QModelIndex category = model.index(i, 0);
+        for (int j = 0; j < model.rowCount(category); j++) {
+            indexes << model.index(j, 0, category);
+        }
+    }
+
+    QStyleOptionViewItem option;
+    option.font = QApplication::font();
+    option.fontMetrics = QFontMetrics(option.font);
+    option.rect = QRect(QPoint(0, 0), delegate.sizeHint(option, indexes.value(0)));
+    option.rect.setWidth(kPaintWidth);
+
+    QImage image(option.rect.size(), QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        QPainter painter(&image);
+        foreach (const QModelIndex& index, indexes) {
+            delegate.paint(&painter, option, index);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    // Constructed but not started: no daemon, no network. The rpc client
+    // fails the queries made by the model.
+    seafApplet = new SeafileApplet(true);
+
+    ClientBench bench;
+
+    QStringList args = app.arguments();
+    bool has_output_option = false;
+    foreach (const QString& arg, args) {
+        if (arg == "-txt" || arg == "-xml" || arg == "-lightxml"
+            || arg == "-xunitxml" || arg == "-o") {
+            has_output_option = true;
+        }
+    }
+    if (!has_output_option) {
+        args.insert(1, "-xml");
+    }
+
+    return QTest::qExec(&bench, args);
+}
+
+#include "client-bench.moc"
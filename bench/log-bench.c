@@ -0,0 +1,141 @@
+/*
+ * Measures the throughput of the applet logger, and the latency seen by the
+ * threads that log.
+ *
+ * usage: seafile-log-bench [threads] [messages-per-thread]
+ *
+ * Prints one line of "key=value" pairs, e.g.
+ *
+ *   log-bench threads=4 messages=400000 elapsed_ms=... msgs_per_sec=...
+ *     p50_ns=... p99_ns=... p999_ns=... max_ns=... dropped=...
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "utils/log.h"
+
+typedef struct {
+    int id;
+    int n_messages;
+    guint64 *latencies;
+} BenchThread;
+
+static guint64
+now_ns (void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    return (guint64)g_get_monotonic_time () * 1000;
+#endif
+}
+
+static gpointer
+bench_thread_func (gpointer data)
+{
+    BenchThread *t = data;
+    int i;
+
+    for (i = 0; i < t->n_messages; i++) {
+        guint64 start = now_ns ();
+        g_debug ("[LogBench] thread %d message %d: GET /api2/repos/ 200 OK", t->id, i);
+        t->latencies[i] = now_ns () - start;
+    }
+
+    return NULL;
+}
+
+static int
+compare_u64 (const void *a, const void *b)
+{
+    guint64 x = *(const guint64 *)a, y = *(const guint64 *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static guint64
+percentile (const guint64 *sorted, int n, double p)
+{
+    int i = (int)(p * (n - 1));
+    return sorted[i];
+}
+
+int
+main (int argc, char **argv)
+{
+    int n_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int n_messages = argc > 2 ? atoi(argv[2]) : 100000;
+    int i, total, written;
+    guint ndropped;
+    BenchThread *threads;
+    GThread **handles;
+    guint64 *all, start, elapsed;
+    char *dir;
+
+#if !GLIB_CHECK_VERSION(2, 31, 0)
+    g_thread_init (NULL);
+#endif
+
+    if (n_threads <= 0 || n_messages <= 0) {
+        fprintf (stderr, "usage: %s [threads] [messages-per-thread]\n", argv[0]);
+        return 1;
+    }
+
+    dir = g_build_filename (g_get_tmp_dir (), "seafile-log-bench", NULL);
+    if (applet_log_init (dir) < 0) {
+        fprintf (stderr, "failed to init log in %s\n", dir);
+        return 1;
+    }
+
+    total = n_threads * n_messages;
+    all = g_new (guint64, total);
+    threads = g_new0 (BenchThread, n_threads);
+    handles = g_new0 (GThread *, n_threads);
+
+    start = now_ns ();
+    for (i = 0; i < n_threads; i++) {
+        threads[i].id = i;
+        threads[i].n_messages = n_messages;
+        threads[i].latencies = all + (gsize)i * n_messages;
+#if GLIB_CHECK_VERSION(2, 32, 0)
+        handles[i] = g_thread_new ("bench", bench_thread_func, &threads[i]);
+#else
+        handles[i] = g_thread_create (bench_thread_func, &threads[i], TRUE, NULL);
+#endif
+    }
+    for (i = 0; i < n_threads; i++)
+        g_thread_join (handles[i]);
+
+    /* Include the time needed to get everything to the disk */
+    applet_log_flush ();
+    elapsed = now_ns () - start;
+
+    /* The dropped messages cost next to nothing, don't count them */
+    ndropped = applet_log_dropped_count ();
+    written = total - (int)ndropped;
+
+    qsort (all, total, sizeof(guint64), compare_u64);
+
+    printf ("log-bench threads=%d messages=%d elapsed_ms=%.1f msgs_per_sec=%.0f "
+            "p50_ns=%" G_GUINT64_FORMAT " p99_ns=%" G_GUINT64_FORMAT
+            " p999_ns=%" G_GUINT64_FORMAT " max_ns=%" G_GUINT64_FORMAT
+            " written=%d dropped=%u\n",
+            n_threads, total, elapsed / 1e6, written / (elapsed / 1e9),
+            percentile (all, total, 0.50), percentile (all, total, 0.99),
+            percentile (all, total, 0.999), all[total - 1],
+            written, ndropped);
+
+    applet_log_shutdown ();
+
+    g_free (all);
+    g_free (threads);
+    g_free (handles);
+    g_free (dir);
+
+    return 0;
+}
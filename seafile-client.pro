@@ -25,21 +25,32 @@ HEADERS += src/account-mgr.h \
            src/daemon-mgr.h \
            src/events-service.h \
            src/message-listener.h \
+           src/notification-aggregator.h \
+           src/transfer-progress.h \
+           src/transfer-stats-service.h \
+           src/metrics-server.h \
+           src/daemon-control-server.h \
            src/open-local-helper.h \
            src/repo-service.h \
+           src/repo-snapshot.h \
            src/seafile-applet.h \
            src/seahub-notifications-monitor.h \
+           src/server-info-service.h \
            src/settings-mgr.h \
            src/traynotificationmanager.h \
            src/traynotificationwidget.h \
            src/api/api-client.h \
            src/api/api-error.h \
            src/api/api-request.h \
+           src/api/request-scheduler.h \
+           src/api/racing-login-request.h \
+           src/api/content-decoder.h \
            src/api/commit-details.h \
            src/api/event.h \
            src/api/requests.h \
            src/api/server-repo.h \
            src/api/starred-file.h \
+           src/api/server-info.h \
            src/rpc/clone-task.h \
            src/rpc/local-repo.h \
            src/rpc/rpc-client.h \
@@ -69,6 +80,7 @@ HEADERS += src/account-mgr.h \
            src/ui/repos-tab.h \
            src/ui/seafile-tab-widget.h \
            src/ui/server-status-dialog.h \
+           src/ui/transfer-chart.h \
            src/ui/set-repo-password-dialog.h \
            src/ui/settings-dialog.h \
            src/ui/ssl-confirm-dialog.h \
@@ -83,8 +95,14 @@ HEADERS += src/account-mgr.h \
            src/utils/file-utils.h \
            src/utils/log.h \
            src/utils/paint-utils.h \
+           src/utils/perf-stats.h \
+           src/utils/probes.h \
            src/utils/process.h \
+           src/utils/repo-id.h \
            src/utils/rsa.h \
+           src/utils/string-pool.h \
+           src/utils/trace.h \
+           src/utils/trace-recorder.h \
            src/utils/translate-commit-desc.h \
            src/utils/uninstall-helpers.h \
            src/utils/utils.h \
@@ -117,16 +135,26 @@ SOURCES += src/account-mgr.cpp \
            src/events-service.cpp \
            src/main.cpp \
            src/message-listener.cpp \
+           src/notification-aggregator.cpp \
+           src/transfer-progress.cpp \
+           src/transfer-stats-service.cpp \
+           src/metrics-server.cpp \
+           src/daemon-control-server.cpp \
            src/open-local-helper.cpp \
            src/repo-service.cpp \
+           src/repo-snapshot.cpp \
            src/seafile-applet.cpp \
            src/seahub-notifications-monitor.cpp \
+           src/server-info-service.cpp \
            src/settings-mgr.cpp \
            src/traynotificationmanager.cpp \
            src/traynotificationwidget.cpp \
            src/api/api-client.cpp \
            src/api/api-error.cpp \
            src/api/api-request.cpp \
+           src/api/request-scheduler.cpp \
+           src/api/racing-login-request.cpp \
+           src/api/content-decoder.cpp \
            src/api/commit-details.cpp \
            src/api/event.cpp \
            src/api/requests.cpp \
@@ -161,6 +189,7 @@ SOURCES += src/account-mgr.cpp \
            src/ui/repos-tab.cpp \
            src/ui/seafile-tab-widget.cpp \
            src/ui/server-status-dialog.cpp \
+           src/ui/transfer-chart.cpp \
            src/ui/set-repo-password-dialog.cpp \
            src/ui/settings-dialog.cpp \
            src/ui/ssl-confirm-dialog.cpp \
@@ -175,7 +204,13 @@ SOURCES += src/account-mgr.cpp \
            src/utils/file-utils.cpp \
            src/utils/log.c \
            src/utils/paint-utils.cpp \
+           src/utils/perf-stats.cpp \
+           src/utils/probes.cpp \
+           src/utils/repo-id.cpp \
            src/utils/rsa.cpp \
+           src/utils/string-pool.cpp \
+           src/utils/trace.cpp \
+           src/utils/trace-recorder.cpp \
            src/utils/translate-commit-desc.cpp \
            src/utils/uninstall-helpers.cpp \
            src/utils/utils.cpp \
@@ -205,13 +240,24 @@ TRANSLATIONS += i18n/seafile_ca.ts \
 ICON = seafile.icns
 CONFIG += debug_and_release_target
 CONFIG += warn_on link_pkgconfig resources
-PKGCONFIG += libsearpc libccnet libseafile glib-2.0 sqlite3 jansson openssl
+CONFIG(debug, debug|release) {
+    DEFINES += SEAFILE_TRACE_ENABLED
+}
+PKGCONFIG += libsearpc libccnet libseafile glib-2.0 gthread-2.0 sqlite3 jansson openssl zlib
 
 win32 {
     SOURCES += src/utils/process-win.cpp src/utils/registry.cpp
 }
 linux {
     SOURCES += src/utils/process-linux.cpp
+    # qmake CONFIG+=usdt_probes, see src/utils/probes.h
+    usdt_probes: DEFINES += SEAFILE_USDT_PROBES
+}
+# qmake CONFIG+=fake_daemon, see tools/fake-daemon (testing only)
+fake_daemon {
+    DEFINES += SEAFILE_FAKE_DAEMON_ENABLED
+    HEADERS += src/rpc/fake-daemon-transport.h
+    SOURCES += src/rpc/fake-daemon-transport.cpp
 }
 macx {
     system("mkdir -p libs; cp -f `which ccnet` libs/; cp -f `which seaf-daemon` libs/")
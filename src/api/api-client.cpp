@@ -1,4 +1,5 @@
 #include <QUrl>
+#include <QTimer>
 #include <QtNetwork>
 #include <QSslError>
 #include <QSslConfiguration>
@@ -9,6 +10,9 @@
 #include "ui/main-window.h"
 #include "ui/ssl-confirm-dialog.h"
 #include "utils/utils.h"
+#include "utils/trace.h"
+#include "utils/probes.h"
+#include "utils/perf-stats.h"
 
 #include "api-client.h"
 
@@ -16,25 +20,49 @@ namespace {
 
 const char *kContentTypeForm = "application/x-www-form-urlencoded";
 const char *kAuthHeader = "Authorization";
+const char *kAcceptEncodingHeader = "Accept-Encoding";
+const char *kContentEncodingHeader = "Content-Encoding";
+
+// Setting the header ourselves turns off the gzip support of
+// QNetworkAccessManager, which has no deflate and hides the compressed size
+const char *kAcceptEncoding = "gzip, deflate";
 
 const int kMaxRedirects = 3;
 
+const char *kPingUrl = "api2/ping/";
+const int kPreconnectTimeoutMsecs = 10 * 1000;
+
+// The apis not every server has, see ServerInfoService
 bool shouldIgnoreRequestError(const QNetworkReply* reply)
 {
-    return reply->url().toString().contains("/api2/events");
+    QString url = reply->url().toString();
+    return url.contains("/api2/events") || url.contains("/api2/server-info");
 }
 
 } // namespace
 
 QNetworkAccessManager* SeafileApiClient::na_mgr_ = NULL;
+quint64 SeafileApiClient::compressed_bytes_total_;
+quint64 SeafileApiClient::decompressed_bytes_total_;
 
 SeafileApiClient::SeafileApiClient(QObject *parent)
     : QObject(parent),
-      redirect_count_(0)
+      reply_(NULL),
+      redirect_count_(0),
+      timeout_msecs_(0),
+      timed_out_(false),
+      prompt_ssl_errors_(true),
+      received_bytes_(0),
+      decoder_started_(false),
+      decode_error_(false)
 {
     if (!na_mgr_) {
         na_mgr_ = new QNetworkAccessManager();
     }
+
+    deadline_timer_ = new QTimer(this);
+    deadline_timer_->setSingleShot(true);
+    connect(deadline_timer_, SIGNAL(timeout()), this, SLOT(onDeadlineExceeded()));
 }
 
 SeafileApiClient::~SeafileApiClient()
@@ -53,12 +81,17 @@ void SeafileApiClient::get(const QUrl& url)
         qsnprintf(buf, sizeof(buf), "Token %s", token_.toUtf8().data());
         request.setRawHeader(kAuthHeader, buf);
     }
+    request.setRawHeader(kAcceptEncodingHeader, kAcceptEncoding);
 
-    // qDebug("send request, url = %s\n, token = %s\n",
-    //        request.url().toString().toUtf8().data(),
-    //        request.rawHeader(kAuthHeader).data());
+    SEAFILE_TRACE(TRACE_API, "GET %s", toCStr(url.toString()));
+    if (SEAFILE_PROBE_ENABLED(api__start)) {
+        SEAFILE_PROBE2(api__start, "GET", url.toEncoded().constData());
+    }
+    request_timer_.start();
+    startDeadlineTimer();
 
     reply_ = na_mgr_->get(request);
+    startReading();
 
     connect(reply_, SIGNAL(sslErrors(const QList<QSslError>&)),
             this, SLOT(onSslErrors(const QList<QSslError>&)));
@@ -76,8 +109,17 @@ void SeafileApiClient::post(const QUrl& url, const QByteArray& encoded_params)
         request.setRawHeader(kAuthHeader, buf);
     }
     request.setHeader(QNetworkRequest::ContentTypeHeader, kContentTypeForm);
+    request.setRawHeader(kAcceptEncodingHeader, kAcceptEncoding);
+
+    SEAFILE_TRACE(TRACE_API, "POST %s", toCStr(url.toString()));
+    if (SEAFILE_PROBE_ENABLED(api__start)) {
+        SEAFILE_PROBE2(api__start, "POST", url.toEncoded().constData());
+    }
+    request_timer_.start();
+    startDeadlineTimer();
 
     reply_ = na_mgr_->post(request, encoded_params);
+    startReading();
 
     connect(reply_, SIGNAL(finished()), this, SLOT(httpRequestFinished()));
 
@@ -85,6 +127,101 @@ void SeafileApiClient::post(const QUrl& url, const QByteArray& encoded_params)
             this, SLOT(onSslErrors(const QList<QSslError>&)));
 }
 
+void SeafileApiClient::startReading()
+{
+    body_.clear();
+    received_bytes_ = 0;
+    decoder_started_ = false;
+    decode_error_ = false;
+    // An empty body (e.g. of a redirect) never reaches onReadyRead, don't
+    // let isCompressed() describe the previous one
+    decoder_.reset(QByteArray());
+
+    connect(reply_, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+}
+
+void SeafileApiClient::onReadyRead()
+{
+    if (!decoder_started_) {
+        decoder_started_ = true;
+        decode_error_ = !decoder_.reset(reply_->rawHeader(kContentEncodingHeader));
+    }
+
+    // Drained as it arrives, so the compressed body is never held in full
+    QByteArray chunk = reply_->readAll();
+    received_bytes_ += chunk.size();
+    if (!decode_error_ && !decoder_.decode(chunk, &body_)) {
+        qWarning("[api] failed to decompress the response of %s",
+                 reply_->url().toString().toUtf8().data());
+        decode_error_ = true;
+    }
+}
+
+void SeafileApiClient::preconnect(const QUrl& server_url)
+{
+    SeafileApiClient *client = new SeafileApiClient;
+    client->setPromptSslErrors(false);
+    client->setTimeout(kPreconnectTimeoutMsecs);
+
+    connect(client, SIGNAL(requestSuccess(QNetworkReply&)), client, SLOT(deleteLater()));
+    connect(client, SIGNAL(requestFailed(int)), client, SLOT(deleteLater()));
+    connect(client, SIGNAL(networkError(const QNetworkReply::NetworkError&, const QString&)),
+            client, SLOT(deleteLater()));
+
+    client->get(::urlJoin(server_url, kPingUrl));
+}
+
+void SeafileApiClient::startDeadlineTimer()
+{
+    // Started once: the redirects count against the same deadline
+    if (timeout_msecs_ > 0 && !deadline_timer_->isActive()) {
+        deadline_timer_->start(timeout_msecs_);
+    }
+}
+
+bool SeafileApiClient::pauseDeadline()
+{
+    bool was_running = deadline_timer_->isActive();
+    deadline_timer_->stop();
+    return was_running;
+}
+
+// Restarted from scratch, QTimer can't tell the time left in qt4
+void SeafileApiClient::resumeDeadline(bool was_running)
+{
+    if (was_running && reply_) {
+        deadline_timer_->start(timeout_msecs_);
+    }
+}
+
+void SeafileApiClient::onDeadlineExceeded()
+{
+    if (!reply_) {
+        return;
+    }
+
+    SEAFILE_TRACE(TRACE_API, "deadline exceeded for %s",
+                  toCStr(reply_->url().toString()));
+    timed_out_ = true;
+    // finished() is emitted, httpRequestFinished reports the timeout
+    reply_->abort();
+}
+
+void SeafileApiClient::abort()
+{
+    deadline_timer_->stop();
+
+    if (!reply_) {
+        return;
+    }
+
+    SEAFILE_TRACE(TRACE_API, "aborting %s", toCStr(reply_->url().toString()));
+    reply_->disconnect(this);
+    reply_->abort();
+    reply_->deleteLater();
+    reply_ = NULL;
+}
+
 void SeafileApiClient::onSslErrors(const QList<QSslError>& errors)
 {
     QUrl url = reply_->url();
@@ -101,19 +238,29 @@ void SeafileApiClient::onSslErrors(const QList<QSslError>& errors)
 
     QSslCertificate saved_cert = mgr->getCertificate(url.toString());
 
+    if (!prompt_ssl_errors_) {
+        // No dialog, e.g. for a warm-up request: accept only the certificate
+        // the user has trusted before, otherwise the request fails quietly
+        if (!saved_cert.isNull() && saved_cert == cert) {
+            reply_->ignoreSslErrors();
+        }
+        return;
+    }
+
     if (saved_cert.isNull()) {
         // dump certificate information
         qDebug() << "\n= SslErrors =\n" << dumpSslErrors(errors);
         qDebug() << "\n= Certificate =\n" << dumpCertificate(cert);
 
         // This is the first time when the client connects to the server.
+        bool deadline_paused = pauseDeadline();
         if (seafApplet->detailedYesOrNoBox(
             tr("<b>Warning:</b> The ssl certificate of this server is not trusted, proceed anyway?"),
             dumpSslErrors(errors) + dumpCertificate(cert), 0, false)) {
             mgr->saveCertificate(url, cert);
             reply_->ignoreSslErrors();
         }
-
+        resumeDeadline(deadline_paused);
 
         return;
     } else if (saved_cert == cert) {
@@ -135,15 +282,23 @@ void SeafileApiClient::onSslErrors(const QList<QSslError>& errors)
          *
          * Anyway, we'll prompt the user
          */
+        if (seafApplet->headless()) {
+            qWarning("the certificate of %s has changed, rejecting it in headless mode",
+                     url.toString().toUtf8().data());
+            reply_->abort();
+            return;
+        }
         SslConfirmDialog dialog(url,
                                 dumpCertificateFingerprint(cert),
                                 dumpCertificateFingerprint(saved_cert),
                                 seafApplet->mainWindow());
+        bool deadline_paused = pauseDeadline();
         if (dialog.exec() == QDialog::Accepted) {
             reply_->ignoreSslErrors();
             if (dialog.rememberChoice()) {
                 mgr->saveCertificate(url, cert);
             }
+            resumeDeadline(deadline_paused);
         } else {
             reply_->abort();
         }
@@ -158,8 +313,40 @@ void SeafileApiClient::onSslErrors(const QList<QSslError>& errors)
 
 void SeafileApiClient::httpRequestFinished()
 {
+    if (reply_->bytesAvailable() > 0) {
+        onReadyRead();
+    }
+    if (decoder_.isCompressed()) {
+        compressed_bytes_total_ += received_bytes_;
+        decompressed_bytes_total_ += body_.size();
+    }
+
     int code = reply_->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    SEAFILE_TRACE(TRACE_API, "finished %s: status code %d, error %d, %lld bytes (%d decoded)",
+                  toCStr(reply_->url().toString()), code, (int)reply_->error(),
+                  (long long)received_bytes_, body_.size());
+    // the bytes on the wire
+    qint64 bytes = received_bytes_;
+    qint64 duration_us = request_timer_.nsecsElapsed() / 1000;
+    if (SEAFILE_PROBE_ENABLED(api__done)) {
+        SEAFILE_PROBE4(api__done, reply_->url().toEncoded().constData(),
+                       code, (long)bytes, (long)duration_us);
+    }
+    if (reply_->operation() == QNetworkAccessManager::PostOperation) {
+        bytes += encoded_params_.size();
+    }
+    PerfStats::instance()->recordCall(PerfStats::API,
+                                      PerfStats::endpointName(reply_->url().path()),
+                                      duration_us, bytes,
+                                      code == 0 || code >= 400);
+    if (timed_out_) {
+        qDebug("[api] request timed out: %s\n", reply_->url().toString().toUtf8().data());
+        emit networkError(QNetworkReply::TimeoutError, tr("The request timed out"));
+        return;
+    }
+
     if (code == 0 && reply_->error() != QNetworkReply::NoError) {
+        deadline_timer_->stop();
         if (!shouldIgnoreRequestError(reply_)) {
             qDebug("[api] network error: %s\n", reply_->errorString().toUtf8().data());
         }
@@ -171,6 +358,19 @@ void SeafileApiClient::httpRequestFinished()
         return;
     }
 
+    deadline_timer_->stop();
+
+    if (!decode_error_ && decoder_.isCompressed() && !decoder_.isFinished()) {
+        qWarning("[api] the compressed response of %s is truncated",
+                 reply_->url().toString().toUtf8().data());
+        decode_error_ = true;
+    }
+
+    if (decode_error_) {
+        emit networkError(QNetworkReply::ProtocolFailure, tr("Invalid compressed response"));
+        return;
+    }
+
     if ((code / 100) == 4 || (code / 100) == 5) {
         if (!shouldIgnoreRequestError(reply_)) {
             qDebug("request failed for %s: status code %d\n",
@@ -192,6 +392,7 @@ bool SeafileApiClient::handleHttpRedirect()
 
     if (redirect_count_++ > kMaxRedirects) {
         // simply treat too many redirects as server side error
+        deadline_timer_->stop();
         emit requestFailed(500);
         qDebug("too many redirects for %s\n",
                reply_->url().toString().toUtf8().data());
@@ -205,8 +406,9 @@ bool SeafileApiClient::handleHttpRedirect()
         redirect_url =  reply_->url().resolved(redirect_url);
     }
 
-    // qDebug("redirect to %s (from %s)\n", redirect_url.toString().toUtf8().data(),
-    //        reply_->url().toString().toUtf8().data());
+    SEAFILE_TRACE(TRACE_API, "redirect to %s (from %s)",
+                  toCStr(redirect_url.toString()),
+                  toCStr(reply_->url().toString()));
 
     switch (reply_->operation()) {
     case QNetworkAccessManager::GetOperation:
@@ -4,12 +4,16 @@
 #include <QString>
 #include <QObject>
 #include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QByteArray>
 
 #include "account.h"
 #include "server-repo.h"
+#include "content-decoder.h"
 
 class QNetworkAccessManager;
 class QSslError;
+class QTimer;
 
 /**
  * SeafileApiClient handles the underlying api mechanism
@@ -24,6 +28,31 @@ public:
     void get(const QUrl& url);
     void post(const QUrl& url, const QByteArray& encoded_params);
 
+    // Fail with QNetworkReply::TimeoutError if the request (including its
+    // redirects) takes longer than msecs. 0 means no deadline.
+    void setTimeout(int msecs) { timeout_msecs_ = msecs; }
+
+    // If false, an untrusted certificate is accepted only if the user has
+    // trusted it before, without asking
+    void setPromptSslErrors(bool prompt) { prompt_ssl_errors_ = prompt; }
+
+    // Abort the request. No signal is emitted afterwards.
+    void abort();
+
+    // Ping the server, so the dns lookup, the tcp connection and the tls
+    // handshake are done before the first real request, which then reuses
+    // the connection. Untrusted certificates are not prompted for.
+    static void preconnect(const QUrl& server_url);
+
+    // The decompressed body of the response, valid once requestSuccess is
+    // emitted
+    const QByteArray& body() const { return body_; }
+
+    // Bytes received with a gzip or deflate encoding, and their size once
+    // decompressed
+    static quint64 compressedBytesTotal() { return compressed_bytes_total_; }
+    static quint64 decompressedBytesTotal() { return decompressed_bytes_total_; }
+
 signals:
     void requestSuccess(QNetworkReply& reply);
     void requestFailed(int code);
@@ -33,11 +62,32 @@ signals:
 private slots:
     void httpRequestFinished();
     void onSslErrors(const QList<QSslError>& errors);
+    void onDeadlineExceeded();
+    void onReadyRead();
 
 private:
     Q_DISABLE_COPY(SeafileApiClient)
 
     bool handleHttpRedirect();
+    void startDeadlineTimer();
+    // The time the user takes to answer a dialog doesn't count against
+    // the deadline. pauseDeadline returns whether the timer was running.
+    bool pauseDeadline();
+    void resumeDeadline(bool was_running);
+    void startReading();
+
+    // unset for the pings of preconnect()
+    bool prompt_ssl_errors_;
+
+    static quint64 compressed_bytes_total_;
+    static quint64 decompressed_bytes_total_;
+
+    ContentDecoder decoder_;
+    QByteArray body_;
+    // bytes of the body on the wire, before decompression
+    qint64 received_bytes_;
+    bool decoder_started_;
+    bool decode_error_;
 
     static QNetworkAccessManager *na_mgr_;
 
@@ -48,6 +98,13 @@ private:
     QNetworkReply *reply_;
 
     int redirect_count_;
+
+    // time since the current request (or redirect) was sent
+    QElapsedTimer request_timer_;
+
+    int timeout_msecs_;
+    QTimer *deadline_timer_;
+    bool timed_out_;
 };
 
 #endif  // SEAFILE_API_CLIENT_H
@@ -49,6 +49,34 @@ ApiError ApiError::fromJsonError()
     return error;
 }
 
+bool ApiError::isTransient() const
+{
+    switch (type_) {
+    case NETWORK_ERROR:
+        switch (network_error_) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::ProxyConnectionRefusedError:
+        case QNetworkReply::ProxyConnectionClosedError:
+        case QNetworkReply::ProxyTimeoutError:
+        case QNetworkReply::UnknownNetworkError:
+            return true;
+        default:
+            // e.g. the request was aborted by the user
+            return false;
+        }
+    case HTTP_ERROR:
+        return http_error_code_ == 408 || http_error_code_ == 429
+            || http_error_code_ == 502 || http_error_code_ == 503
+            || http_error_code_ == 504;
+    default:
+        return false;
+    }
+}
+
 QString ApiError::toString() const {
     switch (type_) {
     case SSL_ERROR:
@@ -41,6 +41,10 @@ public:
 
     int httpErrorCode() const { return http_error_code_; }
 
+    // Whether the same request may succeed if sent again a bit later, e.g.
+    // a timeout, a refused connection or a 503
+    bool isTransient() const;
+
     QString toString() const;
 
 private:
@@ -1,26 +1,104 @@
 #include <QtNetwork>
+#include <QTimer>
 
 #include "utils/utils.h"
+#include "utils/trace-recorder.h"
 #include "api-client.h"
 #include "api-error.h"
+#include "request-scheduler.h"
 
 #include "api-request.h"
 
+namespace {
+
+// QObject signals, e.g. destroyed(), are not forwarded to the followers
+const int kFirstRequestMethod = QObject::staticMetaObject.methodCount();
+
+const int kDefaultDeadlineMsecs = 60 * 1000;
+
+const int kDefaultMaxRetries = 3;
+const int kRetryBaseDelayMsecs = 500;
+const int kRetryMaxDelayMsecs = 30 * 1000;
+
+// Exponential backoff with "equal jitter": half of the delay is fixed, the
+// other half random, so clients which failed together don't retry together
+int retryDelay(int retries)
+{
+    static bool seeded = false;
+    if (!seeded) {
+        qsrand(QDateTime::currentMSecsSinceEpoch() ^ QCoreApplication::applicationPid());
+        seeded = true;
+    }
+
+    int delay = qMin(kRetryMaxDelayMsecs, kRetryBaseDelayMsecs << qMin(retries, 16));
+    return delay / 2 + qrand() % (delay / 2 + 1);
+}
+
+} // namespace
+
+QHash<QString, SeafileApiRequest *> SeafileApiRequest::flights_;
+quint64 SeafileApiRequest::coalesced_count_;
+
 SeafileApiRequest::SeafileApiRequest(const QUrl& url, Method method,
                                      const QString& token, bool ignore_ssl_errors)
     : url_(url),
       method_(method),
       token_(token),
-      ignore_ssl_errors_(ignore_ssl_errors)
+      ignore_ssl_errors_(ignore_ssl_errors),
+      prompt_ssl_errors_(true),
+      priority_(PRIORITY_REFRESH),
+      deadline_msecs_(kDefaultDeadlineMsecs),
+      max_retries_(method == METHOD_GET ? kDefaultMaxRetries : 0),
+      retries_(0),
+      retry_pending_(false),
+      leader_(NULL),
+      finished_(false),
+      cancelled_(false),
+      trace_start_us_(-1)
 {
     api_client_ = new SeafileApiClient;
 }
 
 SeafileApiRequest::~SeafileApiRequest()
 {
+    cancel();
     delete api_client_;
 }
 
+void SeafileApiRequest::cancel()
+{
+    if (cancelled_) {
+        return;
+    }
+    cancelled_ = true;
+
+    if (leader_) {
+        leader_->followers_.removeOne(this);
+        leader_->disconnect(this);
+        leader_ = NULL;
+        return;
+    }
+
+    if (!flight_key_.isEmpty() && flights_.value(flight_key_) == this) {
+        flights_.remove(flight_key_);
+    }
+
+    if (!finished_ && !followers_.isEmpty()) {
+        // The others still wait for the reply
+        handOverToFollower();
+        return;
+    }
+
+    foreach (SeafileApiRequest *follower, followers_) {
+        follower->leader_ = NULL;
+        disconnect(follower);
+    }
+    followers_.clear();
+
+    api_client_->abort();
+    RequestScheduler::instance()->remove(this);
+}
+
 void SeafileApiRequest::setParam(const QString& name, const QString& value)
 {
     QPair<QString, QString> pair(name, value);
@@ -28,14 +106,99 @@ void SeafileApiRequest::setParam(const QString& name, const QString& value)
 }
 
 void SeafileApiRequest::send()
+{
+    if (cancelled_) {
+        return;
+    }
+
+    // The trace span includes the time spent in the queue
+    trace_start_us_ = TraceRecorder::isEnabled() ? TraceRecorder::instance()->now() : -1;
+
+    if (method_ == METHOD_GET) {
+        url_.setQueryItems(params_);
+
+        flight_key_ = QString("%1 %2 %3 %4").arg(metaObject()->className())
+            .arg(token_).arg(ignore_ssl_errors_).arg(url_.toString());
+
+        SeafileApiRequest *leader = flights_.value(flight_key_);
+        if (leader && leader != this) {
+            followLeader(leader);
+            return;
+        }
+        flights_[flight_key_] = this;
+    }
+
+    RequestScheduler::instance()->enqueue(this);
+}
+
+void SeafileApiRequest::followLeader(SeafileApiRequest *leader)
+{
+    leader_ = leader;
+    leader->followers_.append(this);
+    coalesced_count_++;
+
+    // Same class, so the same signals. They include failed().
+    const QMetaObject *meta = metaObject();
+    for (int i = kFirstRequestMethod; i < meta->methodCount(); i++) {
+        QMetaMethod method = meta->method(i);
+        if (method.methodType() != QMetaMethod::Signal) {
+            continue;
+        }
+        QByteArray signal = QByteArray::number(QSIGNAL_CODE) + method.signature();
+        connect(leader, signal.constData(), this, signal.constData());
+    }
+}
+
+void SeafileApiRequest::handOverToFollower()
+{
+    SeafileApiRequest *next = followers_.takeFirst();
+
+    // The follower's connections to us go away with us, it listens to the
+    // network reply itself from now on
+    disconnect(next);
+    next->leader_ = NULL;
+    next->priority_ = priority_;
+    next->flight_key_ = flight_key_;
+    flights_[flight_key_] = next;
+
+    foreach (SeafileApiRequest *follower, followers_) {
+        follower->leader_ = NULL;
+        disconnect(follower);
+        follower->followLeader(next);
+        coalesced_count_--;
+    }
+    followers_.clear();
+
+    // The follower was never started, so its api client is unused
+    delete next->api_client_;
+    next->api_client_ = api_client_;
+    api_client_->disconnect(this);
+    api_client_ = NULL;
+
+    next->retries_ = retries_;
+
+    RequestScheduler *scheduler = RequestScheduler::instance();
+    if (retry_pending_) {
+        // Not in the scheduler while waiting to retry, the follower sends
+        // the request again right away
+        scheduler->enqueue(next);
+    } else if (scheduler->replace(this, next)) {
+        next->connectApiClient();
+    }
+}
+
+void SeafileApiRequest::start()
 {
     if (token_.size() > 0) {
         api_client_->setToken(token_);
     }
+    api_client_->setTimeout(deadline_msecs_);
+    api_client_->setPromptSslErrors(prompt_ssl_errors_);
+
+    connectApiClient();
 
     switch (method_) {
     case METHOD_GET:
-        url_.setQueryItems(params_);
         api_client_->get(url_);
         break;
     case METHOD_POST:
@@ -48,10 +211,26 @@ void SeafileApiRequest::send()
         api_client_->post(url_, params.encodedQuery());
         break;
     }
+}
+
+void SeafileApiRequest::connectApiClient()
+{
+    // Connected before the other slots, which may delete this request, so
+    // the scheduler always learns that the slot is free
+    connect(api_client_, SIGNAL(requestSuccess(QNetworkReply&)),
+            this, SLOT(onRequestFinished()));
+    connect(api_client_, SIGNAL(networkError(const QNetworkReply::NetworkError&, const QString&)),
+            this, SLOT(onRequestFinished()));
+    connect(api_client_, SIGNAL(requestFailed(int)),
+            this, SLOT(onRequestFinished()));
 
     connect(api_client_, SIGNAL(requestSuccess(QNetworkReply&)),
             this, SLOT(requestSuccess(QNetworkReply&)));
 
+    // Connected after requestSuccess so the span includes the parsing
+    connect(api_client_, SIGNAL(requestSuccess(QNetworkReply&)),
+            this, SLOT(recordTraceEvent()));
+
     connect(api_client_, SIGNAL(networkError(const QNetworkReply::NetworkError&, const QString&)),
             this, SLOT(onNetworkError(const QNetworkReply::NetworkError&, const QString&)));
 
@@ -60,17 +239,101 @@ void SeafileApiRequest::send()
 
     connect(api_client_, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError>&)),
             this, SLOT(onSslErrors(QNetworkReply*, const QList<QSslError>&)));
+}
+
+void SeafileApiRequest::onRequestFinished()
+{
+    finished_ = true;
+
+    // A request sent from now on gets a fresh reply
+    if (flights_.value(flight_key_) == this) {
+        flights_.remove(flight_key_);
+    }
+
+    RequestScheduler::instance()->requestFinished(this);
+}
+
+void SeafileApiRequest::recordTraceEvent()
+{
+    if (trace_start_us_ >= 0 && TraceRecorder::isEnabled()) {
+        TraceRecorder *recorder = TraceRecorder::instance();
+        // className() returns a static string
+        recorder->addEvent("api", metaObject()->className(),
+                           trace_start_us_, recorder->now() - trace_start_us_);
+    }
+    trace_start_us_ = -1;
+}
 
+bool SeafileApiRequest::retryOnError(const ApiError& error)
+{
+    // POST requests are not idempotent, e.g. creating a library
+    if (method_ != METHOD_GET || retries_ >= max_retries_ || !error.isTransient()) {
+        return false;
+    }
+
+    if (!RequestScheduler::instance()->takeRetryToken(this)) {
+        return false;
+    }
+
+    int delay = retryDelay(retries_);
+    retries_++;
+
+    SEAFILE_TRACE(TRACE_API, "retrying %s in %d ms (retry %d of %d): %s",
+                  toCStr(url_.toString()), delay, retries_, max_retries_,
+                  toCStr(error.toString()));
+
+    // The old client is emitting the signal we are handling
+    api_client_->disconnect(this);
+    api_client_->deleteLater();
+    api_client_ = new SeafileApiClient;
+
+    finished_ = false;
+    retry_pending_ = true;
+    // Identical requests keep waiting for us instead of sending their own
+    if (!flight_key_.isEmpty()) {
+        flights_[flight_key_] = this;
+    }
+
+    QTimer::singleShot(delay, this, SLOT(retry()));
+
+    return true;
+}
+
+void SeafileApiRequest::retry()
+{
+    retry_pending_ = false;
+    if (cancelled_) {
+        return;
+    }
+
+    RequestScheduler::instance()->enqueue(this);
 }
 
 void SeafileApiRequest::onHttpError(int code)
 {
-    emit failed(ApiError::fromHttpError(code));
+    ApiError error = ApiError::fromHttpError(code);
+    if (retryOnError(error)) {
+        return;
+    }
+
+    recordTraceEvent();
+    emit failed(error);
 }
 
 void SeafileApiRequest::onNetworkError(const QNetworkReply::NetworkError& error, const QString& error_string)
 {
-    emit failed(ApiError::fromNetworkError(error, error_string));
+    ApiError api_error = ApiError::fromNetworkError(error, error_string);
+    if (retryOnError(api_error)) {
+        return;
+    }
+
+    recordTraceEvent();
+    emit failed(api_error);
+}
+
+const QByteArray& SeafileApiRequest::responseBody() const
+{
+    return api_client_->body();
 }
 
 void SeafileApiRequest::onSslErrors(QNetworkReply* reply, const QList<QSslError>& errors)
@@ -84,8 +347,9 @@ void SeafileApiRequest::onSslErrors(QNetworkReply* reply, const QList<QSslError>
 
 json_t* SeafileApiRequest::parseJSON(QNetworkReply &reply, json_error_t *error)
 {
-    QByteArray raw = reply.readAll();
-    //qDebug("\n%s\n", raw.data());
-    json_t *root = json_loads(raw.data(), 0, error);
+    SEAFILE_TRACE_SPAN("api", "parseJSON");
+    const QByteArray& raw = responseBody();
+    //qDebug("\n%s\n", raw.constData());
+    json_t *root = json_loads(raw.constData(), 0, error);
     return root;
 }
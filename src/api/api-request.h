@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QUrl>
 #include <QMap>
+#include <QHash>
 #include <QPair>
 #include <QList>
 #include <jansson.h>
@@ -20,12 +21,61 @@ class SeafileApiRequest : public QObject {
     Q_OBJECT
 
 public:
+    /**
+     * Decides the order in which RequestScheduler sends the queued
+     * requests, see request-scheduler.h
+     */
+    enum Priority {
+        // the user is waiting for the result, e.g. login
+        PRIORITY_INTERACTIVE = 0,
+        // periodic refreshes of the views, e.g. the repos list
+        PRIORITY_REFRESH,
+        // avatars, notifications and version checks
+        PRIORITY_BACKGROUND,
+        N_PRIORITIES
+    };
+
     virtual ~SeafileApiRequest();
 
     void setParam(const QString& name, const QString& value);
+
+    // Queue the request. It is sent when the scheduler has a free slot for
+    // its server.
+    //
+    // A GET identical to one already queued or in flight (same class, url,
+    // parameters and token) is not sent again: it waits for that request
+    // and emits the same signals with the same parsed result.
     void send();
     void setIgnoreSslErrors(bool ignore) { ignore_ssl_errors_ = ignore; }
 
+    // See SeafileApiClient::setPromptSslErrors, true by default
+    void setPromptSslErrors(bool prompt) { prompt_ssl_errors_ = prompt; }
+
+    void setPriority(Priority priority) { priority_ = priority; }
+    Priority priority() const { return priority_; }
+
+    // The request fails with a QNetworkReply::TimeoutError network error if
+    // no reply has arrived msecs after it was sent (time in the queue not
+    // included). 0 means no deadline.
+    void setDeadline(int msecs) { deadline_msecs_ = msecs; }
+
+    // A GET failing with a transient error (see ApiError::isTransient) is
+    // sent again up to this many times, after an exponential backoff with
+    // jitter, as long as the retry budget of its server allows it. Defaults
+    // to 3 for GET requests; POST requests are never retried.
+    void setMaxRetries(int retries) { max_retries_ = retries; }
+
+    // Abort the request: the network reply is aborted, or the request
+    // leaves the queue, and no signal is emitted afterwards. A GET which
+    // other identical requests wait for keeps going for them.
+    //
+    // Use it for superseded requests, e.g. after an account switch, then
+    // deleteLater() the request.
+    virtual void cancel();
+
+    // number of GETs which shared the reply of an identical request
+    static quint64 coalescedCount() { return coalesced_count_; }
+
 signals:
     void failed(const ApiError& error);
 
@@ -34,6 +84,11 @@ protected slots:
     void onSslErrors(QNetworkReply *reply, const QList<QSslError>& errors);
     void onNetworkError(const QNetworkReply::NetworkError& error, const QString& error_string);
     void onHttpError(int);
+    void recordTraceEvent();
+
+private slots:
+    void onRequestFinished();
+    void retry();
 
 protected:
     enum Method {
@@ -48,6 +103,9 @@ protected:
 
     json_t* parseJSON(QNetworkReply &reply, json_error_t *error);
 
+    // The body of the reply, decompressed. Read it instead of the reply.
+    const QByteArray& responseBody() const;
+
     // Used with QScopedPointer for json_t
     struct JsonPointerCustomDeleter {
         static inline void cleanup(json_t *json) {
@@ -61,6 +119,19 @@ protected:
 private:
     Q_DISABLE_COPY(SeafileApiRequest)
 
+    friend class RequestScheduler;
+
+    // Actually send the request, called by RequestScheduler
+    void start();
+    void connectApiClient();
+
+    // Returns true if the request will be sent again
+    bool retryOnError(const ApiError& error);
+
+    void followLeader(SeafileApiRequest *leader);
+    // Called when a leader is deleted before its reply arrived
+    void handOverToFollower();
+
     QUrl url_;
     QList<QPair<QString, QString> > params_;
     Method method_;
@@ -68,6 +139,32 @@ private:
     SeafileApiClient* api_client_;
 
     bool ignore_ssl_errors_;
+    bool prompt_ssl_errors_;
+
+    Priority priority_;
+    int deadline_msecs_;
+
+    int max_retries_;
+    // number of retries so far
+    int retries_;
+    // waiting for the backoff delay before being queued again
+    bool retry_pending_;
+
+    // The GETs queued or in flight, by flight_key_
+    static QHash<QString, SeafileApiRequest *> flights_;
+    static quint64 coalesced_count_;
+
+    QString flight_key_;
+    // the request whose result we wait for, NULL if we send our own
+    SeafileApiRequest *leader_;
+    // the requests waiting for our result
+    QList<SeafileApiRequest *> followers_;
+    // the reply (or the network error) has arrived
+    bool finished_;
+    bool cancelled_;
+
+    // when the request was sent, -1 if not recording traces
+    qint64 trace_start_us_;
 };
 
 #endif // SEAFILE_API_REQUEST_H
@@ -0,0 +1,129 @@
+#include <string.h>
+#include <zlib.h>
+
+#include "content-decoder.h"
+
+namespace {
+
+const int kOutputChunkSize = 64 * 1024;
+
+// A 32KB window, +32 detects a gzip or a zlib header
+const int kAutoDetectWindowBits = 15 + 32;
+const int kRawDeflateWindowBits = -15;
+
+bool hasZlibHeader(const QByteArray& data)
+{
+    unsigned char cmf = data[0];
+    unsigned char flg = data[1];
+    return (cmf & 0x0f) == Z_DEFLATED && ((cmf << 8) | flg) % 31 == 0;
+}
+
+} // namespace
+
+ContentDecoder::ContentDecoder()
+    : stream_(NULL),
+      raw_deflate_checked_(false),
+      finished_(false)
+{
+}
+
+ContentDecoder::~ContentDecoder()
+{
+    endStream();
+}
+
+bool ContentDecoder::reset(const QByteArray& content_encoding)
+{
+    endStream();
+    header_.clear();
+    finished_ = false;
+
+    QByteArray encoding = content_encoding.trimmed().toLower();
+    if (encoding.isEmpty() || encoding == "identity") {
+        return true;
+    }
+
+    if (encoding != "gzip" && encoding != "x-gzip" && encoding != "deflate") {
+        return false;
+    }
+
+    raw_deflate_checked_ = encoding != "deflate";
+    return initStream(kAutoDetectWindowBits);
+}
+
+bool ContentDecoder::decode(const QByteArray& chunk, QByteArray *out)
+{
+    if (!stream_) {
+        out->append(chunk);
+        return true;
+    }
+
+    if (chunk.isEmpty() || finished_) {
+        // anything after the end of the stream is ignored
+        return true;
+    }
+
+    QByteArray input = chunk;
+    if (!raw_deflate_checked_) {
+        // the header is two bytes
+        header_.append(chunk);
+        if (header_.size() < 2) {
+            return true;
+        }
+        input = header_;
+        header_.clear();
+
+        raw_deflate_checked_ = true;
+        if (!hasZlibHeader(input)) {
+            endStream();
+            if (!initStream(kRawDeflateWindowBits)) {
+                return false;
+            }
+        }
+    }
+
+    stream_->next_in = (Bytef *)input.constData();
+    stream_->avail_in = input.size();
+
+    do {
+        int size = out->size();
+        out->resize(size + kOutputChunkSize);
+        stream_->next_out = (Bytef *)out->data() + size;
+        stream_->avail_out = kOutputChunkSize;
+
+        int ret = inflate(stream_, Z_NO_FLUSH);
+        out->resize(size + kOutputChunkSize - stream_->avail_out);
+
+        if (ret == Z_STREAM_END) {
+            finished_ = true;
+            return true;
+        }
+        if (ret != Z_OK) {
+            // Z_BUF_ERROR: all the input is consumed, wait for more
+            return ret == Z_BUF_ERROR;
+        }
+    } while (stream_->avail_in > 0 || stream_->avail_out == 0);
+
+    return true;
+}
+
+bool ContentDecoder::initStream(int window_bits)
+{
+    stream_ = new z_stream;
+    memset(stream_, 0, sizeof(z_stream));
+    if (inflateInit2(stream_, window_bits) != Z_OK) {
+        delete stream_;
+        stream_ = NULL;
+        return false;
+    }
+    return true;
+}
+
+void ContentDecoder::endStream()
+{
+    if (stream_) {
+        inflateEnd(stream_);
+        delete stream_;
+        stream_ = NULL;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef SEAFILE_CLIENT_API_CONTENT_DECODER_H
+#define SEAFILE_CLIENT_API_CONTENT_DECODER_H
+
+#include <QByteArray>
+
+struct z_stream_s;
+
+/**
+ * Decompresses a http response body with a "gzip" or "deflate"
+ * Content-Encoding, chunk by chunk as it arrives.
+ */
+class ContentDecoder {
+public:
+    ContentDecoder();
+    ~ContentDecoder();
+
+    // Start decoding a new body. Returns false for an encoding we don't
+    // support; "identity" and an empty encoding are passed through.
+    bool reset(const QByteArray& content_encoding);
+
+    // Append the decoded data of chunk to out. Returns false if the data is
+    // corrupt.
+    bool decode(const QByteArray& chunk, QByteArray *out);
+
+    bool isCompressed() const { return stream_ != NULL; }
+
+    // Whether the end of the compressed stream has been decoded. A body
+    // cut short, e.g. by a dropped connection, decodes fine up to where it
+    // stops, only this tells it apart from a whole one.
+    bool isFinished() const { return finished_; }
+
+private:
+    Q_DISABLE_COPY(ContentDecoder)
+
+    bool initStream(int window_bits);
+    void endStream();
+
+    struct z_stream_s *stream_;
+
+    // Some servers send "deflate" without the zlib header. Decided when
+    // the first two bytes, kept in header_ until then, have arrived.
+    bool raw_deflate_checked_;
+    QByteArray header_;
+
+    bool finished_;
+};
+
+#endif // SEAFILE_CLIENT_API_CONTENT_DECODER_H
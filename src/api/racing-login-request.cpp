@@ -0,0 +1,446 @@
+#include <QTimer>
+#include <QSet>
+#include <QStringList>
+
+#include "seafile-applet.h"
+#include "api-error.h"
+#include "requests.h"
+
+#include "racing-login-request.h"
+
+namespace {
+
+// Between two candidates
+const int kCandidateStaggerMsecs = 300;
+
+// A ping is small, don't wait for too long e.g. when the https port is
+// filtered
+const int kPingDeadlineMsecs = 15 * 1000;
+
+bool isTlsFailure(const ApiError& error)
+{
+    return error.type() == ApiError::SSL_ERROR
+        || (error.type() == ApiError::NETWORK_ERROR
+            && error.networkError() == QNetworkReply::SslHandshakeFailedError);
+}
+
+} // namespace
+
+RacingLoginRequest::RacingLoginRequest(const QString& server_addr,
+                                       const QString& username,
+                                       const QString& password,
+                                       const QString& computer_name)
+    : username_(username),
+      password_(password),
+      computer_name_(computer_name),
+      explicit_http_(server_addr.trimmed().startsWith("http://")),
+      login_req_(NULL),
+      finished_(false)
+{
+    QList<QUrl> urls = candidateUrls(server_addr);
+
+    bool has_prompting = false;
+    for (int i = 0; i < urls.size(); i++) {
+        Candidate candidate;
+        candidate.server_url = urls[i];
+        candidate.delay = kCandidateStaggerMsecs * i;
+        candidate.req = NULL;
+        candidate.wait_for_prompt = false;
+        candidate.failed = false;
+        candidate.error = NULL;
+
+        // All the candidates are of the same host, only one certificate
+        // dialog for it
+        candidate.prompt_ssl_errors = false;
+        if (urls[i].scheme() == "https" && !has_prompting) {
+            candidate.prompt_ssl_errors = true;
+            has_prompting = true;
+        }
+
+        candidates_.append(candidate);
+    }
+}
+
+RacingLoginRequest::~RacingLoginRequest()
+{
+    finish();
+
+    for (int i = 0; i < candidates_.size(); i++) {
+        delete candidates_[i].error;
+    }
+}
+
+QList<QUrl> RacingLoginRequest::candidateUrls(const QString& server_addr)
+{
+    QString addr = server_addr.trimmed();
+    QStringList schemes;
+    if (addr.startsWith("https://")) {
+        schemes << "https";
+    } else if (addr.startsWith("http://")) {
+        schemes << "http";
+    } else {
+        schemes << "https" << "http";
+        addr = "https://" + addr;
+    }
+
+    QList<QUrl> urls;
+
+    QUrl url(addr, QUrl::StrictMode);
+    if (!url.isValid() || url.host().isEmpty()) {
+        return urls;
+    }
+
+    QString path = url.path();
+    while (path.endsWith("/")) {
+        path.chop(1);
+    }
+    QStringList paths;
+    paths << path;
+    if (!path.isEmpty()) {
+        // the path may be a page of the server instead of its root
+        paths << QString();
+    }
+
+    foreach (const QString& scheme, schemes) {
+        foreach (const QString& p, paths) {
+            QUrl candidate(url);
+            candidate.setScheme(scheme);
+            candidate.setPath(p);
+            urls << candidate;
+        }
+    }
+
+    return urls;
+}
+
+void RacingLoginRequest::send()
+{
+    if (candidates_.isEmpty()) {
+        emit failed(ApiError::fromNetworkError(QNetworkReply::ProtocolUnknownError,
+                                               tr("Invalid server address")));
+        return;
+    }
+
+    elapsed_.start();
+
+    QSet<int> delays;
+    for (int i = 0; i < candidates_.size(); i++) {
+        int delay = candidates_[i].delay;
+        if (delay > 0 && !delays.contains(delay)) {
+            delays.insert(delay);
+            QTimer::singleShot(delay, this, SLOT(startDueCandidates()));
+        }
+    }
+
+    startDueCandidates();
+}
+
+void RacingLoginRequest::cancel()
+{
+    finish();
+}
+
+void RacingLoginRequest::startDueCandidates()
+{
+    if (finished_ || login_req_) {
+        return;
+    }
+
+    for (int i = 0; i < candidates_.size(); i++) {
+        const Candidate& candidate = candidates_[i];
+        if (!candidate.req && !candidate.failed && !candidate.wait_for_prompt
+            && candidate.answered_url.isEmpty()
+            && elapsed_.elapsed() >= candidate.delay) {
+            startCandidate(i);
+        }
+    }
+}
+
+// Start the next candidate without waiting for its delay, the one before
+// it has failed
+void RacingLoginRequest::startNextCandidate()
+{
+    for (int i = 0; i < candidates_.size(); i++) {
+        const Candidate& candidate = candidates_[i];
+        if (!candidate.req && !candidate.failed && !candidate.wait_for_prompt
+            && candidate.answered_url.isEmpty()) {
+            startCandidate(i);
+            return;
+        }
+    }
+}
+
+void RacingLoginRequest::startCandidate(int i)
+{
+    Candidate& candidate = candidates_[i];
+
+    PingServerRequest *req = new PingServerRequest(candidate.server_url);
+    req->setIgnoreSslErrors(false);
+    req->setPromptSslErrors(candidate.prompt_ssl_errors);
+    req->setDeadline(kPingDeadlineMsecs);
+    // The race is the retry: a filtered port or a typo must not hold off
+    // the other candidates, nor use up the retry budget of the host
+    req->setMaxRetries(0);
+
+    connect(req, SIGNAL(success()),
+            this, SLOT(onPingSuccess()));
+    connect(req, SIGNAL(failed(const ApiError&)),
+            this, SLOT(onPingFailed(const ApiError&)));
+
+    candidate.req = req;
+    req->send();
+}
+
+int RacingLoginRequest::findBySender() const
+{
+    for (int i = 0; i < candidates_.size(); i++) {
+        if (candidates_[i].req && candidates_[i].req == sender()) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void RacingLoginRequest::onPingSuccess()
+{
+    int i = findBySender();
+    if (i < 0) {
+        return;
+    }
+
+    Candidate& candidate = candidates_[i];
+    candidate.answered_url = candidate.req->serverUrl();
+    if (candidate.answered_url.isEmpty()) {
+        candidate.answered_url = candidate.server_url;
+    }
+    candidate.req->deleteLater();
+    candidate.req = NULL;
+
+    if (candidate.prompt_ssl_errors) {
+        onPromptDone(false);
+    }
+
+    decide();
+}
+
+void RacingLoginRequest::onPingFailed(const ApiError& error)
+{
+    int i = findBySender();
+    if (i < 0) {
+        return;
+    }
+
+    Candidate& candidate = candidates_[i];
+    candidate.req->deleteLater();
+    candidate.req = NULL;
+
+    bool prompting_running = false;
+    for (int j = 0; j < candidates_.size(); j++) {
+        if (candidates_[j].prompt_ssl_errors && candidates_[j].req) {
+            prompting_running = true;
+        }
+    }
+
+    if (!candidate.prompt_ssl_errors && isTlsFailure(error) && prompting_running) {
+        // The certificate may be trusted once the user has answered the
+        // dialog of the prompting candidate, try again after it
+        candidate.wait_for_prompt = true;
+    } else {
+        candidate.failed = true;
+        candidate.error = new ApiError(error);
+    }
+
+    if (candidate.prompt_ssl_errors) {
+        onPromptDone(isTlsFailure(error));
+    }
+
+    startNextCandidate();
+    decide();
+}
+
+void RacingLoginRequest::onPromptDone(bool tls_failed)
+{
+    for (int i = 0; i < candidates_.size(); i++) {
+        Candidate& candidate = candidates_[i];
+        if (!candidate.wait_for_prompt) {
+            continue;
+        }
+        candidate.wait_for_prompt = false;
+        if (tls_failed) {
+            // The certificate was rejected, no use asking again
+            candidate.failed = true;
+        } else if (!finished_ && !login_req_) {
+            startCandidate(i);
+        }
+    }
+}
+
+void RacingLoginRequest::decide()
+{
+    if (finished_ || login_req_) {
+        return;
+    }
+
+    bool https_pending = false;
+    bool https_tls_failed = false;
+    int http_answered = -1;
+    int pending = 0;
+
+    for (int i = 0; i < candidates_.size(); i++) {
+        const Candidate& candidate = candidates_[i];
+        if (!candidate.answered_url.isEmpty()) {
+            // an http candidate redirected to https counts as https
+            if (candidate.answered_url.scheme() == "https") {
+                login(candidate.answered_url);
+                return;
+            }
+            if (http_answered < 0) {
+                http_answered = i;
+            }
+            continue;
+        }
+
+        bool is_https = candidate.server_url.scheme() == "https";
+        if (!candidate.failed) {
+            pending++;
+            https_pending = https_pending || is_https;
+        } else if (is_https && candidate.error && isTlsFailure(*candidate.error)) {
+            https_tls_failed = true;
+        }
+    }
+
+    if (http_answered >= 0 && !https_pending) {
+        if (https_tls_failed) {
+            // Never fall back to http because of a bad certificate, that's
+            // just what a man in the middle would want
+            fail(*bestError());
+            return;
+        }
+
+        QUrl server_url = candidates_[http_answered].answered_url;
+        finishPings();
+        if (explicit_http_ || confirmPlainHttp(server_url)) {
+            if (!finished_) {
+                login(server_url);
+            }
+        } else {
+            fail(*bestError());
+        }
+        return;
+    }
+
+    if (pending == 0 && http_answered < 0) {
+        fail(*bestError());
+    }
+}
+
+bool RacingLoginRequest::confirmPlainHttp(const QUrl& url) const
+{
+    if (seafApplet->headless()) {
+        return false;
+    }
+
+    QString msg = tr("%1 can only be reached without encryption (http), "
+                     "your password would be sent in clear text.\n"
+                     "Log in anyway?").arg(url.host());
+    return seafApplet->yesOrNoBox(msg, NULL, false);
+}
+
+void RacingLoginRequest::login(const QUrl& server_url)
+{
+    finishPings();
+
+    qDebug("logging in with %s", server_url.toString().toUtf8().data());
+
+    login_req_ = new LoginRequest(server_url, username_, password_, computer_name_);
+    // The certificate, if any, has been accepted when pinging
+    login_req_->setIgnoreSslErrors(false);
+
+    connect(login_req_, SIGNAL(success(const QString&)),
+            this, SLOT(onLoginSuccess(const QString&)));
+    connect(login_req_, SIGNAL(failed(const ApiError&)),
+            this, SLOT(onLoginFailed(const ApiError&)));
+
+    login_req_->send();
+}
+
+void RacingLoginRequest::onLoginSuccess(const QString& token)
+{
+    if (sender() != login_req_) {
+        return;
+    }
+
+    QUrl server_url = login_req_->serverUrl();
+
+    finish();
+    emit success(server_url, token);
+}
+
+void RacingLoginRequest::onLoginFailed(const ApiError& error)
+{
+    if (sender() != login_req_) {
+        return;
+    }
+
+    fail(error);
+}
+
+void RacingLoginRequest::fail(const ApiError& error)
+{
+    ApiError last_error(error);
+    finish();
+    emit failed(last_error);
+}
+
+// An http error (except 404) tells the most about what went wrong,
+// then a tls failure, otherwise report the error of the address the user
+// typed
+const ApiError *RacingLoginRequest::bestError() const
+{
+    for (int i = 0; i < candidates_.size(); i++) {
+        const ApiError *error = candidates_[i].error;
+        if (error && error->type() == ApiError::HTTP_ERROR && error->httpErrorCode() != 404) {
+            return error;
+        }
+    }
+    for (int i = 0; i < candidates_.size(); i++) {
+        const ApiError *error = candidates_[i].error;
+        if (error && isTlsFailure(*error)) {
+            return error;
+        }
+    }
+    for (int i = 0; i < candidates_.size(); i++) {
+        if (candidates_[i].error) {
+            return candidates_[i].error;
+        }
+    }
+
+    static ApiError no_server = ApiError::fromJsonError();
+    return &no_server;
+}
+
+void RacingLoginRequest::finishPings()
+{
+    for (int i = 0; i < candidates_.size(); i++) {
+        PingServerRequest *req = candidates_[i].req;
+        if (req) {
+            req->cancel();
+            req->deleteLater();
+            candidates_[i].req = NULL;
+        }
+        candidates_[i].wait_for_prompt = false;
+    }
+}
+
+void RacingLoginRequest::finish()
+{
+    finished_ = true;
+
+    finishPings();
+
+    if (login_req_) {
+        login_req_->cancel();
+        login_req_->deleteLater();
+        login_req_ = NULL;
+    }
+}
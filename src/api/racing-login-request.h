@@ -0,0 +1,105 @@
+#ifndef SEAFILE_CLIENT_API_RACING_LOGIN_REQUEST_H
+#define SEAFILE_CLIENT_API_RACING_LOGIN_REQUEST_H
+
+#include <QObject>
+#include <QList>
+#include <QUrl>
+#include <QString>
+#include <QElapsedTimer>
+
+class ApiError;
+class LoginRequest;
+class PingServerRequest;
+
+/**
+ * Logs in to a server address as typed by the user, which may lack the
+ * scheme or have a wrong path, by pinging the candidate server urls at the
+ * same time instead of one after the other.
+ *
+ * The pings carry no credentials. The candidates (https before http for a
+ * bare host name, the typed path before the root) are started a short while
+ * apart, each as soon as the previous one fails. The password is then only
+ * sent to the url that answered:
+ *
+ * - the first https url to answer wins at once;
+ * - an http url only wins once all the https ones have failed, never if
+ *   one of them failed on tls (e.g. a rejected certificate), and only if
+ *   the user typed "http://" or agrees to send the password unencrypted.
+ *
+ * The certificate dialog is shown at most once: only the first https
+ * candidate may prompt, the others are retried quietly once it's answered.
+ */
+class RacingLoginRequest : public QObject {
+    Q_OBJECT
+public:
+    RacingLoginRequest(const QString& server_addr,
+                       const QString& username,
+                       const QString& password,
+                       const QString& computer_name);
+    ~RacingLoginRequest();
+
+    // The server urls tried for what the user typed, empty if it isn't a
+    // valid address
+    static QList<QUrl> candidateUrls(const QString& server_addr);
+
+    void send();
+
+    // No signal is emitted afterwards
+    void cancel();
+
+signals:
+    // server_url is where the token came from, to be saved in the account
+    void success(const QUrl& server_url, const QString& token);
+    void failed(const ApiError& error);
+
+private slots:
+    void onPingSuccess();
+    void onPingFailed(const ApiError& error);
+    void onLoginSuccess(const QString& token);
+    void onLoginFailed(const ApiError& error);
+    void startDueCandidates();
+
+private:
+    Q_DISABLE_COPY(RacingLoginRequest)
+
+    struct Candidate {
+        QUrl server_url;
+        // msecs after send()
+        int delay;
+        bool prompt_ssl_errors;
+        PingServerRequest *req;
+        // quiet tls failure, to retry once the prompting one is done
+        bool wait_for_prompt;
+        bool failed;
+        ApiError *error;
+        // where the ping was answered from, empty until then
+        QUrl answered_url;
+    };
+
+    void startCandidate(int i);
+    void startNextCandidate();
+    void onPromptDone(bool tls_failed);
+    int findBySender() const;
+    void decide();
+    bool confirmPlainHttp(const QUrl& url) const;
+    void login(const QUrl& server_url);
+    void fail(const ApiError& error);
+    void finishPings();
+    void finish();
+    const ApiError *bestError() const;
+
+    QString username_;
+    QString password_;
+    QString computer_name_;
+
+    // the user typed "http://" themselves
+    bool explicit_http_;
+
+    QList<Candidate> candidates_;
+    LoginRequest *login_req_;
+
+    QElapsedTimer elapsed_;
+    bool finished_;
+};
+
+#endif // SEAFILE_CLIENT_API_RACING_LOGIN_REQUEST_H
@@ -0,0 +1,250 @@
+#include "utils/trace.h"
+
+#include "request-scheduler.h"
+
+namespace {
+
+// QNetworkAccessManager opens at most 6 connections to a host
+const int kMaxInFlightPerHost = 6;
+const int kMaxRefreshPerHost = 4;
+const int kMaxBackgroundPerHost = 2;
+
+// Up to one retry for every 5 requests, plus a burst of 10
+const double kRetryBudgetRatio = 0.2;
+const double kMaxRetryBudget = 10;
+
+} // namespace
+
+RequestScheduler* RequestScheduler::singleton_;
+
+RequestScheduler* RequestScheduler::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new RequestScheduler;
+    }
+
+    return singleton_;
+}
+
+RequestScheduler::RequestScheduler()
+    : scheduling_(false),
+      retries_count_(0),
+      retries_denied_count_(0)
+{
+}
+
+RequestScheduler::Host::Host()
+    : retry_budget(kMaxRetryBudget)
+{
+    for (int i = 0; i < SeafileApiRequest::N_PRIORITIES; i++) {
+        in_flight[i] = 0;
+    }
+}
+
+QString RequestScheduler::hostKey(const SeafileApiRequest *req)
+{
+    const QUrl& url = req->url();
+    return QString("%1://%2:%3").arg(url.scheme()).arg(url.host())
+        .arg(url.port(url.scheme() == "https" ? 443 : 80));
+}
+
+SeafileApiRequest *RequestScheduler::Queue::takeNext()
+{
+    if (groups.isEmpty()) {
+        return NULL;
+    }
+
+    next_group %= groups.size();
+    QString group = groups[next_group];
+    QList<SeafileApiRequest *>& reqs = waiting[group];
+    SeafileApiRequest *req = reqs.takeFirst();
+
+    if (reqs.isEmpty()) {
+        waiting.remove(group);
+        groups.removeAt(next_group);
+    } else {
+        next_group++;
+    }
+
+    return req;
+}
+
+bool RequestScheduler::Queue::remove(SeafileApiRequest *req)
+{
+    for (int i = 0; i < groups.size(); i++) {
+        QList<SeafileApiRequest *>& reqs = waiting[groups[i]];
+        if (reqs.removeOne(req)) {
+            if (reqs.isEmpty()) {
+                waiting.remove(groups[i]);
+                groups.removeAt(i);
+                if (next_group > i) {
+                    next_group--;
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RequestScheduler::Queue::replace(SeafileApiRequest *req, SeafileApiRequest *by)
+{
+    QHash<QString, QList<SeafileApiRequest *> >::iterator it;
+    for (it = waiting.begin(); it != waiting.end(); ++it) {
+        int i = it.value().indexOf(req);
+        if (i >= 0) {
+            it.value()[i] = by;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RequestScheduler::enqueue(SeafileApiRequest *req)
+{
+    QString key = hostKey(req);
+    Host& host = hosts_[key];
+    Queue& queue = host.queues[req->priority()];
+
+    if (req->retries_ == 0) {
+        host.retry_budget = qMin(kMaxRetryBudget, host.retry_budget + kRetryBudgetRatio);
+    }
+
+    QString group = req->metaObject()->className();
+    if (!queue.waiting.contains(group)) {
+        queue.groups.append(group);
+    }
+    queue.waiting[group].append(req);
+
+    schedule(key);
+}
+
+bool RequestScheduler::canStart(const Host& host, SeafileApiRequest::Priority priority) const
+{
+    int total = 0;
+    int refresh_or_lower = 0;
+    for (int i = 0; i < SeafileApiRequest::N_PRIORITIES; i++) {
+        total += host.in_flight[i];
+        if (i >= SeafileApiRequest::PRIORITY_REFRESH) {
+            refresh_or_lower += host.in_flight[i];
+        }
+    }
+
+    if (total >= kMaxInFlightPerHost) {
+        return false;
+    }
+
+    switch (priority) {
+    case SeafileApiRequest::PRIORITY_INTERACTIVE:
+        return true;
+    case SeafileApiRequest::PRIORITY_REFRESH:
+        return refresh_or_lower < kMaxRefreshPerHost;
+    default:
+        return refresh_or_lower < kMaxRefreshPerHost
+            && host.in_flight[SeafileApiRequest::PRIORITY_BACKGROUND] < kMaxBackgroundPerHost;
+    }
+}
+
+void RequestScheduler::schedule(const QString& key)
+{
+    pending_hosts_.insert(key);
+    if (scheduling_) {
+        return;
+    }
+
+    scheduling_ = true;
+    while (!pending_hosts_.isEmpty()) {
+        QSet<QString>::iterator it = pending_hosts_.begin();
+        QString next = *it;
+        pending_hosts_.erase(it);
+        startRequests(next);
+    }
+    scheduling_ = false;
+}
+
+void RequestScheduler::startRequests(const QString& key)
+{
+    // The most urgent requests first. hosts_ is looked up again after each
+    // start(), since the slots connected to the request may change it.
+    for (int i = 0; i < SeafileApiRequest::N_PRIORITIES; i++) {
+        SeafileApiRequest::Priority priority = (SeafileApiRequest::Priority)i;
+        while (!hosts_[key].queues[i].isEmpty() && canStart(hosts_[key], priority)) {
+            Host& host = hosts_[key];
+            SeafileApiRequest *req = host.queues[i].takeNext();
+            host.in_flight[i]++;
+            in_flight_[req] = key;
+            SEAFILE_TRACE(TRACE_API, "starting %s (priority %d)",
+                          req->metaObject()->className(), i);
+            req->start();
+        }
+    }
+}
+
+void RequestScheduler::requestFinished(SeafileApiRequest *req)
+{
+    if (!in_flight_.contains(req)) {
+        return;
+    }
+
+    QString key = in_flight_.take(req);
+    hosts_[key].in_flight[req->priority()]--;
+
+    schedule(key);
+}
+
+void RequestScheduler::remove(SeafileApiRequest *req)
+{
+    if (in_flight_.contains(req)) {
+        requestFinished(req);
+        return;
+    }
+
+    QString key = hostKey(req);
+    if (hosts_.contains(key)) {
+        hosts_[key].queues[req->priority()].remove(req);
+    }
+}
+
+bool RequestScheduler::replace(SeafileApiRequest *req, SeafileApiRequest *by)
+{
+    if (in_flight_.contains(req)) {
+        in_flight_[by] = in_flight_.take(req);
+        return true;
+    }
+
+    QString key = hostKey(req);
+    if (hosts_.contains(key)) {
+        hosts_[key].queues[req->priority()].replace(req, by);
+    }
+    return false;
+}
+
+bool RequestScheduler::takeRetryToken(SeafileApiRequest *req)
+{
+    Host& host = hosts_[hostKey(req)];
+    if (host.retry_budget < 1) {
+        retries_denied_count_++;
+        return false;
+    }
+
+    host.retry_budget -= 1;
+    retries_count_++;
+    return true;
+}
+
+int RequestScheduler::queuedCount(SeafileApiRequest::Priority priority) const
+{
+    int count = 0;
+    foreach (const Host& host, hosts_) {
+        const Queue& queue = host.queues[priority];
+        foreach (const QList<SeafileApiRequest *>& reqs, queue.waiting) {
+            count += reqs.size();
+        }
+    }
+    return count;
+}
+
+int RequestScheduler::inFlightCount() const
+{
+    return in_flight_.size();
+}
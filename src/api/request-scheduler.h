@@ -0,0 +1,101 @@
+#ifndef SEAFILE_CLIENT_API_REQUEST_SCHEDULER_H
+#define SEAFILE_CLIENT_API_REQUEST_SCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include "api-request.h"
+
+/**
+ * Decides when the api requests are sent. SeafileApiRequest::send() queues
+ * the request here instead of sending it right away.
+ *
+ * Each server gets at most kMaxInFlightPerHost requests at a time, the
+ * number of connections QNetworkAccessManager opens to a host. Some slots are
+ * kept for the more urgent priorities: background requests (e.g. avatars)
+ * may use at most kMaxBackgroundPerHost of them, and background plus refresh
+ * requests at most kMaxRefreshPerHost. So an interactive request (login,
+ * download info) never waits behind a burst of avatar fetches.
+ *
+ * Within a priority, the waiting requests are grouped by their class and
+ * the groups are served in turn, so one kind of request can't starve the
+ * others.
+ */
+class RequestScheduler : public QObject {
+    Q_OBJECT
+public:
+    static RequestScheduler* instance();
+
+    // called by SeafileApiRequest
+    void enqueue(SeafileApiRequest *req);
+    void requestFinished(SeafileApiRequest *req);
+    void remove(SeafileApiRequest *req);
+    // Give the place of req, queued or in flight, to another request of the
+    // same class. Returns true if req was in flight.
+    bool replace(SeafileApiRequest *req, SeafileApiRequest *by);
+
+    // Take one retry from the budget of the request's server. The budget
+    // grows by kRetryBudgetRatio with every new request and holds at most
+    // kMaxRetryBudget retries, so a server which is down gets a bounded
+    // amount of retries instead of a multiple of the normal traffic.
+    bool takeRetryToken(SeafileApiRequest *req);
+
+    int queuedCount(SeafileApiRequest::Priority priority) const;
+    int inFlightCount() const;
+    quint64 retriesCount() const { return retries_count_; }
+    quint64 retriesDeniedCount() const { return retries_denied_count_; }
+
+private:
+    Q_DISABLE_COPY(RequestScheduler)
+
+    RequestScheduler();
+
+    // The requests waiting for one host and one priority, grouped by class
+    struct Queue {
+        QList<QString> groups;
+        QHash<QString, QList<SeafileApiRequest *> > waiting;
+        // index in groups of the group served next
+        int next_group;
+
+        Queue() : next_group(0) {}
+        bool isEmpty() const { return groups.isEmpty(); }
+        SeafileApiRequest *takeNext();
+        bool remove(SeafileApiRequest *req);
+        bool replace(SeafileApiRequest *req, SeafileApiRequest *by);
+    };
+
+    struct Host {
+        Queue queues[SeafileApiRequest::N_PRIORITIES];
+        // requests in flight of each priority
+        int in_flight[SeafileApiRequest::N_PRIORITIES];
+        double retry_budget;
+
+        Host();
+    };
+
+    static QString hostKey(const SeafileApiRequest *req);
+
+    bool canStart(const Host& host, SeafileApiRequest::Priority priority) const;
+    void schedule(const QString& key);
+    void startRequests(const QString& key);
+
+    static RequestScheduler *singleton_;
+
+    QHash<QString, Host> hosts_;
+
+    // the host of each request in flight
+    QHash<SeafileApiRequest *, QString> in_flight_;
+
+    // A request may finish, or a new one be queued, while we are starting
+    // requests. The hosts to look at again are kept here.
+    QSet<QString> pending_hosts_;
+    bool scheduling_;
+
+    quint64 retries_count_;
+    quint64 retries_denied_count_;
+};
+
+#endif // SEAFILE_CLIENT_API_REQUEST_SCHEDULER_H
@@ -8,6 +8,8 @@
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
 #include "utils/utils.h"
+#include "utils/string-pool.h"
+#include "utils/trace.h"
 #include "api-error.h"
 #include "server-repo.h"
 #include "starred-file.h"
@@ -28,6 +30,8 @@ const char *kGetEventsUrl = "api2/events/";
 const char *kCommitDetailsUrl = "api2/repo_history_changes/";
 const char *kAvatarUrl = "api2/avatars/user/";
 const char *kSetRepoPasswordUrl = "api2/repos/";
+const char *kServerInfoUrl = "api2/server-info/";
+const char *kPingUrl = "api2/ping/";
 
 const char *kLatestVersionUrl = "http://seafile.com/api/client-versions/";
 
@@ -39,6 +43,23 @@ const char *kOsName = "linux";
 const char *kOsName = "mac";
 #endif
 
+// The server url a reply came from, after any redirection, e.g.
+// "https://example.com/seafile/api2/auth-token/" gives
+// "https://example.com/seafile"
+QUrl serverUrlOfReply(const QNetworkReply& reply, const char *api_url)
+{
+    QUrl server_url = reply.url();
+    QString path = server_url.path();
+    if (path.endsWith(api_url)) {
+        path.chop(QString(api_url).size());
+        if (path.endsWith("/")) {
+            path.chop(1);
+        }
+        server_url.setPath(path);
+    }
+    return server_url;
+}
+
 } // namespace
 
 
@@ -53,6 +74,7 @@ LoginRequest::LoginRequest(const QUrl& serverAddr,
     : SeafileApiRequest (::urlJoin(serverAddr, kApiLoginUrl),
                          SeafileApiRequest::METHOD_POST)
 {
+    setPriority(PRIORITY_INTERACTIVE);
     setParam("username", username);
     setParam("password", password);
 
@@ -87,6 +109,8 @@ void LoginRequest::requestSuccess(QNetworkReply& reply)
 
     qDebug("login successful, token is %s\n", token);
 
+    server_url_ = serverUrlOfReply(reply, kApiLoginUrl);
+
     emit success(token);
 }
 
@@ -113,6 +137,10 @@ void ListReposRequest::requestSuccess(QNetworkReply& reply)
     QScopedPointer<json_t, JsonPointerCustomDeleter> json(root);
 
     std::vector<ServerRepo> repos = ServerRepo::listFromJSON(json.data(), &error);
+
+    SEAFILE_TRACE(TRACE_API, "%u libraries listed, %d interned strings",
+                  (unsigned)repos.size(), StringPool::instance()->size());
+
     emit success(repos);
 }
 
@@ -124,6 +152,7 @@ DownloadRepoRequest::DownloadRepoRequest(const Account& account, const QString&
     : SeafileApiRequest(account.getAbsoluteUrl("api2/repos/" + repo_id + "/download-info/"),
                         SeafileApiRequest::METHOD_GET, account.token)
 {
+    setPriority(PRIORITY_INTERACTIVE);
 }
 
 RepoDownloadInfo RepoDownloadInfo::fromDict(QMap<QString, QVariant>& dict)
@@ -172,6 +201,7 @@ CreateRepoRequest::CreateRepoRequest(const Account& account, QString &name, QStr
     : SeafileApiRequest (account.getAbsoluteUrl(kCreateRepoUrl),
                          SeafileApiRequest::METHOD_POST, account.token)
 {
+    setPriority(PRIORITY_INTERACTIVE);
     this->setParam(QString("name"), name);
     this->setParam(QString("desc"), desc);
     if (!passwd.isNull()) {
@@ -205,6 +235,7 @@ GetUnseenSeahubNotificationsRequest::GetUnseenSeahubNotificationsRequest(const A
     : SeafileApiRequest (account.getAbsoluteUrl(kUnseenMessagesUrl),
                          SeafileApiRequest::METHOD_GET, account.token)
 {
+    setPriority(PRIORITY_BACKGROUND);
 }
 
 void GetUnseenSeahubNotificationsRequest::requestSuccess(QNetworkReply& reply)
@@ -234,6 +265,7 @@ GetDefaultRepoRequest::GetDefaultRepoRequest(const Account& account)
     : SeafileApiRequest (account.getAbsoluteUrl(kDefaultRepoUrl),
                          SeafileApiRequest::METHOD_GET, account.token)
 {
+    setPriority(PRIORITY_INTERACTIVE);
 }
 
 void GetDefaultRepoRequest::requestSuccess(QNetworkReply& reply)
@@ -276,6 +308,7 @@ CreateDefaultRepoRequest::CreateDefaultRepoRequest(const Account& account)
     : SeafileApiRequest (account.getAbsoluteUrl(kDefaultRepoUrl),
                          SeafileApiRequest::METHOD_POST, account.token)
 {
+    setPriority(PRIORITY_INTERACTIVE);
 }
 
 void CreateDefaultRepoRequest::requestSuccess(QNetworkReply& reply)
@@ -304,6 +337,7 @@ GetLatestVersionRequest::GetLatestVersionRequest(const QString& client_id,
                                                  const QString& client_version)
     : SeafileApiRequest(QUrl(kLatestVersionUrl), SeafileApiRequest::METHOD_GET)
 {
+    setPriority(PRIORITY_BACKGROUND);
     setParam("id", client_id.left(8));
     setParam("v", QString(kOsName) + "-" + client_version);
 }
@@ -395,6 +429,7 @@ GetCommitDetailsRequest::GetCommitDetailsRequest(const Account& account,
     : SeafileApiRequest (account.getAbsoluteUrl(kCommitDetailsUrl + repo_id + "/"),
                          SeafileApiRequest::METHOD_GET, account.token)
 {
+    setPriority(PRIORITY_INTERACTIVE);
     setParam("commit_id", commit_id);
 }
 
@@ -425,6 +460,7 @@ GetAvatarRequest::GetAvatarRequest(const Account& account,
                              + QString::number(size) + "/"),
                          SeafileApiRequest::METHOD_GET, account.token)
 {
+    setPriority(PRIORITY_BACKGROUND);
     account_ = account;
     email_ = email;
     fetch_img_req_ = 0;
@@ -437,6 +473,14 @@ GetAvatarRequest::~GetAvatarRequest()
     }
 }
 
+void GetAvatarRequest::cancel()
+{
+    if (fetch_img_req_) {
+        fetch_img_req_->cancel();
+    }
+    SeafileApiRequest::cancel();
+}
+
 void GetAvatarRequest::requestSuccess(QNetworkReply& reply)
 {
     json_error_t error;
@@ -471,12 +515,13 @@ void GetAvatarRequest::requestSuccess(QNetworkReply& reply)
 FetchImageRequest::FetchImageRequest(const QString& img_url)
     : SeafileApiRequest(QUrl(img_url), SeafileApiRequest::METHOD_GET)
 {
+    setPriority(PRIORITY_BACKGROUND);
 }
 
 void FetchImageRequest::requestSuccess(QNetworkReply& reply)
 {
     QImage img;
-    img.loadFromData(reply.readAll());
+    img.loadFromData(responseBody());
 
     if (img.isNull()) {
         qDebug("FetchImageRequest: invalid image data\n");
@@ -492,6 +537,7 @@ SetRepoPasswordRequest::SetRepoPasswordRequest(const Account& account,
     : SeafileApiRequest (account.getAbsoluteUrl(kSetRepoPasswordUrl + repo_id + "/"),
                          SeafileApiRequest::METHOD_POST, account.token)
 {
+    setPriority(PRIORITY_INTERACTIVE);
     setParam("password", password);
 }
 
@@ -499,3 +545,59 @@ void SetRepoPasswordRequest::requestSuccess(QNetworkReply& reply)
 {
     emit success();
 }
+
+GetServerInfoRequest::GetServerInfoRequest(const QUrl& server_url)
+    : SeafileApiRequest (::urlJoin(server_url, kServerInfoUrl),
+                         SeafileApiRequest::METHOD_GET),
+      server_url_(server_url)
+{
+    setPriority(PRIORITY_BACKGROUND);
+}
+
+void GetServerInfoRequest::requestSuccess(QNetworkReply& reply)
+{
+    json_error_t error;
+    json_t *root = parseJSON(reply, &error);
+    if (!root) {
+        qDebug("GetServerInfoRequest: failed to parse json:%s\n", error.text);
+        emit failed(ApiError::fromJsonError());
+        return;
+    }
+
+    QScopedPointer<json_t, JsonPointerCustomDeleter> json(root);
+
+    ServerInfo info;
+    info.version = QString::fromUtf8(json_string_value(json_object_get(json.data(), "version")));
+
+    json_t *features = json_object_get(json.data(), "features");
+    for (size_t i = 0; i < json_array_size(features); i++) {
+        const char *feature = json_string_value(json_array_get(features, i));
+        if (feature) {
+            info.features << QString::fromUtf8(feature);
+        }
+    }
+
+    emit success(info);
+}
+
+/**
+ * PingServerRequest
+ */
+PingServerRequest::PingServerRequest(const QUrl& server_url)
+    : SeafileApiRequest (::urlJoin(server_url, kPingUrl),
+                         SeafileApiRequest::METHOD_GET)
+{
+}
+
+void PingServerRequest::requestSuccess(QNetworkReply& reply)
+{
+    // Any web server may answer 200 for an unknown path
+    if (!responseBody().contains("pong")) {
+        emit failed(ApiError::fromJsonError());
+        return;
+    }
+
+    server_url_ = serverUrlOfReply(reply, kPingUrl);
+
+    emit success();
+}
@@ -6,6 +6,7 @@
 
 #include "api-request.h"
 #include "server-repo.h"
+#include "server-info.h"
 #include "account.h"
 
 class QNetworkReply;
@@ -26,6 +27,10 @@ public:
                  const QString& password,
                  const QString& computer_name);
 
+    // The server address the token came from, after following the
+    // redirects. Valid once success is emitted.
+    const QUrl& serverUrl() const { return server_url_; }
+
 protected slots:
     void requestSuccess(QNetworkReply& reply);
 
@@ -34,6 +39,8 @@ signals:
 
 private:
     Q_DISABLE_COPY(LoginRequest)
+
+    QUrl server_url_;
 };
 
 
@@ -239,6 +246,8 @@ public:
 
     ~GetAvatarRequest();
 
+    void cancel();
+
     const QString& email() const { return email_; }
     const Account& account() const { return account_; }
 
@@ -275,4 +284,45 @@ private:
     Q_DISABLE_COPY(SetRepoPasswordRequest);
 };
 
+class GetServerInfoRequest : public SeafileApiRequest {
+    Q_OBJECT
+public:
+    explicit GetServerInfoRequest(const QUrl& server_url);
+
+    const QUrl& serverUrl() const { return server_url_; }
+
+signals:
+    void success(const ServerInfo& info);
+
+protected slots:
+    void requestSuccess(QNetworkReply& reply);
+
+private:
+    Q_DISABLE_COPY(GetServerInfoRequest);
+
+    QUrl server_url_;
+};
+
+// Tells whether a seafile server answers at the url, without any
+// credentials
+class PingServerRequest : public SeafileApiRequest {
+    Q_OBJECT
+public:
+    explicit PingServerRequest(const QUrl& server_url);
+
+    // Where the answer came from, after any redirection
+    const QUrl& serverUrl() const { return server_url_; }
+
+signals:
+    void success();
+
+protected slots:
+    void requestSuccess(QNetworkReply& reply);
+
+private:
+    Q_DISABLE_COPY(PingServerRequest);
+
+    QUrl server_url_;
+};
+
 #endif // SEAFILE_CLIENT_API_REQUESTS_H
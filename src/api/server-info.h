@@ -0,0 +1,41 @@
+#ifndef SEAFILE_CLIENT_API_SERVER_INFO_H
+#define SEAFILE_CLIENT_API_SERVER_INFO_H
+
+#include <QString>
+#include <QStringList>
+#include <QMetaType>
+
+/**
+ * What a seahub server supports, from api2/server-info/ and from the
+ * answers to the apis not every server has.
+ */
+class ServerInfo {
+public:
+    enum Support {
+        SUPPORT_UNKNOWN = 0,
+        SUPPORTED,
+        NOT_SUPPORTED
+    };
+
+    ServerInfo()
+        : events(SUPPORT_UNKNOWN),
+          timestamp(0) {}
+
+    // Empty if the server is too old to have api2/server-info/
+    QString version;
+    QStringList features;
+
+    // api2/events/, only in the professional edition
+    Support events;
+
+    // Time it was last fetched from the server (msecs since epoch)
+    qint64 timestamp;
+
+    bool isValid() const { return timestamp > 0; }
+
+    bool hasFeature(const QString& feature) const { return features.contains(feature); }
+};
+
+Q_DECLARE_METATYPE(ServerInfo)
+
+#endif // SEAFILE_CLIENT_API_SERVER_INFO_H
@@ -1,40 +1,90 @@
 #include <vector>
 #include <jansson.h>
 #include <QPixmap>
+#include <glib.h>
+
+#include "utils/string-pool.h"
 
 #include "server-repo.h"
 
 namespace {
 
+const char *kRepoTypePersonal = "repo";
+const char *kRepoTypeShared = "srepo";
+const char *kRepoTypeGroup = "grepo";
+
 QString getStringFromJson(const json_t *json, const char* key)
 {
     return QString::fromUtf8(json_string_value(json_object_get(json, key)));
 }
 
+// Used for the fields which are known to be ascii, e.g. ids
+QString getLatin1StringFromJson(const json_t *json, const char* key)
+{
+    return QString::fromLatin1(json_string_value(json_object_get(json, key)));
+}
+
+QString getInternedStringFromJson(const json_t *json, const char* key)
+{
+    return StringPool::instance()->intern(json_string_value(json_object_get(json, key)));
+}
+
 } // namespace
 
 
+ServerRepo::RepoType ServerRepo::typeFromString(const char *type)
+{
+    if (g_strcmp0(type, kRepoTypePersonal) == 0) {
+        return TYPE_PERSONAL;
+    } else if (g_strcmp0(type, kRepoTypeShared) == 0) {
+        return TYPE_SHARED;
+    } else if (g_strcmp0(type, kRepoTypeGroup) == 0) {
+        return TYPE_GROUP;
+    }
+
+    return TYPE_UNKNOWN;
+}
+
+const char *ServerRepo::typeToString(RepoType type)
+{
+    switch (type) {
+    case TYPE_PERSONAL:
+        return kRepoTypePersonal;
+    case TYPE_SHARED:
+        return kRepoTypeShared;
+    case TYPE_GROUP:
+        return kRepoTypeGroup;
+    default:
+        break;
+    }
+
+    return "";
+}
+
 ServerRepo ServerRepo::fromJSON(const json_t *json, json_error_t */* error */)
 {
     ServerRepo repo;
-    repo.id = getStringFromJson(json, "id");
+    repo.id = getLatin1StringFromJson(json, "id");
     repo.name = getStringFromJson(json, "name");
     repo.description = getStringFromJson(json, "desc");
 
     repo.mtime = json_integer_value(json_object_get(json, "mtime"));
     repo.size = json_integer_value(json_object_get(json, "size"));
-    repo.root = getStringFromJson(json, "root");
+    repo.root = getLatin1StringFromJson(json, "root");
 
     repo.encrypted = json_is_true(json_object_get(json, "encrypted"));
 
-    repo.type = getStringFromJson(json, "type");
-    repo.owner = getStringFromJson(json, "owner");
-    repo.permission = getStringFromJson(json, "permission");
-    repo.readonly = (repo.permission == "r") ? true : false;
+    repo.type = typeFromString(json_string_value(json_object_get(json, "type")));
+    repo.owner = getInternedStringFromJson(json, "owner");
+
+    const char *permission = json_string_value(json_object_get(json, "permission"));
+    repo.permission = g_strcmp0(permission, "r") == 0
+        ? PERMISSION_READ_ONLY : PERMISSION_READ_WRITE;
+    repo.readonly = repo.permission == PERMISSION_READ_ONLY;
 
     repo._virtual = json_is_true(json_object_get(json, "virtual"));
 
-    if (repo.type == "grepo") {
+    if (repo.type == TYPE_GROUP) {
         repo.group_name = repo.owner;
         repo.group_id = json_integer_value(json_object_get(json, "groupid"));
     }
@@ -45,9 +95,10 @@ ServerRepo ServerRepo::fromJSON(const json_t *json, json_error_t */* error */)
 std::vector<ServerRepo> ServerRepo::listFromJSON(const json_t *json, json_error_t *error)
 {
     std::vector<ServerRepo> repos;
-    for (size_t i = 0; i < json_array_size(json); i++) {
-        ServerRepo repo = fromJSON(json_array_get(json, i), error);
-        repos.push_back(repo);
+    size_t n = json_array_size(json);
+    repos.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        repos.push_back(fromJSON(json_array_get(json, i), error));
     }
 
     return repos;
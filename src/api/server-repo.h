@@ -8,20 +8,54 @@
 #include <QPixmap>
 #include <jansson.h>
 
+#include "utils/repo-id.h"
+
 /**
  * Repo information from seahub api
+ *
+ * An account may have tens of thousands of libraries, so the fields are
+ * laid out to keep each instance small: the low-cardinality fields (type,
+ * permission) are stored as enums, and the strings repeated across many
+ * libraries (owner, group name) are interned in the StringPool.
  */
 class ServerRepo {
 public:
-    ServerRepo(){};
+    enum RepoType {
+        TYPE_PERSONAL = 0,      // "repo"
+        TYPE_SHARED,            // "srepo"
+        TYPE_GROUP,             // "grepo"
+        TYPE_UNKNOWN
+    };
+
+    enum Permission {
+        PERMISSION_READ_WRITE = 0, // "rw"
+        PERMISSION_READ_ONLY       // "r"
+    };
+
+    ServerRepo()
+        : mtime(0),
+          size(0),
+          group_id(0),
+          type(TYPE_UNKNOWN),
+          permission(PERMISSION_READ_WRITE),
+          encrypted(false),
+          readonly(false),
+          _virtual(false) {}
+
+    qint64 mtime;
+    qint64  size;
 
     QString id;
     QString name;
     QString description;
-
-    qint64 mtime;
-    qint64  size;
     QString root;
+    QString owner;
+    QString group_name;
+
+    int group_id;
+
+    quint8 type;
+    quint8 permission;
 
     bool encrypted;
     bool readonly;
@@ -29,25 +63,28 @@ public:
     // "virtual" is a reserved word in C++
     bool _virtual;
 
-    QString type;
-    QString owner;
-    QString permission;
-    QString group_name;
-    int group_id;
+    // The account this repo was listed for, see RepoService::accountKey().
+    // All the repos of an account share the same string data.
+    QString account;
 
     bool isValid() const { return !id.isEmpty(); }
 
-    bool isPersonalRepo() const { return type == "repo"; }
-    bool isSharedRepo() const { return type == "srepo"; }
-    bool isGroupRepo() const { return type == "grepo"; }
+    bool isPersonalRepo() const { return type == TYPE_PERSONAL; }
+    bool isSharedRepo() const { return type == TYPE_SHARED; }
+    bool isGroupRepo() const { return type == TYPE_GROUP; }
 
     bool isVirtual() const { return _virtual; }
 
+    RepoId repoId() const { return RepoId::fromString(id); }
+
     QIcon getIcon() const;
     QPixmap getPixmap() const;
 
     static ServerRepo fromJSON(const json_t*, json_error_t *error);
     static std::vector<ServerRepo> listFromJSON(const json_t*, json_error_t *json);
+
+    static RepoType typeFromString(const char *type);
+    static const char *typeToString(RepoType type);
 };
 
 
@@ -18,7 +18,8 @@ static bool dockClickHandler(id self,SEL _cmd,...)
 }
 
 //TODO use modern Objc (Objc 2.0) to replace these deprecated APIs
-Application::Application (int &argc, char **argv):QApplication(argc, argv)
+Application::Application (int &argc, char **argv, bool gui_enabled)
+    : QApplication(argc, argv, gui_enabled)
 {
     objc_object* cls = (objc_object *)objc_getClass("NSApplication");
     SEL sharedApplication = sel_registerName("sharedApplication");
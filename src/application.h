@@ -9,6 +9,6 @@ class Application : public QApplication {
 
 public:
 
-    Application (int& argc, char **argv);
+    Application (int& argc, char **argv, bool gui_enabled=true);
     virtual ~Application() {};
 };
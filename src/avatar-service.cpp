@@ -7,6 +7,7 @@
 #include "seafile-applet.h"
 #include "configurator.h"
 #include "account-mgr.h"
+#include "repo-service.h"
 #include "api/requests.h"
 #include "utils/utils.h"
 
@@ -16,6 +17,7 @@ namespace {
 
 const int kCheckPendingInterval = 1000; // 1s
 const char *kAvatarsDirName = "avatars";
+const int kMaxCachedAccounts = 4;
 
 } // namespace
 
@@ -99,6 +101,10 @@ public:
         wait_.clear();
     }
 
+    int size() const {
+        return q_.size();
+    }
+
 private:
     QQueue<QString> q_;
 
@@ -122,6 +128,8 @@ AvatarService::AvatarService(QObject *parent)
 {
     get_avatar_req_ = 0;
 
+    caches_.setMaxCost(kMaxCachedAccounts);
+
     queue_ = new PendingAvatarRequestQueue;
 
     timer_ = new QTimer(this);
@@ -150,20 +158,34 @@ void AvatarService::start()
 // fist check in-memory-cache, then check saved image on disk
 QImage AvatarService::loadAvatarFromLocal(const QString& email)
 {
-    if (cache_.contains(email)) {
-        return cache_.value(email);
+    const Account& account = seafApplet->accountManager()->currentAccount();
+    QHash<QString, QImage> *cache = cacheForAccount(account);
+    if (cache->contains(email)) {
+        return cache->value(email);
     }
 
-    QString path = avatarPathForEmail(seafApplet->accountManager()->currentAccount(),
-                                    email);
+    QString path = avatarPathForEmail(account, email);
 
     if (QFileInfo(path).exists()) {
-        return QImage(path);
+        QImage img(path);
+        cache->insert(email, img);
+        return img;
     }
 
     return QImage();
 }
 
+QHash<QString, QImage> *AvatarService::cacheForAccount(const Account& account)
+{
+    QString key = RepoService::accountKey(account);
+    QHash<QString, QImage> *cache = caches_.object(key);
+    if (!cache) {
+        cache = new QHash<QString, QImage>;
+        caches_.insert(key, cache);
+    }
+    return cache;
+}
+
 QString AvatarService::avatarPathForEmail(const Account& account, const QString& email)
 {
     return QDir(avatars_dir_).filePath(::md5(account.serverUrl.host() + email));
@@ -200,7 +222,7 @@ void AvatarService::onGetAvatarSuccess(const QImage& img)
 
     QString email = get_avatar_req_->email();
 
-    cache_[email] = img;
+    cacheForAccount(get_avatar_req_->account())->insert(email, img);
 
     // save image to avatars/ folder
     QString path = avatarPathForEmail(get_avatar_req_->account(), email);
@@ -247,6 +269,11 @@ bool AvatarService::avatarFileExists(const QString& email)
     return QFileInfo(getAvatarFilePath(email)).exists();
 }
 
+int AvatarService::pendingRequestsCount() const
+{
+    return queue_->size() + (get_avatar_req_ != 0 ? 1 : 0);
+}
+
 void AvatarService::checkPendingRequests()
 {
     queue_->tick();
@@ -265,7 +292,8 @@ void AvatarService::onAccountChanged()
 {
     queue_->reset();
     if (get_avatar_req_) {
-        delete get_avatar_req_;
+        get_avatar_req_->cancel();
+        get_avatar_req_->deleteLater();
         get_avatar_req_ = 0;
     }
 }
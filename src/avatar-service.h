@@ -5,6 +5,7 @@
 #include <QObject>
 #include <QImage>
 #include <QHash>
+#include <QCache>
 #include <QString>
 
 class QImage;
@@ -27,6 +28,9 @@ public:
     QString getAvatarFilePath(const QString& email);
     bool avatarFileExists(const QString& email);
 
+    // number of avatars waiting to be fetched from the server
+    int pendingRequestsCount() const;
+
 signals:
     void avatarUpdated(const QString& email, const QImage& avatar);
 
@@ -46,6 +50,7 @@ private:
     QImage loadAvatarFromLocal(const QString& email);
     void fetchImageFromServer(const QString& email);
     QString avatarPathForEmail(const Account& account, const QString& email);
+    QHash<QString, QImage> *cacheForAccount(const Account& account);
 
     GetAvatarRequest *get_avatar_req_;
 
@@ -53,7 +58,9 @@ private:
 
     QImage image_;
 
-    QHash<QString, QImage> cache_;
+    // The avatars in memory of the recently used accounts, an email may be
+    // a different user on another server
+    QCache<QString, QHash<QString, QImage> > caches_;
 
     PendingAvatarRequestQueue *queue_;
 
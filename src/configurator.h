@@ -15,6 +15,9 @@ public:
 
     void checkInit();
 
+    // true if the ccnet config dir does not exist yet
+    bool needInitConfig();
+
     const QString& ccnetDir() const { return ccnet_dir_; }
     const QString& seafileDir() const { return seafile_dir_; }
     const QString& worktreeDir() const { return worktree_; }
@@ -35,7 +38,6 @@ private:
 
     void setSeafileDirAttributes();
 
-    bool needInitConfig();
     void initConfig();
     void validateExistingConfig();
     int readSeafileIni(QString *content);
@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <vector>
+
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtDebug>
+
+#if !defined(Q_WS_WIN)
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#include "seafile-applet.h"
+#include "account-mgr.h"
+#include "repo-service.h"
+#include "transfer-progress.h"
+#include "rpc/rpc-client.h"
+#include "rpc/local-repo.h"
+#include "configurator.h"
+#include "utils/utils.h"
+#include "utils/process.h"
+
+#include "daemon-control-server.h"
+
+namespace {
+
+const int kMaxCommandLength = 1024;
+
+const int kClientConnectTimeoutMSecs = 3000;
+// "sync all" may take a while with many libraries
+const int kClientResponseTimeoutMSecs = 30000;
+
+const char *kErrorPrefix = "error: ";
+
+} // namespace
+
+DaemonControlServer::DaemonControlServer(QObject *parent)
+    : QObject(parent)
+{
+    server_ = new QLocalServer(this);
+    connect(server_, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+QString DaemonControlServer::socketName(const QString& ccnet_dir)
+{
+#if defined(Q_WS_WIN)
+    // a named pipe. Its default ACL only lets the other users read it,
+    // and the user name keeps them from taking the name first.
+    return QString("seafile-applet-%1-%2")
+        .arg(QString::fromLocal8Bit(qgetenv("USERNAME")))
+        .arg(qHash(QDir(ccnet_dir).absolutePath()));
+#else
+    return QDir(ccnet_dir).filePath("seafile-applet.sock");
+#endif
+}
+
+bool DaemonControlServer::start()
+{
+    QString name = socketName(seafApplet->configurator()->ccnetDir());
+
+    // A socket left by an applet which has crashed. There can't be
+    // another applet running, main() has checked that.
+    QLocalServer::removeServer(name);
+
+#if !defined(Q_WS_WIN)
+    // Only the owner may connect: the socket can stop the daemon and lists
+    // the worktrees. The umask closes the window before the chmod.
+    mode_t old_umask = umask(0077);
+#endif
+    bool listening = server_->listen(name);
+#if !defined(Q_WS_WIN)
+    umask(old_umask);
+#endif
+
+    if (!listening) {
+        qWarning("[DaemonControlServer] failed to listen on %s: %s",
+                 toCStr(name), toCStr(server_->errorString()));
+        return false;
+    }
+
+#if !defined(Q_WS_WIN)
+    if (!QFile::setPermissions(server_->fullServerName(),
+                               QFile::ReadOwner | QFile::WriteOwner)) {
+        qWarning("[DaemonControlServer] failed to restrict %s to its owner",
+                 toCStr(server_->fullServerName()));
+        server_->close();
+        return false;
+    }
+#endif
+
+    qDebug("[DaemonControlServer] listening on %s", toCStr(server_->fullServerName()));
+    return true;
+}
+
+void DaemonControlServer::onNewConnection()
+{
+    while (server_->hasPendingConnections()) {
+        QLocalSocket *socket = server_->nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+void DaemonControlServer::onReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!socket) {
+        return;
+    }
+
+    if (!socket->canReadLine()) {
+        if (socket->bytesAvailable() > kMaxCommandLength) {
+            socket->abort();
+        }
+        return;
+    }
+
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+
+    QString command = QString::fromUtf8(socket->readLine(kMaxCommandLength)).trimmed();
+    qDebug("[DaemonControlServer] command: %s", toCStr(command));
+
+    bool ok = true;
+    QStringList lines = handleCommand(command, &ok);
+    if (!ok && !lines.isEmpty()) {
+        lines[0].prepend(kErrorPrefix);
+    }
+
+    socket->write(lines.join("\n").toUtf8());
+    socket->write("\n");
+    socket->disconnectFromServer();
+
+    if (ok && command == "quit") {
+        socket->waitForBytesWritten(1000);
+        seafApplet->exit(0);
+    }
+}
+
+QStringList DaemonControlServer::handleCommand(const QString& command, bool *ok)
+{
+    QStringList args = command.split(" ", QString::SkipEmptyParts);
+    QString name = args.value(0);
+
+    if (name == "status") {
+        return status();
+    } else if (name == "list") {
+        return listRepos(ok);
+    } else if (name == "sync") {
+        if (args.size() != 2) {
+            *ok = false;
+            return QStringList("usage: sync <repo_id>|all");
+        }
+        return syncRepos(args[1], ok);
+    } else if (name == "quit") {
+        return QStringList("stopping");
+    } else if (name == "help") {
+        return QStringList() << "status" << "list" << "sync <repo_id>|all" << "quit";
+    }
+
+    *ok = false;
+    return QStringList(QString("unknown command \"%1\", try help").arg(name));
+}
+
+QStringList DaemonControlServer::status()
+{
+    QStringList lines;
+
+    lines << QString("mode: %1").arg(seafApplet->headless() ? "headless" : "gui");
+    lines << QString("version: %1").arg(STRINGIZE(SEAFILE_CLIENT_VERSION));
+    lines << QString("startup_ms: %1").arg(seafApplet->startupTime());
+    lines << QString("first_repo_list_ms: %1").arg(seafApplet->firstRepoListTime());
+    lines << QString("rss_kb: %1").arg(process_resident_memory() / 1024);
+
+    Account account = seafApplet->accountManager()->currentAccount();
+    if (account.isValid()) {
+        lines << QString("account: %1 %2")
+            .arg(account.username)
+            .arg(account.serverUrl.toString());
+    } else {
+        lines << "account: none";
+    }
+
+    lines << QString("server_repos: %1").arg(RepoService::instance()->snapshot().size());
+    QStringList failed = RepoService::instance()->failedAccounts();
+    if (!failed.isEmpty()) {
+        lines << QString("repo_refresh_failed: %1").arg(failed.join(" "));
+    }
+
+    std::vector<LocalRepo> repos;
+    if (seafApplet->rpcClient()->listLocalRepos(&repos) < 0) {
+        lines << "daemon: not responding";
+    } else {
+        lines << "daemon: running";
+        QMap<QString, int> states;
+        for (size_t i = 0; i < repos.size(); i++) {
+            seafApplet->rpcClient()->getSyncStatus(repos[i]);
+            states[repos[i].syncStateName()]++;
+        }
+        QStringList counts;
+        QMapIterator<QString, int> it(states);
+        while (it.hasNext()) {
+            it.next();
+            counts << QString("%1 %2").arg(it.value()).arg(it.key());
+        }
+        lines << QString("local_repos: %1 (%2)").arg(repos.size()).arg(counts.join(", "));
+    }
+
+    TransferProgress *progress = TransferProgress::instance();
+    lines << QString("upload_rate: %1").arg(progress->totalUploadRate());
+    lines << QString("download_rate: %1").arg(progress->totalDownloadRate());
+
+    return lines;
+}
+
+QStringList DaemonControlServer::listRepos(bool *ok)
+{
+    QStringList lines;
+
+    std::vector<LocalRepo> repos;
+    if (seafApplet->rpcClient()->listLocalRepos(&repos) < 0) {
+        *ok = false;
+        return QStringList("failed to get the libraries from the daemon");
+    }
+
+    for (size_t i = 0; i < repos.size(); i++) {
+        LocalRepo& repo = repos[i];
+        seafApplet->rpcClient()->getSyncStatus(repo);
+        QStringList fields;
+        fields << repo.id << repo.name << repo.syncStateName() << repo.worktree;
+        if (repo.sync_state == LocalRepo::SYNC_STATE_ERROR) {
+            fields << repo.sync_error_str;
+        }
+        lines << fields.join("\t");
+    }
+
+    return lines;
+}
+
+QStringList DaemonControlServer::syncRepos(const QString& repo_id, bool *ok)
+{
+    QStringList repo_ids;
+
+    if (repo_id == "all") {
+        std::vector<LocalRepo> repos;
+        if (seafApplet->rpcClient()->listLocalRepos(&repos) < 0) {
+            *ok = false;
+            return QStringList("failed to get the libraries from the daemon");
+        }
+        for (size_t i = 0; i < repos.size(); i++) {
+            repo_ids << repos[i].id;
+        }
+    } else {
+        LocalRepo repo;
+        if (seafApplet->rpcClient()->getLocalRepo(repo_id, &repo) < 0) {
+            *ok = false;
+            return QStringList(QString("library %1 is not synced on this computer").arg(repo_id));
+        }
+        repo_ids << repo_id;
+    }
+
+    foreach (const QString& id, repo_ids) {
+        seafApplet->rpcClient()->syncRepoImmediately(id);
+    }
+
+    return QStringList(QString("syncing %1 libraries").arg(repo_ids.size()));
+}
+
+int DaemonControlServer::runCommand(const QString& command)
+{
+    QLocalSocket socket;
+    socket.connectToServer(socketName(defaultCcnetDir()));
+    if (!socket.waitForConnected(kClientConnectTimeoutMSecs)) {
+        fprintf(stderr, "failed to connect to seafile-applet: %s\n"
+                "is it running with --headless?\n",
+                toCStr(socket.errorString()));
+        return 1;
+    }
+
+    socket.write(command.toUtf8() + "\n");
+    socket.flush();
+
+    QByteArray response;
+    while (socket.state() == QLocalSocket::ConnectedState
+           && socket.waitForReadyRead(kClientResponseTimeoutMSecs)) {
+        response += socket.readAll();
+    }
+    response += socket.readAll();
+
+    fwrite(response.data(), 1, response.size(), stdout);
+
+    if (response.isEmpty()) {
+        fprintf(stderr, "no response from seafile-applet\n");
+        return 1;
+    }
+
+    return response.startsWith(kErrorPrefix) ? 1 : 0;
+}
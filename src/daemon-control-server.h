@@ -0,0 +1,64 @@
+#ifndef SEAFILE_CLIENT_DAEMON_CONTROL_SERVER_H
+#define SEAFILE_CLIENT_DAEMON_CONTROL_SERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * Lets the headless applet (seafile-applet --headless) be controlled
+ * through a local socket. A client sends one command per connection,
+ * terminated by a newline, and reads the response until the server closes
+ * the connection:
+ *
+ *   status            state of the applet and the daemon
+ *   list              the local libraries: id, name, sync state, worktree
+ *   sync <repo_id>    sync a library now, or all of them with "sync all"
+ *   quit              stop the applet and the daemon
+ *
+ * Failed commands respond with a line starting with "error: ".
+ *
+ * Only the user running the applet may connect: the socket file is made
+ * readable and writable by its owner only, and on Windows the name of the
+ * pipe includes the user name.
+ *
+ * "seafile-applet --control <command>" is a client for it.
+ */
+class DaemonControlServer : public QObject {
+    Q_OBJECT
+public:
+    DaemonControlServer(QObject *parent=0);
+
+    bool start();
+
+    /**
+     * The name of the socket for the given ccnet config dir
+     */
+    static QString socketName(const QString& ccnet_dir);
+
+    /**
+     * Send @command to the applet running with the default ccnet config
+     * dir and print the response. Returns the exit code of the program.
+     */
+    static int runCommand(const QString& command);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    Q_DISABLE_COPY(DaemonControlServer)
+
+    QStringList handleCommand(const QString& command, bool *ok);
+
+    QStringList status();
+    QStringList listRepos(bool *ok);
+    QStringList syncRepos(const QString& repo_id, bool *ok);
+
+    QLocalServer *server_;
+};
+
+#endif // SEAFILE_CLIENT_DAEMON_CONTROL_SERVER_H
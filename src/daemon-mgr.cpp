@@ -17,6 +17,9 @@ extern "C" {
 #include "utils/process.h"
 #include "configurator.h"
 #include "seafile-applet.h"
+#ifdef SEAFILE_FAKE_DAEMON_ENABLED
+#include "rpc/fake-daemon-transport.h"
+#endif
 #include "daemon-mgr.h"
 
 namespace {
@@ -42,7 +45,6 @@ DaemonManager::DaemonManager()
 {
     conn_daemon_timer_ = new QTimer(this);
     connect(conn_daemon_timer_, SIGNAL(timeout()), this, SLOT(tryConnCcnet()));
-    shutdown_process (kCcnetDaemonExecutable);
 
     system_shut_down_ = false;
     connect(qApp, SIGNAL(aboutToQuit()),
@@ -51,6 +53,16 @@ DaemonManager::DaemonManager()
 
 void DaemonManager::startCcnetDaemon()
 {
+#ifdef SEAFILE_FAKE_DAEMON_ENABLED
+    // The stand-in daemon (tools/fake-daemon) is started by the user
+    if (!fakeDaemonSocketPath().isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(onSeafDaemonStarted()));
+        return;
+    }
+#endif
+
+    shutdown_process (kCcnetDaemonExecutable);
+
     sync_client_ = ccnet_client_new();
 
     const QString config_dir = seafApplet->configurator()->ccnetDir();
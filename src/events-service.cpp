@@ -3,6 +3,8 @@
 #include "seafile-applet.h"
 #include "account-mgr.h"
 #include "api/requests.h"
+#include "api/api-error.h"
+#include "server-info-service.h"
 #include "events-service.h"
 
 namespace {
@@ -54,13 +56,18 @@ void EventsService::refresh()
         return;
     }
 
+    // Don't ask a server we know has no events
+    ServerInfo info = ServerInfoService::instance()->serverInfo(account.serverUrl);
+    if (info.events == ServerInfo::NOT_SUPPORTED) {
+        return;
+    }
+
     in_refresh_ = true;
 
-    if (get_events_req_) {
-        delete get_events_req_;
-    }
+    GetEventsRequest *old_req = get_events_req_;
 
     get_events_req_ = new GetEventsRequest(account, more_offset_);
+    account_ = account;
 
     connect(get_events_req_, SIGNAL(success(const std::vector<SeafEvent>&, int)),
             this, SLOT(onRefreshSuccess(const std::vector<SeafEvent>&, int)));
@@ -69,6 +76,11 @@ void EventsService::refresh()
             this, SLOT(onRefreshFailed(const ApiError&)));
 
     get_events_req_->send();
+
+    if (old_req) {
+        old_req->cancel();
+        old_req->deleteLater();
+    }
 }
 
 void EventsService::loadMore()
@@ -80,6 +92,8 @@ void EventsService::onRefreshSuccess(const std::vector<SeafEvent>& events, int n
 {
     in_refresh_ = false;
 
+    ServerInfoService::instance()->setEventsSupported(account_.serverUrl, true);
+
     // XXX: uncomment this when we need "load more events feature"
     /*
     const std::vector<SeafEvent> new_events = handleEventsOffset(events);
@@ -135,6 +149,10 @@ void EventsService::onRefreshFailed(const ApiError& error)
 {
     in_refresh_ = false;
 
+    if (error.type() == ApiError::HTTP_ERROR && error.httpErrorCode() == 404) {
+        ServerInfoService::instance()->setEventsSupported(account_.serverUrl, false);
+    }
+
     emit refreshFailed(error);
 }
 
@@ -5,6 +5,7 @@
 #include <QObject>
 
 #include "api/event.h"
+#include "account.h"
 
 class QTimer;
 
@@ -50,6 +51,8 @@ private:
     const std::vector<SeafEvent> handleEventsOffset(const std::vector<SeafEvent>& new_events);
 
     GetEventsRequest *get_events_req_;
+    // the account of get_events_req_
+    Account account_;
 
     std::vector<SeafEvent> events_;
 
@@ -7,8 +7,11 @@
 #include <QWidget>
 #include <QDir>
 
+#include <QElapsedTimer>
+
 #include <glib-object.h>
 #include <cstdio>
+#include <cstring>
 
 #include "utils/process.h"
 #include "utils/uninstall-helpers.h"
@@ -16,16 +19,39 @@
 #include "seafile-applet.h"
 #include "QtAwesome.h"
 #include "open-local-helper.h"
+#include "daemon-control-server.h"
 #if defined(Q_WS_MAC)
 #include "application.h"
 #endif
 
 #define APPNAME "seafile-applet"
 
+namespace {
+
+// Checked before creating the QApplication, which must not connect to
+// the window system in the headless mode
+bool hasOption(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 int main(int argc, char *argv[])
 {
     int ret = 0;
     char c;
+    QElapsedTimer startup_timer;
+    startup_timer.start();
+
+    const char *control_command = NULL;
+    bool headless = hasOption(argc, argv, "--headless");
+    bool gui_enabled = !headless && !hasOption(argc, argv, "--control");
 #if defined(Q_WS_MAC)
     if ( QSysInfo::MacintoshVersion > QSysInfo::MV_10_8 ) {
         // fix Mac OS X 10.9 (mavericks) font issue
@@ -42,13 +68,15 @@ int main(int argc, char *argv[])
 #endif
 
 #if defined(Q_WS_MAC)
-    Application app(argc, argv);
+    Application app(argc, argv, gui_enabled);
 #else
-    QApplication app(argc, argv);
+    QApplication app(argc, argv, gui_enabled);
 #endif
 
     QDir::setCurrent(QApplication::applicationDirPath());
-    app.setStyle(new SeafileProxyStyle());
+    if (gui_enabled) {
+        app.setStyle(new SeafileProxyStyle());
+    }
 
     // initialize i18n
     QTranslator qtTranslator;
@@ -83,7 +111,7 @@ int main(int argc, char *argv[])
 
     app.installTranslator(&myappTranslator);
 
-    static const char *short_options = "KXc:d:f:";
+    static const char *short_options = "KXc:d:f:T:M:HC:";
     static const struct option long_options[] = {
         { "config-dir", required_argument, NULL, 'c' },
         { "data-dir", required_argument, NULL, 'd' },
@@ -91,6 +119,10 @@ int main(int argc, char *argv[])
         { "remove-user-data", no_argument, NULL, 'X' },
         { "open-local-file", no_argument, NULL, 'f' },
         { "stdout", no_argument, NULL, 'l' },
+        { "trace-file", required_argument, NULL, 'T' },
+        { "metrics-port", required_argument, NULL, 'M' },
+        { "headless", no_argument, NULL, 'H' },
+        { "control", required_argument, NULL, 'C' },
         { NULL, 0, NULL, 0, },
     };
 
@@ -106,6 +138,17 @@ int main(int argc, char *argv[])
         case 'l':
             g_setenv ("LOG_STDOUT", "", 1);
             break;
+        case 'T':
+            g_setenv ("SEAFILE_TRACE_FILE", optarg, 1);
+            break;
+        case 'M':
+            g_setenv ("SEAFILE_METRICS_PORT", optarg, 1);
+            break;
+        case 'H':
+            break;
+        case 'C':
+            control_command = optarg;
+            break;
         case 'K':
             do_stop();
             exit(0);
@@ -120,10 +163,18 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (control_command) {
+        // after parsing all the options, -c may come after --control
+        return DaemonControlServer::runCommand(QString::fromLocal8Bit(control_command));
+    }
+
     if (count_process(APPNAME) > 1) {
-        QMessageBox::warning(NULL, getBrand(),
-                             QObject::tr("%1 is already running").arg(getBrand()),
-                             QMessageBox::Ok);
+        QString msg = QObject::tr("%1 is already running").arg(getBrand());
+        if (headless) {
+            fprintf(stderr, "%s\n", msg.toUtf8().data());
+        } else {
+            QMessageBox::warning(NULL, getBrand(), msg, QMessageBox::Ok);
+        }
         return -1;
     }
 
@@ -134,10 +185,13 @@ int main(int argc, char *argv[])
     QCoreApplication::setOrganizationDomain("seafile.com");
     QCoreApplication::setApplicationName(QString("%1 Client").arg(getBrand()));
 
-    awesome = new QtAwesome(qApp);
-    awesome->initFontAwesome();
+    if (gui_enabled) {
+        awesome = new QtAwesome(qApp);
+        awesome->initFontAwesome();
+    }
 
-    seafApplet = new SeafileApplet;
+    seafApplet = new SeafileApplet(headless);
+    seafApplet->setStartupTimer(startup_timer);
     seafApplet->start();
 
     ret = app.exec();
@@ -10,8 +10,13 @@ extern "C" {
 #include "configurator.h"
 #include "ui/tray-icon.h"
 #include "utils/utils.h"
-#include "utils/translate-commit-desc.h"
+#include "utils/probes.h"
 #include "open-local-helper.h"
+#include "notification-aggregator.h"
+#include "transfer-progress.h"
+#ifdef SEAFILE_FAKE_DAEMON_ENABLED
+#include "rpc/fake-daemon-transport.h"
+#endif
 
 #include "message-listener.h"
 
@@ -38,22 +43,6 @@ static int parse_seafile_notification (char *msg, char **type, char **body)
     return 0;
 }
 
-static bool
-collect_transfer_info (QString *msg, char *info, char *repo_name)
-{
-    char *p;
-    if (! (p = strchr (info, '\t')))
-        return false;
-    *p = '\0';
-
-    int rate = atoi(p + 1) / 1024;
-    QString uploadStr = (strcmp(info, "upload") == 0) ? QObject::tr("Uploading") : QObject::tr("Downloading");
-    QString buf = QString("%1 %2, %3 %4 KB/s\n").arg(uploadStr).arg(QString::fromUtf8(repo_name)).arg(QObject::tr("Speed")).arg(rate);
-    msg->append(buf);
-    return true;
-}
-
-
 /**
  * Wrapper callback for mq-client
  */
@@ -75,6 +64,13 @@ MessageListener::MessageListener()
 
 void MessageListener::connectDaemon()
 {
+#ifdef SEAFILE_FAKE_DAEMON_ENABLED
+    // The stand-in daemon sends no notifications
+    if (!fakeDaemonSocketPath().isEmpty()) {
+        return;
+    }
+#endif
+
     async_client_ = ccnet_client_new();
 
     const QString config_dir = seafApplet->configurator()->ccnetDir();
@@ -126,6 +122,7 @@ void MessageListener::handleMessage(CcnetMessage *message)
     char *content = NULL;
 
     if (IS_APP_MSG(message, kAppletCommandsMQ)) {
+        SEAFILE_PROBE2(message, message->app, message->body);
         if (g_strcmp0(message->body, "quit") == 0) {
             qDebug("[Message Listener] Got a quit command. Quit now.");
             seafApplet->exit(0);
@@ -139,28 +136,30 @@ void MessageListener::handleMessage(CcnetMessage *message)
     } else if (IS_APP_MSG(message, kSeafileNotificationsMQ)) {
         if (parse_seafile_notification (message->body, &type, &content) < 0)
             return;
+        SEAFILE_PROBE2(message, message->app, type);
 
         if (strcmp(type, "transfer") == 0) {
             if (!seafApplet->settingsManager()->autoSync())
                 return;
 
-            seafApplet->trayIcon()->rotate(true);
+            SeafileTrayIcon *tray = seafApplet->trayIcon();
+            if (tray) {
+                tray->rotate(true);
+            }
 
             if (!content) {
                 qDebug("Handle empty notification");
                 return;
             }
-            QString buf;
-            bool ret = parse_key_value_pairs(content, (KeyValueFunc)collect_transfer_info, &buf);
-            // qDebug() << "ret="<< ret << buf;
-            if (ret)
-                seafApplet->trayIcon()->setToolTip(buf);
+            TransferProgress *progress = TransferProgress::instance();
+            if (progress->updateFromNotification(content) && tray)
+                tray->setToolTip(progress->toolTip());
 
             return;
 
         } else if (strcmp(type, "repo.deleted_on_relay") == 0) {
-            QString buf = tr("\"%1\" is unsynced. \nReason: Deleted on server").arg(QString::fromUtf8(content));
-            seafApplet->trayIcon()->notify(getBrand(), buf);
+            NotificationAggregator::instance()->addEvent(
+                NotificationAggregator::DELETED_ON_RELAY, QString::fromUtf8(content));
         } else if (strcmp(type, "sync.done") == 0) {
             /* format: repo_name \t repo_id \t description */
             QStringList slist = QString::fromUtf8(content).split("\t");
@@ -169,10 +168,8 @@ void MessageListener::handleMessage(CcnetMessage *message)
                 return;
             }
 
-            QString title = tr("\"%1\" is synchronized").arg(slist.at(0));
-            QString buf = slist.at(2);
-
-            seafApplet->trayIcon()->notify(title, translateCommitDesc(buf.trimmed()));
+            NotificationAggregator::instance()->addEvent(
+                NotificationAggregator::SYNC_DONE, slist.at(0), slist.at(2));
 
         } else if (strcmp(type, "sync.access_denied") == 0) {
             /* format: <repo_name\trepo_id> */
@@ -181,8 +178,8 @@ void MessageListener::handleMessage(CcnetMessage *message)
                 qDebug("Bad sync.access_denied message format");
                 return;
             }
-            QString buf = tr("\"%1\" failed to sync. \nAccess denied to service").arg(slist.at(0));
-            seafApplet->trayIcon()->notify(getBrand(), buf);
+            NotificationAggregator::instance()->addEvent(
+                NotificationAggregator::ACCESS_DENIED, slist.at(0));
 
         } else if (strcmp(type, "sync.quota_full") == 0) {
             /* format: <repo_name\trepo_id> */
@@ -192,8 +189,8 @@ void MessageListener::handleMessage(CcnetMessage *message)
                 return;
             }
 
-            QString buf = tr("\"%1\" failed to sync.\nThe library owner's storage space is used up.").arg(slist.at(0));
-            seafApplet->trayIcon()->notify(getBrand(), buf);
+            NotificationAggregator::instance()->addEvent(
+                NotificationAggregator::QUOTA_FULL, slist.at(0));
         }
     }
 #ifdef __APPLE__
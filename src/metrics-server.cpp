@@ -0,0 +1,426 @@
+#include <vector>
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QStringList>
+#include <QMap>
+#include <QtDebug>
+
+#include "seafile-applet.h"
+#include "rpc/rpc-client.h"
+#include "rpc/local-repo.h"
+#include "rpc/clone-task.h"
+#include "repo-service.h"
+#include "avatar-service.h"
+#include "api/request-scheduler.h"
+#include "api/api-client.h"
+#include "transfer-progress.h"
+#include "utils/perf-stats.h"
+#include "utils/process.h"
+
+#include "metrics-server.h"
+
+namespace {
+
+// Requests larger than this are not metrics scrapes
+const int kMaxRequestSize = 8192;
+
+// Between two runs of the MetricsCollector
+const int kCollectIntervalMsecs = 10 * 1000;
+
+QString escapeLabelValue(const QString& value)
+{
+    QString ret = value;
+    ret.replace("\\", "\\\\");
+    ret.replace("\"", "\\\"");
+    ret.replace("\n", "\\n");
+    return ret;
+}
+
+/**
+ * Helper to write metrics in the Prometheus text format
+ */
+class MetricsWriter {
+public:
+    void header(const char *name, const char *type, const char *help) {
+        out_ += "# HELP ";
+        out_ += name;
+        out_ += " ";
+        out_ += help;
+        out_ += "\n# TYPE ";
+        out_ += name;
+        out_ += " ";
+        out_ += type;
+        out_ += "\n";
+    }
+
+    void sample(const char *name, const QStringList& labels, double value) {
+        out_ += name;
+        if (!labels.isEmpty()) {
+            out_ += "{";
+            out_ += labels.join(",").toUtf8();
+            out_ += "}";
+        }
+        out_ += " ";
+        out_ += QByteArray::number(value, 'g', 12);
+        out_ += "\n";
+    }
+
+    void sample(const char *name, double value) {
+        sample(name, QStringList(), value);
+    }
+
+    static QString label(const char *key, const QString& value) {
+        return QString("%1=\"%2\"").arg(key).arg(escapeLabelValue(value));
+    }
+
+    const QByteArray& data() const { return out_; }
+
+private:
+    QByteArray out_;
+};
+
+void writeCallHistograms(MetricsWriter *writer, PerfStats::Kind kind,
+                         const char *label_key, const char *prefix)
+{
+    QList<PerfStats::CallSummary> calls = PerfStats::instance()->callSummaries(kind, false);
+
+    QByteArray duration = QByteArray(prefix) + "_duration_seconds";
+    QByteArray bucket = duration + "_bucket";
+    QByteArray sum = duration + "_sum";
+    QByteArray count = duration + "_count";
+
+    writer->header(duration.data(), "histogram", "Latency of the calls");
+    foreach (const PerfStats::CallSummary& call, calls) {
+        QString name_label = MetricsWriter::label(label_key, call.name);
+        quint64 cumulative = 0;
+        for (int i = 0; i < PerfStats::histogramBoundsCount(); i++) {
+            cumulative += i < call.buckets.size() ? call.buckets[i] : 0;
+            QString le = QString::number(PerfStats::histogramBoundUs(i) / 1000000.0);
+            writer->sample(bucket.data(),
+                           QStringList() << name_label << MetricsWriter::label("le", le),
+                           cumulative);
+        }
+        writer->sample(bucket.data(),
+                       QStringList() << name_label << MetricsWriter::label("le", "+Inf"),
+                       call.count);
+        writer->sample(sum.data(), QStringList() << name_label, call.sum_us / 1000000.0);
+        writer->sample(count.data(), QStringList() << name_label, call.count);
+    }
+
+    QByteArray errors = QByteArray(prefix) + "_errors_total";
+    writer->header(errors.data(), "counter", "Number of failed calls");
+    foreach (const PerfStats::CallSummary& call, calls) {
+        writer->sample(errors.data(),
+                       QStringList() << MetricsWriter::label(label_key, call.name),
+                       call.errors);
+    }
+}
+
+} // namespace
+
+MetricsCollector::MetricsCollector()
+    : rpc_client_(NULL)
+{
+}
+
+void MetricsCollector::collect()
+{
+    if (!rpc_client_) {
+        rpc_client_ = new SeafileRpcClient;
+        rpc_client_->setParent(this);
+        // Scraping must not show up in the stats it reports, nor touch
+        // them from this thread
+        rpc_client_->setRecordStats(false);
+        rpc_client_->connectDaemon();
+    }
+
+    MetricsWriter writer;
+
+    // Libraries synced on this computer
+    std::vector<LocalRepo> repos;
+    if (rpc_client_->listLocalRepos(&repos) == 0) {
+        writer.header("seafile_repo_sync_state", "gauge",
+                      "Sync state of the local libraries, 1 for the current state");
+        for (size_t i = 0; i < repos.size(); i++) {
+            LocalRepo& repo = repos[i];
+            rpc_client_->getSyncStatus(repo);
+            writer.sample("seafile_repo_sync_state",
+                          QStringList() << MetricsWriter::label("repo_id", repo.id)
+                          << MetricsWriter::label("repo_name", repo.name)
+                          << MetricsWriter::label("state", repo.syncStateName()),
+                          1);
+        }
+        writer.header("seafile_local_repos", "gauge", "Number of local libraries");
+        writer.sample("seafile_local_repos", repos.size());
+    }
+
+    std::vector<CloneTask> tasks;
+    if (rpc_client_->getCloneTasks(&tasks) == 0) {
+        QMap<QString, int> states;
+        for (size_t i = 0; i < tasks.size(); i++) {
+            states[tasks[i].state]++;
+        }
+        writer.header("seafile_clone_tasks", "gauge", "Number of clone tasks by state");
+        QMapIterator<QString, int> it(states);
+        while (it.hasNext()) {
+            it.next();
+            writer.sample("seafile_clone_tasks",
+                          QStringList() << MetricsWriter::label("state", it.key()),
+                          it.value());
+        }
+    }
+
+    emit collected(writer.data());
+}
+
+MetricsServer* MetricsServer::singleton_;
+
+MetricsServer* MetricsServer::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new MetricsServer;
+    }
+
+    return singleton_;
+}
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent),
+      collector_thread_(NULL),
+      collector_(NULL)
+{
+    server_ = new QTcpServer(this);
+    connect(server_, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+
+    collect_timer_ = new QTimer(this);
+    connect(collect_timer_, SIGNAL(timeout()), this, SIGNAL(collectRequested()));
+}
+
+bool MetricsServer::start(int port)
+{
+    if (server_->isListening()) {
+        return true;
+    }
+
+    if (port <= 0 || port > 65535) {
+        return false;
+    }
+
+    if (!server_->listen(QHostAddress::LocalHost, port)) {
+        qWarning("[MetricsServer] failed to listen on 127.0.0.1:%d: %s",
+                 port, server_->errorString().toUtf8().data());
+        return false;
+    }
+
+    qDebug("[MetricsServer] serving metrics on http://127.0.0.1:%d/metrics", port);
+
+    startCollector();
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    server_->close();
+    collect_timer_->stop();
+}
+
+void MetricsServer::startCollector()
+{
+    if (!collector_thread_) {
+        collector_thread_ = new QThread(this);
+        collector_ = new MetricsCollector;
+        collector_->moveToThread(collector_thread_);
+
+        // queued, across the threads
+        connect(this, SIGNAL(collectRequested()), collector_, SLOT(collect()));
+        connect(collector_, SIGNAL(collected(const QByteArray&)),
+                this, SLOT(onCollected(const QByteArray&)));
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()),
+                this, SLOT(stopCollector()));
+
+        collector_thread_->start();
+    }
+
+    emit collectRequested();
+    collect_timer_->start(kCollectIntervalMsecs);
+}
+
+void MetricsServer::stopCollector()
+{
+    collect_timer_->stop();
+    if (collector_thread_) {
+        collector_thread_->quit();
+        collector_thread_->wait();
+        delete collector_;
+        collector_ = NULL;
+        collector_thread_ = NULL;
+    }
+}
+
+void MetricsServer::onCollected(const QByteArray& metrics)
+{
+    daemon_metrics_ = metrics;
+}
+
+bool MetricsServer::isRunning() const
+{
+    return server_->isListening();
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (server_->hasPendingConnections()) {
+        QTcpSocket *socket = server_->nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+void MetricsServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket) {
+        return;
+    }
+
+    QByteArray request = socket->property("request").toByteArray();
+    request += socket->readAll();
+
+    int end = request.indexOf("\r\n\r\n");
+    if (end < 0) {
+        end = request.indexOf("\n\n");
+    }
+    if (end < 0) {
+        if (request.size() > kMaxRequestSize) {
+            socket->abort();
+            socket->deleteLater();
+        } else {
+            socket->setProperty("request", request);
+        }
+        return;
+    }
+
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+
+    // "GET /metrics HTTP/1.1"
+    QList<QByteArray> request_line = request.left(request.indexOf('\n')).trimmed().split(' ');
+    if (request_line.size() < 2 || request_line[0] != "GET") {
+        sendResponse(socket, 405, "Method Not Allowed", "only GET is supported\n");
+        return;
+    }
+
+    QByteArray path = request_line[1];
+    if (path == "/metrics" || path.startsWith("/metrics?")) {
+        sendResponse(socket, 200, "OK", collectMetrics());
+    } else {
+        sendResponse(socket, 404, "Not Found", "try /metrics\n");
+    }
+}
+
+void MetricsServer::sendResponse(QTcpSocket *socket, int code,
+                                 const char *reason, const QByteArray& body)
+{
+    QByteArray response;
+    response += "HTTP/1.0 " + QByteArray::number(code) + " " + reason + "\r\n";
+    response += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
+
+QByteArray MetricsServer::collectMetrics()
+{
+    MetricsWriter writer;
+
+    writer.header("seafile_server_repos", "gauge",
+                  "Number of libraries on the servers of all the accounts");
+    writer.sample("seafile_server_repos", RepoService::instance()->snapshot().size());
+
+    TransferProgress *progress = TransferProgress::instance();
+    writer.header("seafile_transfer_rate_bytes", "gauge",
+                  "Current transfer rate in bytes per second");
+    writer.sample("seafile_transfer_rate_bytes",
+                  QStringList() << MetricsWriter::label("direction", "upload"),
+                  progress->totalUploadRate());
+    writer.sample("seafile_transfer_rate_bytes",
+                  QStringList() << MetricsWriter::label("direction", "download"),
+                  progress->totalDownloadRate());
+
+    writer.header("seafile_avatar_queue_depth", "gauge",
+                  "Number of avatars waiting to be fetched");
+    writer.sample("seafile_avatar_queue_depth",
+                  AvatarService::instance()->pendingRequestsCount());
+
+    RequestScheduler *scheduler = RequestScheduler::instance();
+    static const char *kPriorityNames[] = { "interactive", "refresh", "background" };
+    writer.header("seafile_api_queue_depth", "gauge",
+                  "Number of api requests waiting for a free slot, by priority");
+    for (int i = 0; i < SeafileApiRequest::N_PRIORITIES; i++) {
+        writer.sample("seafile_api_queue_depth",
+                      QStringList() << MetricsWriter::label("priority", kPriorityNames[i]),
+                      scheduler->queuedCount((SeafileApiRequest::Priority)i));
+    }
+    writer.header("seafile_api_in_flight", "gauge", "Number of api requests in flight");
+    writer.sample("seafile_api_in_flight", scheduler->inFlightCount());
+    writer.header("seafile_api_coalesced_total", "counter",
+                  "GET requests which shared the reply of an identical request");
+    writer.sample("seafile_api_coalesced_total", SeafileApiRequest::coalescedCount());
+    writer.header("seafile_api_compressed_bytes_total", "counter",
+                  "Bytes of the gzip or deflate encoded api responses, as received");
+    writer.sample("seafile_api_compressed_bytes_total", SeafileApiClient::compressedBytesTotal());
+    writer.header("seafile_api_decompressed_bytes_total", "counter",
+                  "Bytes of the gzip or deflate encoded api responses, once decompressed");
+    writer.sample("seafile_api_decompressed_bytes_total", SeafileApiClient::decompressedBytesTotal());
+
+    writer.header("seafile_api_retries_total", "counter",
+                  "Api requests sent again after a transient error");
+    writer.sample("seafile_api_retries_total", scheduler->retriesCount());
+    writer.header("seafile_api_retries_denied_total", "counter",
+                  "Retries not sent because the retry budget of the server was used up");
+    writer.sample("seafile_api_retries_denied_total", scheduler->retriesDeniedCount());
+
+    writeCallHistograms(&writer, PerfStats::RPC, "method", "seafile_rpc");
+    writeCallHistograms(&writer, PerfStats::API, "endpoint", "seafile_api");
+    writeCallHistograms(&writer, PerfStats::MODEL, "model", "seafile_model_update");
+
+    writer.header("seafile_api_bytes_total", "counter",
+                  "Bytes transferred by the api requests");
+    foreach (const PerfStats::CallSummary& call,
+             PerfStats::instance()->callSummaries(PerfStats::API, false)) {
+        writer.sample("seafile_api_bytes_total",
+                      QStringList() << MetricsWriter::label("endpoint", call.name),
+                      call.bytes);
+    }
+
+    writer.header("seafile_timer_wakeups_total", "counter",
+                  "Timer events handled in the main thread");
+    foreach (const PerfStats::TimerSummary& timer,
+             PerfStats::instance()->timerSummaries(false)) {
+        writer.sample("seafile_timer_wakeups_total",
+                      QStringList() << MetricsWriter::label("timer", timer.name),
+                      timer.wakeups);
+    }
+
+    long long rss = process_resident_memory();
+    if (rss >= 0) {
+        writer.header("seafile_process_resident_memory_bytes", "gauge",
+                      "Resident memory of seafile-applet");
+        writer.sample("seafile_process_resident_memory_bytes", rss);
+    }
+
+    if (seafApplet->firstRepoListTime() >= 0) {
+        writer.header("seafile_first_repo_list_seconds", "gauge",
+                      "Time from the start of the applet to the first list of libraries");
+        writer.sample("seafile_first_repo_list_seconds", seafApplet->firstRepoListTime() / 1000.0);
+    }
+
+    return daemon_metrics_ + writer.data();
+}
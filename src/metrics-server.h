@@ -0,0 +1,90 @@
+#ifndef SEAFILE_CLIENT_METRICS_SERVER_H
+#define SEAFILE_CLIENT_METRICS_SERVER_H
+
+#include <QObject>
+#include <QByteArray>
+
+class QTcpServer;
+class QTcpSocket;
+class QThread;
+class QTimer;
+class SeafileRpcClient;
+
+/**
+ * Collects the metrics which need rpc calls to the daemon (the sync state
+ * of each library, the clone tasks) in its own thread, with its own daemon
+ * connection, so that a scrape never blocks the GUI thread.
+ */
+class MetricsCollector : public QObject {
+    Q_OBJECT
+public:
+    MetricsCollector();
+
+public slots:
+    void collect();
+
+signals:
+    // In the Prometheus text format
+    void collected(const QByteArray& metrics);
+
+private:
+    Q_DISABLE_COPY(MetricsCollector)
+
+    // created in the collector thread
+    SeafileRpcClient *rpc_client_;
+};
+
+/**
+ * Serves the metrics of the client in the Prometheus text format at
+ * http://127.0.0.1:<port>/metrics, for a local scraper or for
+ * node_exporter's textfile collector (e.g. with curl from a cron job).
+ *
+ * Disabled by default, see SettingsManager::metricsPort(). It only listens
+ * on the loopback interface.
+ *
+ * The metrics of the daemon are those of the last MetricsCollector run, a
+ * few seconds old, and missing until the first run is done.
+ */
+class MetricsServer : public QObject {
+    Q_OBJECT
+public:
+    static MetricsServer* instance();
+
+    bool start(int port);
+    void stop();
+    bool isRunning() const;
+
+    /**
+     * The current metrics in the Prometheus text exposition format
+     */
+    QByteArray collectMetrics();
+
+signals:
+    void collectRequested();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onCollected(const QByteArray& metrics);
+    void stopCollector();
+
+private:
+    Q_DISABLE_COPY(MetricsServer)
+
+    MetricsServer(QObject *parent=0);
+
+    void sendResponse(QTcpSocket *socket, int code,
+                      const char *reason, const QByteArray& body);
+    void startCollector();
+
+    static MetricsServer *singleton_;
+
+    QTcpServer *server_;
+
+    QThread *collector_thread_;
+    MetricsCollector *collector_;
+    QTimer *collect_timer_;
+    QByteArray daemon_metrics_;
+};
+
+#endif // SEAFILE_CLIENT_METRICS_SERVER_H
@@ -0,0 +1,217 @@
+#include <QTimer>
+
+#include "seafile-applet.h"
+#include "ui/tray-icon.h"
+#include "utils/utils.h"
+#include "utils/translate-commit-desc.h"
+
+#include "notification-aggregator.h"
+
+namespace {
+
+// How long we wait for more events before showing a notification
+const int kCoalesceWindowMsec = 1500;
+
+// Minimal interval between two notifications
+const int kMinNotifyIntervalMsec = 5000;
+
+// Max number of repo names kept for each type of event. Events beyond this
+// are still counted.
+const int kMaxRepoNamesPerType = 50;
+
+// Max number of repo names listed in a digest notification
+const int kMaxRepoNamesShown = 5;
+
+} // namespace
+
+NotificationAggregator* NotificationAggregator::singleton_;
+
+NotificationAggregator* NotificationAggregator::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new NotificationAggregator;
+    }
+
+    return singleton_;
+}
+
+NotificationAggregator::NotificationAggregator(QObject *parent)
+    : QObject(parent)
+{
+    timer_ = new QTimer(this);
+    timer_->setSingleShot(true);
+    connect(timer_, SIGNAL(timeout()), this, SLOT(onTimeout()));
+}
+
+void NotificationAggregator::addEvent(EventType type,
+                                      const QString& repo_name,
+                                      const QString& detail)
+{
+    // No tray icon to show the notifications in headless mode
+    if (!seafApplet->trayIcon()) {
+        return;
+    }
+
+    PendingEvents& events = pending_[type];
+    events.count++;
+    if (events.repo_names.size() < kMaxRepoNamesPerType) {
+        events.repo_names.push_back(repo_name);
+    }
+    events.last_detail = detail;
+
+    // Don't restart the timer on every event, otherwise a steady stream of
+    // events would keep postponing the notification forever.
+    if (!timer_->isActive()) {
+        schedule();
+    }
+}
+
+void NotificationAggregator::schedule()
+{
+    int wait = kCoalesceWindowMsec;
+
+    if (!last_notify_time_.isNull()) {
+        qint64 elapsed = last_notify_time_.msecsTo(QDateTime::currentDateTime());
+        if (elapsed >= 0 && elapsed < kMinNotifyIntervalMsec) {
+            wait = qMax(wait, int(kMinNotifyIntervalMsec - elapsed));
+        }
+    }
+
+    timer_->start(wait);
+}
+
+void NotificationAggregator::onTimeout()
+{
+    flush();
+}
+
+int NotificationAggregator::pendingCount() const
+{
+    int total = 0;
+    for (int i = 0; i < N_EVENT_TYPES; i++) {
+        total += pending_[i].count;
+    }
+    return total;
+}
+
+void NotificationAggregator::flush()
+{
+    timer_->stop();
+
+    int total = pendingCount();
+    if (total == 0) {
+        return;
+    }
+
+    if (total == 1) {
+        for (int i = 0; i < N_EVENT_TYPES; i++) {
+            if (pending_[i].count > 0) {
+                notifySingle((EventType)i, pending_[i]);
+                break;
+            }
+        }
+    } else {
+        notifyDigest();
+    }
+
+    for (int i = 0; i < N_EVENT_TYPES; i++) {
+        pending_[i] = PendingEvents();
+    }
+
+    last_notify_time_ = QDateTime::currentDateTime();
+}
+
+void NotificationAggregator::notifySingle(EventType type, const PendingEvents& events)
+{
+    const QString repo_name = events.repo_names.value(0);
+    SeafileTrayIcon *tray = seafApplet->trayIcon();
+
+    switch (type) {
+    case SYNC_DONE:
+        tray->notify(tr("\"%1\" is synchronized").arg(repo_name),
+                     translateCommitDesc(events.last_detail.trimmed()));
+        break;
+    case DELETED_ON_RELAY:
+        tray->notify(getBrand(),
+                     tr("\"%1\" is unsynced. \nReason: Deleted on server").arg(repo_name));
+        break;
+    case ACCESS_DENIED:
+        tray->notify(getBrand(),
+                     tr("\"%1\" failed to sync. \nAccess denied to service").arg(repo_name));
+        break;
+    case QUOTA_FULL:
+        tray->notify(getBrand(),
+                     tr("\"%1\" failed to sync.\nThe library owner's storage space is used up.").arg(repo_name));
+        break;
+    default:
+        break;
+    }
+}
+
+QString NotificationAggregator::describe(EventType type, const PendingEvents& events) const
+{
+    if (events.count == 1) {
+        const QString repo_name = events.repo_names.value(0);
+        switch (type) {
+        case SYNC_DONE:
+            return tr("\"%1\" is synchronized").arg(repo_name);
+        case DELETED_ON_RELAY:
+            return tr("\"%1\" is unsynced because it is deleted on server").arg(repo_name);
+        case ACCESS_DENIED:
+            return tr("\"%1\" failed to sync: access denied to service").arg(repo_name);
+        case QUOTA_FULL:
+            return tr("\"%1\" failed to sync: the owner's storage space is used up").arg(repo_name);
+        default:
+            return QString();
+        }
+    }
+
+    QString header;
+    switch (type) {
+    case SYNC_DONE:
+        header = tr("%1 libraries are synchronized").arg(events.count);
+        break;
+    case DELETED_ON_RELAY:
+        header = tr("%1 libraries are unsynced because they are deleted on server").arg(events.count);
+        break;
+    case ACCESS_DENIED:
+        header = tr("%1 libraries failed to sync: access denied to service").arg(events.count);
+        break;
+    case QUOTA_FULL:
+        header = tr("%1 libraries failed to sync: the owner's storage space is used up").arg(events.count);
+        break;
+    default:
+        return QString();
+    }
+
+    QStringList names = events.repo_names.mid(0, kMaxRepoNamesShown);
+    QString list = names.join(", ");
+    int more = events.count - names.size();
+    if (more > 0) {
+        list += " " + tr("and %1 more").arg(more);
+    }
+
+    return QString("%1: %2").arg(header).arg(list);
+}
+
+void NotificationAggregator::notifyDigest()
+{
+    QString title;
+    QStringList lines;
+    int ntypes = 0;
+
+    for (int i = 0; i < N_EVENT_TYPES; i++) {
+        if (pending_[i].count > 0) {
+            lines.push_back(describe((EventType)i, pending_[i]));
+            ntypes++;
+        }
+    }
+
+    if (ntypes == 1 && pending_[SYNC_DONE].count > 0) {
+        title = tr("%1 libraries are synchronized").arg(pending_[SYNC_DONE].count);
+    } else {
+        title = getBrand();
+    }
+
+    seafApplet->trayIcon()->notify(title, lines.join("\n"));
+}
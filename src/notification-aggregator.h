@@ -0,0 +1,78 @@
+#ifndef SEAFILE_CLIENT_NOTIFICATION_AGGREGATOR_H
+#define SEAFILE_CLIENT_NOTIFICATION_AGGREGATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+class QTimer;
+
+/**
+ * Collects sync notifications from the daemon and shows them as a single
+ * digest in the tray.
+ *
+ * When a lot of libraries finish syncing at the same time (e.g. after a
+ * reconnect), the daemon sends one message per library. Instead of showing
+ * hundreds of notifications, events are buffered for a short window, merged
+ * per type, and shown as one notification. Notifications are also rate
+ * limited, so a steady stream of events still results in at most one
+ * notification every few seconds.
+ */
+class NotificationAggregator : public QObject {
+    Q_OBJECT
+public:
+    enum EventType {
+        SYNC_DONE = 0,
+        DELETED_ON_RELAY,
+        ACCESS_DENIED,
+        QUOTA_FULL,
+        N_EVENT_TYPES
+    };
+
+    static NotificationAggregator* instance();
+
+    /**
+     * @detail is only used when the event ends up being shown on its own,
+     * e.g. the commit description of a sync.done event.
+     */
+    void addEvent(EventType type,
+                  const QString& repo_name,
+                  const QString& detail = QString());
+
+    // Show the pending events right now, ignoring the rate limit
+    void flush();
+
+private slots:
+    void onTimeout();
+
+private:
+    Q_DISABLE_COPY(NotificationAggregator)
+
+    NotificationAggregator(QObject *parent=0);
+
+    static NotificationAggregator *singleton_;
+
+    struct PendingEvents {
+        int count;
+        // bounded, only the first few repo names are kept
+        QStringList repo_names;
+        QString last_detail;
+
+        PendingEvents() : count(0) {}
+    };
+
+    int pendingCount() const;
+    void notifySingle(EventType type, const PendingEvents& events);
+    void notifyDigest();
+    QString describe(EventType type, const PendingEvents& events) const;
+    void schedule();
+
+    PendingEvents pending_[N_EVENT_TYPES];
+
+    QTimer *timer_;
+
+    QDateTime last_notify_time_;
+};
+
+#endif // SEAFILE_CLIENT_NOTIFICATION_AGGREGATOR_H
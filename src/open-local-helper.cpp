@@ -156,6 +156,12 @@ void OpenLocalHelper::openLocalFile(const char *url_in)
     qDebug("[OpenLocalHelper] open local file: repo %s, path %s\n",
            info.repo_id.toUtf8().data(), info.path.toUtf8().data());
 
+    if (seafApplet->headless()) {
+        // Nothing to open the file with
+        qWarning("[OpenLocalHelper] not opening local files in headless mode");
+        return;
+    }
+
     LocalRepo repo;
     if (seafApplet->rpcClient()->getLocalRepo(info.repo_id, &repo) < 0) {
         QString msg = QObject::tr("The library \"%1\" has not been synced yet").arg(info.repo_name);
@@ -177,6 +183,12 @@ void OpenLocalHelper::openLocalFile(const char *url_in)
 
 void OpenLocalHelper::messageBox(const QString& msg)
 {
+    // No window in the headless mode
+    if (seafApplet->headless()) {
+        qWarning("[OpenLocalHelper] %s", msg.toUtf8().data());
+        return;
+    }
+
     MainWindow *win = seafApplet->mainWindow();
     win->show();
     win->raise();
@@ -1,6 +1,8 @@
 #include <QTimer>
+#include <QDateTime>
 #include <QDir>
 #include <QDesktopServices>
+#include <QSet>
 
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
@@ -8,6 +10,8 @@
 #include "account-mgr.h"
 #include "api/server-repo.h"
 #include "api/requests.h"
+#include "api/api-error.h"
+#include "utils/utils.h"
 #include "ui/main-window.h"
 #include "ui/download-repo-dialog.h"
 
@@ -16,6 +20,8 @@
 namespace {
 
 const int kRefreshReposInterval = 1000 * 60 * 5; // 5 min
+// After a failure: 30s, 1 min, 2 min, ... up to kRefreshReposInterval
+const int kRefreshAfterFailureInterval = 1000 * 30;
 
 } // namespace
 
@@ -31,92 +37,278 @@ RepoService* RepoService::instance()
 }
 
 RepoService::RepoService(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      started_(false)
 {
     refresh_timer_ = new QTimer(this);
-    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refresh()));
-    list_repo_req_ = NULL;
-    in_refresh_ = false;
+    refresh_timer_->setSingleShot(true);
+    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshDueAccounts()));
 }
 
 void RepoService::start()
 {
-    refresh_timer_->start(kRefreshReposInterval);
+    started_ = true;
+    scheduleNextRefresh();
 }
 
 void RepoService::stop()
 {
+    started_ = false;
     refresh_timer_->stop();
 }
 
+QString RepoService::accountKey(const Account& account)
+{
+    return account.username + " " + account.serverUrl.toString();
+}
+
+// Follow the accounts of the AccountManager. Returns true if an account was
+// removed.
+bool RepoService::syncAccounts()
+{
+    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
+
+    QList<AccountRepos *> synced;
+    for (size_t i = 0; i < accounts.size(); i++) {
+        QString key = accountKey(accounts[i]);
+        AccountRepos *repos = NULL;
+        for (int j = 0; j < accounts_.size(); j++) {
+            if (accounts_[j]->key == key) {
+                repos = accounts_.takeAt(j);
+                break;
+            }
+        }
+
+        if (!repos) {
+            repos = new AccountRepos;
+            repos->key = key;
+            repos->req = NULL;
+            repos->in_refresh = false;
+            repos->next_refresh = 0;
+            repos->failures = 0;
+        }
+        // e.g. a new token after logging in again
+        repos->account = accounts[i];
+        synced.append(repos);
+    }
+
+    bool removed = !accounts_.isEmpty();
+    foreach (AccountRepos *repos, accounts_) {
+        if (repos->req) {
+            repos->req->cancel();
+            repos->req->deleteLater();
+        }
+        delete repos;
+    }
+
+    accounts_ = synced;
+    return removed;
+}
+
 void RepoService::refresh()
 {
-    if (in_refresh_) {
-        return;
+    refresh(false);
+}
+
+void RepoService::refresh(bool force)
+{
+    if (syncAccounts()) {
+        mergeSnapshots();
+        emit refreshSuccess(snapshot_);
     }
 
-    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
-    if (accounts.empty()) {
-        in_refresh_ = false;
-        return;
+    // Only the account the user is looking at is worth skipping the
+    // cadence for, the others are refreshed when they are due
+    QString current;
+    if (force) {
+        current = accountKey(seafApplet->accountManager()->currentAccount());
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    foreach (AccountRepos *repos, accounts_) {
+        if (force && repos->key == current) {
+            refreshAccount(repos, true);
+        } else if (repos->next_refresh <= now) {
+            refreshAccount(repos, false);
+        }
     }
 
-    in_refresh_ = true;
+    scheduleNextRefresh();
+}
 
-    if (list_repo_req_) {
-        delete list_repo_req_;
+void RepoService::refreshDueAccounts()
+{
+    refresh(false);
+}
+
+void RepoService::refreshAccount(AccountRepos *repos, bool force)
+{
+    if (repos->in_refresh && !force) {
+        return;
     }
 
-    list_repo_req_ = new ListReposRequest(accounts[0]);
+    repos->in_refresh = true;
+    // Until the request finishes, the timer leaves this account alone
+    repos->next_refresh = QDateTime::currentMSecsSinceEpoch() + kRefreshReposInterval;
 
-    connect(list_repo_req_, SIGNAL(success(const std::vector<ServerRepo>&)),
+    ListReposRequest *old_req = repos->req;
+
+    repos->req = new ListReposRequest(repos->account);
+
+    connect(repos->req, SIGNAL(success(const std::vector<ServerRepo>&)),
             this, SLOT(onRefreshSuccess(const std::vector<ServerRepo>&)));
 
-    connect(list_repo_req_, SIGNAL(failed(const ApiError&)),
+    connect(repos->req, SIGNAL(failed(const ApiError&)),
             this, SLOT(onRefreshFailed(const ApiError&)));
-    list_repo_req_->send();
+    repos->req->send();
+
+    // Cancelled after the new request is sent: if the old one is still in
+    // flight, the new one takes over its reply instead of sending another
+    if (old_req) {
+        old_req->cancel();
+        old_req->deleteLater();
+    }
+}
+
+RepoService::AccountRepos *RepoService::findBySender()
+{
+    foreach (AccountRepos *repos, accounts_) {
+        if (repos->req == sender()) {
+            return repos;
+        }
+    }
+    return NULL;
 }
 
 void RepoService::onRefreshSuccess(const std::vector<ServerRepo>& repos)
 {
-    in_refresh_ = false;
+    AccountRepos *account_repos = findBySender();
+    if (!account_repos) {
+        return;
+    }
+
+    account_repos->in_refresh = false;
+    account_repos->failures = 0;
+    account_repos->last_error.clear();
+    account_repos->next_refresh = QDateTime::currentMSecsSinceEpoch() + kRefreshReposInterval;
+
+    std::vector<ServerRepo> tagged(repos);
+    for (size_t i = 0; i < tagged.size(); i++) {
+        tagged[i].account = account_repos->key;
+    }
+
+    // Publish the new snapshot in one step. Readers holding the previous one
+    // keep it alive until they drop it.
+    account_repos->snapshot = RepoSnapshot(tagged, QDateTime::currentMSecsSinceEpoch());
+    mergeSnapshots();
+    seafApplet->onFirstRepoList();
 
-    server_repos_ = repos;
+    scheduleNextRefresh();
 
-    emit refreshSuccess(repos);
+    emit refreshSuccess(snapshot_);
 }
 
 void RepoService::onRefreshFailed(const ApiError& error)
 {
-    in_refresh_ = false;
+    AccountRepos *account_repos = findBySender();
+    if (!account_repos) {
+        return;
+    }
+
+    account_repos->in_refresh = false;
+    account_repos->last_error = error.toString();
+    int interval = kRefreshAfterFailureInterval << qMin(account_repos->failures, 8);
+    account_repos->next_refresh = QDateTime::currentMSecsSinceEpoch()
+        + qMin(interval, kRefreshReposInterval);
+    account_repos->failures++;
+
+    qWarning("failed to refresh the libraries of %s: %s",
+             toCStr(account_repos->key), toCStr(account_repos->last_error));
+
+    scheduleNextRefresh();
 
     emit refreshFailed(error);
 }
 
-void RepoService::refresh(bool force)
+void RepoService::mergeSnapshots()
 {
-    if (!force || !in_refresh_) {
-        refresh();
+    if (accounts_.size() == 1) {
+        snapshot_ = accounts_[0]->snapshot;
         return;
     }
 
-    // Abort the current request and send another
-    in_refresh_ = false;
-    refresh();
+    // A library shared with several of the accounts is listed once, for the
+    // first of them
+    std::vector<ServerRepo> merged;
+    QSet<QString> seen;
+    qint64 timestamp = 0;
+    foreach (AccountRepos *repos, accounts_) {
+        const std::vector<ServerRepo>& list = repos->snapshot.repos();
+        for (size_t i = 0; i < list.size(); i++) {
+            if (!seen.contains(list[i].id)) {
+                merged.push_back(list[i]);
+            }
+        }
+        for (size_t i = 0; i < list.size(); i++) {
+            seen.insert(list[i].id);
+        }
+        timestamp = qMax(timestamp, repos->snapshot.timestamp());
+    }
+
+    snapshot_ = RepoSnapshot(merged, timestamp);
 }
 
-ServerRepo
-RepoService::getRepo(const QString& repo_id) const
+void RepoService::scheduleNextRefresh()
 {
-    int i, n = server_repos_.size();
-    for (i = 0; i < n; i++) {
-        ServerRepo repo = server_repos_[i];
-        if (repo.id == repo_id) {
-            return repo;
+    if (!started_ || accounts_.isEmpty()) {
+        return;
+    }
+
+    qint64 next = accounts_[0]->next_refresh;
+    foreach (AccountRepos *repos, accounts_) {
+        next = qMin(next, repos->next_refresh);
+    }
+
+    qint64 delay = next - QDateTime::currentMSecsSinceEpoch();
+    refresh_timer_->start(qBound((qint64)0, delay, (qint64)kRefreshReposInterval));
+}
+
+RepoSnapshot RepoService::snapshot(const Account& account) const
+{
+    QString key = accountKey(account);
+    foreach (const AccountRepos *repos, accounts_) {
+        if (repos->key == key) {
+            return repos->snapshot;
         }
     }
+    return RepoSnapshot();
+}
 
-    return ServerRepo();
+Account RepoService::accountForRepo(const ServerRepo& repo) const
+{
+    foreach (const AccountRepos *repos, accounts_) {
+        if (repos->key == repo.account) {
+            return repos->account;
+        }
+    }
+    return seafApplet->accountManager()->currentAccount();
+}
+
+QStringList RepoService::failedAccounts() const
+{
+    QStringList failed;
+    foreach (const AccountRepos *repos, accounts_) {
+        if (!repos->last_error.isEmpty()) {
+            failed << repos->account.username + "@" + repos->account.serverUrl.host();
+        }
+    }
+    return failed;
+}
+
+ServerRepo
+RepoService::getRepo(const QString& repo_id) const
+{
+    return snapshot_.getRepo(repo_id);
 }
 
 void RepoService::openLocalFile(const QString& repo_id,
@@ -132,17 +324,24 @@ void RepoService::openLocalFile(const QString& repo_id,
 
         QDesktopServices::openUrl(QUrl::fromLocalFile(path));
     } else {
-        ServerRepo repo = getRepo(repo_id);
-        if (!repo.isValid()) {
+        // Hold the snapshot so the repo stays valid while the dialog is shown
+        RepoSnapshot snapshot = snapshot_;
+        const ServerRepo *repo = snapshot.findRepo(repo_id);
+        if (!repo) {
+            return;
+        }
+
+        if (seafApplet->headless()) {
+            qWarning("the library %s is not synced yet", toCStr(repo_id));
             return;
         }
 
         QString msg = tr("The library of this file is not synced yet. Do you want to sync it now?");
         if (seafApplet->yesOrNoBox(msg, NULL, true)) {
-            Account account = seafApplet->accountManager()->currentAccount();
+            Account account = accountForRepo(*repo);
             if (account.isValid()) {
                 QWidget *parent = dialog_parent ? dialog_parent : seafApplet->mainWindow();
-                DownloadRepoDialog dialog(account, repo, parent);
+                DownloadRepoDialog dialog(account, *repo, parent);
                 dialog.exec();
             }
         }
@@ -3,14 +3,27 @@
 
 #include <vector>
 #include <QObject>
+#include <QList>
+#include <QStringList>
 
+#include "account.h"
 #include "api/server-repo.h"
+#include "repo-snapshot.h"
 
 class QTimer;
 
 class ApiError;
 class ListReposRequest;
 
+/**
+ * Keeps the list of the libraries of every account.
+ *
+ * Each account is refreshed on its own: it has its own request, snapshot,
+ * refresh time and error state, so a slow or failing server doesn't hold
+ * back the others. The snapshot published to the views merges the
+ * libraries of all the accounts, each tagged with its account (see
+ * ServerRepo::account).
+ */
 class RepoService : public QObject
 {
     Q_OBJECT
@@ -20,10 +33,32 @@ public:
     void start();
     void stop();
 
-    const std::vector<ServerRepo>& serverRepos() const { return server_repos_; }
+    /**
+     * The latest list of repos of all the accounts. Readers should keep a
+     * copy of the snapshot instead of the reference, since a refresh
+     * replaces it.
+     */
+    RepoSnapshot snapshot() const { return snapshot_; }
+
+    // The latest list of repos of one account, empty if not fetched yet
+    RepoSnapshot snapshot(const Account& account) const;
+
+    // The account a repo of the merged snapshot was listed for, the current
+    // account if unknown
+    Account accountForRepo(const ServerRepo& repo) const;
+
+    static QString accountKey(const Account& account);
+
+    // The accounts whose last refresh failed
+    QStringList failedAccounts() const;
+
+    const std::vector<ServerRepo>& serverRepos() const { return snapshot_.repos(); }
 
     ServerRepo getRepo(const QString& repo_id) const;
 
+    // Refreshes the accounts whose refresh is due. With force, the current
+    // account is refreshed right away as well, even if a request of it is
+    // in flight
     void refresh(bool force);
 
     void openLocalFile(const QString& repo_id,
@@ -36,9 +71,10 @@ public slots:
 private slots:
     void onRefreshSuccess(const std::vector<ServerRepo>& repos);
     void onRefreshFailed(const ApiError& error);
+    void refreshDueAccounts();
 
 signals:
-    void refreshSuccess(const std::vector<ServerRepo>& repos);
+    void refreshSuccess(const RepoSnapshot& snapshot);
     void refreshFailed(const ApiError& error);
 
 private:
@@ -46,14 +82,35 @@ private:
 
     RepoService(QObject *parent=0);
 
+    struct AccountRepos {
+        Account account;
+        // the value of ServerRepo::account for the repos of this account
+        QString key;
+        ListReposRequest *req;
+        RepoSnapshot snapshot;
+        bool in_refresh;
+        // msecs since epoch
+        qint64 next_refresh;
+        // consecutive failures, the refresh is retried sooner
+        int failures;
+        QString last_error;
+    };
+
+    bool syncAccounts();
+    void refreshAccount(AccountRepos *repos, bool force);
+    AccountRepos *findBySender();
+    void mergeSnapshots();
+    void scheduleNextRefresh();
+
     static RepoService *singleton_;
 
-    ListReposRequest *list_repo_req_;
+    // in the order of AccountManager::accounts(), current account first
+    QList<AccountRepos *> accounts_;
 
-    std::vector<ServerRepo> server_repos_;
+    RepoSnapshot snapshot_;
 
     QTimer *refresh_timer_;
-    bool in_refresh_;
+    bool started_;
 };
 
 #endif // SEAFILE_CLIENT_REPO_SERVICE_H_
@@ -0,0 +1,91 @@
+#include "repo-snapshot.h"
+
+namespace {
+
+RepoSnapshotData *emptySnapshotData()
+{
+    static RepoSnapshotData *empty = NULL;
+    if (empty == NULL) {
+        empty = new RepoSnapshotData;
+        empty->timestamp = 0;
+        // Never freed
+        empty->ref.ref();
+    }
+
+    return empty;
+}
+
+} // namespace
+
+RepoSnapshot::RepoSnapshot()
+    : d_(emptySnapshotData())
+{
+}
+
+RepoSnapshot::RepoSnapshot(const std::vector<ServerRepo>& repos, qint64 timestamp)
+    : d_(new RepoSnapshotData)
+{
+    d_->repos = repos;
+    d_->timestamp = timestamp;
+
+    int i, n = repos.size();
+    d_->index.reserve(n);
+    for (i = 0; i < n; i++) {
+        RepoId repo_id = repos[i].repoId();
+        if (repo_id.isNull()) {
+            d_->other_index.insert(repos[i].id, i);
+        } else {
+            d_->index.insert(repo_id, i);
+        }
+    }
+}
+
+const std::vector<ServerRepo>& RepoSnapshot::repos() const
+{
+    return d_->repos;
+}
+
+int RepoSnapshot::size() const
+{
+    return d_->repos.size();
+}
+
+qint64 RepoSnapshot::timestamp() const
+{
+    return d_->timestamp;
+}
+
+const ServerRepo *RepoSnapshot::findRepo(const RepoId& repo_id) const
+{
+    if (repo_id.isNull()) {
+        return NULL;
+    }
+
+    QHash<RepoId, int>::const_iterator iter = d_->index.constFind(repo_id);
+    if (iter == d_->index.constEnd()) {
+        return NULL;
+    }
+
+    return &d_->repos[iter.value()];
+}
+
+const ServerRepo *RepoSnapshot::findRepo(const QString& repo_id) const
+{
+    RepoId id = RepoId::fromString(repo_id);
+    if (!id.isNull()) {
+        return findRepo(id);
+    }
+
+    QHash<QString, int>::const_iterator iter = d_->other_index.constFind(repo_id);
+    if (iter == d_->other_index.constEnd()) {
+        return NULL;
+    }
+
+    return &d_->repos[iter.value()];
+}
+
+ServerRepo RepoSnapshot::getRepo(const QString& repo_id) const
+{
+    const ServerRepo *repo = findRepo(repo_id);
+    return repo ? *repo : ServerRepo();
+}
@@ -0,0 +1,68 @@
+#ifndef SEAFILE_CLIENT_REPO_SNAPSHOT_H
+#define SEAFILE_CLIENT_REPO_SNAPSHOT_H
+
+#include <vector>
+#include <QHash>
+#include <QMetaType>
+#include <QSharedData>
+#include <QExplicitlySharedDataPointer>
+
+#include "api/server-repo.h"
+#include "utils/repo-id.h"
+
+class RepoSnapshotData : public QSharedData {
+public:
+    std::vector<ServerRepo> repos;
+    QHash<RepoId, int> index;
+    // the repos whose id isn't a uuid, which have a null RepoId
+    QHash<QString, int> other_index;
+    qint64 timestamp;
+};
+
+/**
+ * An immutable list of server repos, together with an id -> index hash.
+ *
+ * RepoSnapshot is implicitly shared: copying it only increases a reference
+ * count, so it can be passed around by value and kept by any number of
+ * readers without copying the repos. Since a snapshot never changes after
+ * being created, a reader may keep one for as long as it wants, while the
+ * RepoService publishes newer ones.
+ */
+class RepoSnapshot {
+public:
+    RepoSnapshot();
+    explicit RepoSnapshot(const std::vector<ServerRepo>& repos,
+                          qint64 timestamp = 0);
+
+    const std::vector<ServerRepo>& repos() const;
+
+    int size() const;
+    bool isEmpty() const { return size() == 0; }
+
+    // Time this snapshot was fetched from the server (msecs since epoch)
+    qint64 timestamp() const;
+
+    /**
+     * Returns NULL if there is no such repo in the snapshot. The pointer is
+     * valid as long as the snapshot (or a copy of it) is alive.
+     */
+    const ServerRepo *findRepo(const QString& repo_id) const;
+    const ServerRepo *findRepo(const RepoId& repo_id) const;
+
+    bool contains(const QString& repo_id) const { return findRepo(repo_id) != NULL; }
+
+    /**
+     * Returns an invalid ServerRepo if there is no such repo in the snapshot
+     */
+    ServerRepo getRepo(const QString& repo_id) const;
+
+private:
+    QExplicitlySharedDataPointer<RepoSnapshotData> d_;
+};
+
+/**
+ * Register with QMetaType so we can wrap it with QVariant::fromValue
+ */
+Q_DECLARE_METATYPE(RepoSnapshot)
+
+#endif // SEAFILE_CLIENT_REPO_SNAPSHOT_H
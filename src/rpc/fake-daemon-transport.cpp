@@ -0,0 +1,140 @@
+#include <glib.h>
+#include <string.h>
+
+#include <QByteArray>
+#include <QLocalSocket>
+#include <QtEndian>
+#include <QtDebug>
+
+#include "utils/utils.h"
+#include "fake-daemon-transport.h"
+
+namespace {
+
+const char *kFakeDaemonEnv = "SEAFILE_FAKE_DAEMON";
+
+const int kConnectTimeoutMSecs = 3000;
+// The stand-in daemon may be told to be very slow
+const int kCallTimeoutMSecs = 60000;
+
+// Larger responses mean a broken stream
+const quint32 kMaxMessageSize = 256 * 1024 * 1024;
+
+struct FakeDaemonConnection {
+    QString socket_path;
+    QByteArray service;
+    QLocalSocket *socket;
+};
+
+bool writeMessage(QLocalSocket *socket, const QByteArray& payload)
+{
+    uchar header[4];
+    qToBigEndian<quint32>(payload.size(), header);
+
+    if (socket->write((const char *)header, 4) != 4 ||
+        socket->write(payload) != payload.size()) {
+        return false;
+    }
+
+    while (socket->bytesToWrite() > 0) {
+        if (!socket->waitForBytesWritten(kCallTimeoutMSecs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readExactly(QLocalSocket *socket, qint64 size, QByteArray *out)
+{
+    out->clear();
+    while (out->size() < size) {
+        if (socket->bytesAvailable() == 0 &&
+            !socket->waitForReadyRead(kCallTimeoutMSecs)) {
+            return false;
+        }
+        *out += socket->read(size - out->size());
+    }
+    return true;
+}
+
+bool readMessage(QLocalSocket *socket, QByteArray *payload)
+{
+    QByteArray header;
+    if (!readExactly(socket, 4, &header)) {
+        return false;
+    }
+
+    quint32 size = qFromBigEndian<quint32>((const uchar *)header.constData());
+    if (size > kMaxMessageSize) {
+        return false;
+    }
+
+    return readExactly(socket, size, payload);
+}
+
+bool ensureConnected(FakeDaemonConnection *conn)
+{
+    if (conn->socket->state() == QLocalSocket::ConnectedState) {
+        return true;
+    }
+
+    conn->socket->abort();
+    conn->socket->connectToServer(conn->socket_path);
+    if (!conn->socket->waitForConnected(kConnectTimeoutMSecs)) {
+        qWarning("[FakeDaemon] failed to connect to %s: %s",
+                 toCStr(conn->socket_path), toCStr(conn->socket->errorString()));
+        return false;
+    }
+
+    return writeMessage(conn->socket, conn->service);
+}
+
+/**
+ * The searpc TransportCB. The returned string is freed by searpc.
+ */
+gchar *fakeDaemonTransportSend(void *arg, const gchar *fcall_str,
+                               size_t fcall_len, size_t *ret_len)
+{
+    FakeDaemonConnection *conn = (FakeDaemonConnection *)arg;
+
+    if (!ensureConnected(conn)) {
+        return NULL;
+    }
+
+    QByteArray response;
+    if (!writeMessage(conn->socket, QByteArray(fcall_str, fcall_len)) ||
+        !readMessage(conn->socket, &response)) {
+        qWarning("[FakeDaemon] call failed: %s", toCStr(conn->socket->errorString()));
+        conn->socket->abort();
+        return NULL;
+    }
+
+    *ret_len = response.size();
+    gchar *ret = (gchar *)g_malloc(response.size() + 1);
+    memcpy(ret, response.constData(), response.size());
+    ret[response.size()] = '\0';
+    return ret;
+}
+
+} // namespace
+
+QString fakeDaemonSocketPath()
+{
+    return QString::fromLocal8Bit(qgetenv(kFakeDaemonEnv));
+}
+
+SearpcClient *createFakeDaemonRpcClient(const QString& socket_path,
+                                        const char *service)
+{
+    // Lives as long as the applet, like the ccnet rpc clients
+    FakeDaemonConnection *conn = new FakeDaemonConnection;
+    conn->socket_path = socket_path;
+    conn->service = service;
+    conn->socket = new QLocalSocket;
+
+    SearpcClient *client = searpc_client_new();
+    client->send = fakeDaemonTransportSend;
+    client->arg = conn;
+
+    return client;
+}
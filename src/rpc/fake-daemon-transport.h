@@ -0,0 +1,38 @@
+#ifndef SEAFILE_CLIENT_RPC_FAKE_DAEMON_TRANSPORT_H
+#define SEAFILE_CLIENT_RPC_FAKE_DAEMON_TRANSPORT_H
+
+#include <QString>
+
+extern "C" {
+#include <searpc-client.h>
+}
+
+/**
+ * Searpc transport to the stand-in daemon of tools/fake-daemon, which
+ * answers the rpc calls of the client with generated libraries and an
+ * injected latency, so the rpc layer and the views can be measured without
+ * ccnet and seaf-daemon.
+ *
+ * Only built with ENABLE_FAKE_DAEMON (cmake) or CONFIG+=fake_daemon (qmake),
+ * never in the shipped binaries. It is then used instead of ccnet when
+ * SEAFILE_FAKE_DAEMON is set to the path of the socket of the stand-in
+ * daemon. The calls are the same searpc json
+ * calls, framed on a local socket: each message is a 4-byte big endian
+ * length followed by the payload, and the first message of a connection is
+ * the name of the rpc service.
+ */
+
+/**
+ * The path of the socket of the stand-in daemon, or an empty string when
+ * the real daemon is used
+ */
+QString fakeDaemonSocketPath();
+
+/**
+ * Create a searpc client which sends the calls of @service to the stand-in
+ * daemon listening on @socket_path
+ */
+SearpcClient *createFakeDaemonRpcClient(const QString& socket_path,
+                                        const char *service);
+
+#endif // SEAFILE_CLIENT_RPC_FAKE_DAEMON_TRANSPORT_H
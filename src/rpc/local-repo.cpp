@@ -45,6 +45,26 @@ LocalRepo LocalRepo::fromGObject(GObject *obj)
     return repo;
 }
 
+const char *LocalRepo::syncStateName() const
+{
+    switch (sync_state) {
+    case SYNC_STATE_DISABLED:
+        return "disabled";
+    case SYNC_STATE_WAITING:
+        return "waiting";
+    case SYNC_STATE_INIT:
+        return "initializing";
+    case SYNC_STATE_ING:
+        return "syncing";
+    case SYNC_STATE_DONE:
+        return "done";
+    case SYNC_STATE_ERROR:
+        return "error";
+    default:
+        return "unknown";
+    }
+}
+
 void LocalRepo::setSyncInfo(QString state, QString error)
 {
     // qDebug("error: %s\n", toCStr(error));
@@ -57,6 +57,9 @@ public:
 
     void setSyncInfo(QString state, QString error = QString());
 
+    // Untranslated name of the sync state, e.g. "syncing"
+    const char *syncStateName() const;
+
 private:
     void translateSyncError(QString error);
     void translateSyncState(QString state);
@@ -14,8 +14,15 @@ extern "C" {
 #include "settings-mgr.h"
 
 #include "utils/utils.h"
+#include "utils/trace.h"
+#include "utils/trace-recorder.h"
+#include "utils/probes.h"
+#include "utils/perf-stats.h"
 #include "local-repo.h"
 #include "clone-task.h"
+#ifdef SEAFILE_FAKE_DAEMON_ENABLED
+#include "fake-daemon-transport.h"
+#endif
 #include "rpc-client.h"
 
 
@@ -24,6 +31,39 @@ namespace {
 const char *kSeafileRpcService = "seafile-rpcserver";
 const char *kCcnetRpcService = "ccnet-rpcserver";
 
+/**
+ * Instruments one rpc call: records a trace span, counts the call in the
+ * PerfStats and fires the rpc__start/rpc__done probes.
+ */
+class RpcCallScope {
+public:
+    RpcCallScope(const char *method, bool record_stats)
+        : span_("rpc", method),
+          perf_(PerfStats::RPC, method, record_stats),
+          method_(method),
+          start_us_(0) {
+        if (SEAFILE_PROBE_ENABLED(rpc__done)) {
+            start_us_ = g_get_monotonic_time();
+        }
+        SEAFILE_PROBE1(rpc__start, method_);
+    }
+
+    ~RpcCallScope() {
+        // No start time if the tracer attached during the call, skip it
+        // rather than report a made up duration
+        if (SEAFILE_PROBE_ENABLED(rpc__done) && start_us_ > 0) {
+            long duration_us = (long)(g_get_monotonic_time() - start_us_);
+            SEAFILE_PROBE2(rpc__done, method_, duration_us);
+        }
+    }
+
+private:
+    TraceSpan span_;
+    PerfScope perf_;
+    const char *method_;
+    gint64 start_us_;
+};
+
 } // namespace
 
 #define toCStr(_s)   ((_s).isNull() ? NULL : (_s).toUtf8().data())
@@ -31,12 +71,23 @@ const char *kCcnetRpcService = "ccnet-rpcserver";
 SeafileRpcClient::SeafileRpcClient()
       : sync_client_(0),
         seafile_rpc_client_(0),
-        ccnet_rpc_client_(0)
+        ccnet_rpc_client_(0),
+        record_stats_(true)
 {
 }
 
 void SeafileRpcClient::connectDaemon()
 {
+#ifdef SEAFILE_FAKE_DAEMON_ENABLED
+    QString fake_daemon = fakeDaemonSocketPath();
+    if (!fake_daemon.isEmpty()) {
+        seafile_rpc_client_ = createFakeDaemonRpcClient(fake_daemon, kSeafileRpcService);
+        ccnet_rpc_client_ = createFakeDaemonRpcClient(fake_daemon, kCcnetRpcService);
+        qDebug("[Rpc Client] using the stand-in daemon at %s", toCStr(fake_daemon));
+        return;
+    }
+#endif
+
     sync_client_ = ccnet_client_new();
 
     const QString config_dir = seafApplet->configurator()->ccnetDir();
@@ -56,6 +107,10 @@ void SeafileRpcClient::connectDaemon()
 
 int SeafileRpcClient::listLocalRepos(std::vector<LocalRepo> *result)
 {
+    if (!isConnected()) {
+        return -1;
+    }
+    RpcCallScope rpc_call("seafile_get_repo_list", record_stats_);
     GError *error = NULL;
     GList *repos = seafile_get_repo_list(seafile_rpc_client_, 0, 0, &error);
     if (repos == NULL) {
@@ -67,6 +122,8 @@ int SeafileRpcClient::listLocalRepos(std::vector<LocalRepo> *result)
         result->push_back(LocalRepo::fromGObject((GObject*)ptr->data));
     }
 
+    SEAFILE_TRACE(TRACE_RPC, "seafile_get_repo_list: %d repos", (int)result->size());
+
     g_list_foreach (repos, (GFunc)g_object_unref, NULL);
     g_list_free (repos);
 
@@ -169,6 +226,10 @@ int SeafileRpcClient::cloneRepo(const QString& id,
 
 int SeafileRpcClient::getLocalRepo(const QString& repo_id, LocalRepo *repo)
 {
+    if (!isConnected()) {
+        return -1;
+    }
+    RpcCallScope rpc_call("seafile_get_repo", record_stats_);
     GError *error = NULL;
     GObject *obj = searpc_client_call__object(
         seafile_rpc_client_,
@@ -178,6 +239,7 @@ int SeafileRpcClient::getLocalRepo(const QString& repo_id, LocalRepo *repo)
         "string", toCStr(repo_id));
 
     if (error != NULL) {
+        SEAFILE_TRACE(TRACE_RPC, "seafile_get_repo %s: %s", toCStr(repo_id), error->message);
         return -1;
     }
 
@@ -304,6 +366,7 @@ bool SeafileRpcClient::hasLocalRepo(const QString& repo_id)
 
 void SeafileRpcClient::getSyncStatus(LocalRepo &repo)
 {
+    RpcCallScope rpc_call("seafile_get_repo_sync_task", record_stats_);
     if (repo.worktree_invalid) {
         repo.setSyncInfo("error", "invalid worktree");
         return;
@@ -340,6 +403,10 @@ void SeafileRpcClient::getSyncStatus(LocalRepo &repo)
 
 int SeafileRpcClient::getCloneTasks(std::vector<CloneTask> *tasks)
 {
+    if (!isConnected()) {
+        return -1;
+    }
+    RpcCallScope rpc_call("seafile_get_clone_tasks", record_stats_);
     GError *error = NULL;
     GList *objlist = searpc_client_call__objlist(
         seafile_rpc_client_,
@@ -375,6 +442,7 @@ int SeafileRpcClient::getCloneTasks(std::vector<CloneTask> *tasks)
 
 void SeafileRpcClient::getTransferDetail(CloneTask* task)
 {
+    RpcCallScope rpc_call("seafile_find_transfer_task", record_stats_);
     GError *error = NULL;
     GObject *obj = searpc_client_call__object(
         seafile_rpc_client_,
@@ -413,6 +481,7 @@ void SeafileRpcClient::getTransferDetail(CloneTask* task)
 
 void SeafileRpcClient::getCheckOutDetail(CloneTask *task)
 {
+    RpcCallScope rpc_call("seafile_get_checkout_task", record_stats_);
     GError *error = NULL;
     GObject *obj = searpc_client_call__object(
         seafile_rpc_client_,
@@ -479,6 +548,7 @@ int SeafileRpcClient::removeCloneTask(const QString& repo_id, QString *err)
 
 int SeafileRpcClient::getCloneTasksCount(int *count)
 {
+    RpcCallScope rpc_call("seafile_get_clone_tasks", record_stats_);
     GError *error = NULL;
     GList *objlist = searpc_client_call__objlist(
         seafile_rpc_client_,
@@ -502,6 +572,7 @@ int SeafileRpcClient::getCloneTasksCount(int *count)
 
 int SeafileRpcClient::getServers(GList** servers)
 {
+    RpcCallScope rpc_call("get_peers_by_role", record_stats_);
     GError *error = NULL;
     GList *objlist = searpc_client_call__objlist(
         ccnet_rpc_client_,
@@ -543,6 +614,7 @@ int SeafileRpcClient::unsyncReposByAccount(const QString& server_addr,
 
 int SeafileRpcClient::getDownloadRate(int *rate)
 {
+    RpcCallScope rpc_call("seafile_get_download_rate", record_stats_);
     GError *error = NULL;
     int ret = searpc_client_call__int (seafile_rpc_client_,
                                        "seafile_get_download_rate",
@@ -558,6 +630,7 @@ int SeafileRpcClient::getDownloadRate(int *rate)
 
 int SeafileRpcClient::getUploadRate(int *rate)
 {
+    RpcCallScope rpc_call("seafile_get_upload_rate", record_stats_);
     GError *error = NULL;
     int ret = searpc_client_call__int (seafile_rpc_client_,
                                        "seafile_get_upload_rate",
@@ -594,13 +667,19 @@ int SeafileRpcClient::unsync(const QString& repo_id)
 
 int SeafileRpcClient::getRepoTransferInfo(const QString& repo_id, int *rate, int *percent)
 {
+    if (!isConnected()) {
+        return -1;
+    }
+    RpcCallScope rpc_call("seafile_find_transfer_task", record_stats_);
     GError *error = NULL;
     GObject *task = searpc_client_call__object (seafile_rpc_client_,
                                                 "seafile_find_transfer_task",
                                                 SEAFILE_TYPE_TASK,
                                                 &error, 1,
                                                 "string", toCStr(repo_id));
-    if (error) {return -1;
+    if (error) {
+        SEAFILE_TRACE(TRACE_RPC, "seafile_find_transfer_task %s: %s", toCStr(repo_id), error->message);
+        return -1;
     }
 
     if (!task) {
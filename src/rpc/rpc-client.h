@@ -23,6 +23,14 @@ public:
     SeafileRpcClient();
     void connectDaemon();
 
+    // The queries used by the models fail instead of crashing before
+    // connectDaemon(), e.g. in the benchmarks
+    bool isConnected() const { return seafile_rpc_client_ != 0; }
+
+    // Whether the calls are recorded in PerfStats. Off for a client whose
+    // calls aren't the applet's own, e.g. the one of the metrics collector.
+    void setRecordStats(bool record_stats) { record_stats_ = record_stats; }
+
     int listLocalRepos(std::vector<LocalRepo> *repos);
     int getLocalRepo(const QString& repo_id, LocalRepo *repo);
     int setAutoSync(const bool autoSync);
@@ -95,6 +103,8 @@ private:
     _CcnetClient *sync_client_;
     SearpcClient *seafile_rpc_client_;
     SearpcClient *ccnet_rpc_client_;
+
+    bool record_stats_;
 };
 
 #endif
@@ -8,16 +8,22 @@
 #include <QMessageBox>
 #include <QTimer>
 
+#include <stdio.h>
 #include <glib.h>
 
 #include "utils/utils.h"
 #include "utils/log.h"
+#include "utils/trace.h"
+#include "utils/trace-recorder.h"
+#include "utils/perf-stats.h"
+#include "utils/process.h"
 #include "account-mgr.h"
 #include "configurator.h"
 #include "daemon-mgr.h"
 #include "message-listener.h"
 #include "settings-mgr.h"
 #include "certs-mgr.h"
+#include "api/api-client.h"
 #include "rpc/rpc-client.h"
 #include "ui/main-window.h"
 #include "ui/tray-icon.h"
@@ -26,7 +32,12 @@
 #include "ui/login-dialog.h"
 #include "open-local-helper.h"
 #include "avatar-service.h"
+#include "metrics-server.h"
 #include "seahub-notifications-monitor.h"
+#include "server-info-service.h"
+#include "transfer-stats-service.h"
+#include "repo-service.h"
+#include "daemon-control-server.h"
 
 #include "seafile-applet.h"
 
@@ -100,36 +111,60 @@ const char *kSeafileClientDownloadUrlChinese = "http://seafile.com/download/";
 
 SeafileApplet *seafApplet;
 
-SeafileApplet::SeafileApplet()
+SeafileApplet::SeafileApplet(bool headless)
     : configurator_(new Configurator),
       account_mgr_(new AccountManager),
       daemon_mgr_(new DaemonManager),
       main_win_(NULL),
       rpc_client_(new SeafileRpcClient),
       message_listener_(new MessageListener),
-      settings_dialog_(new SettingsDialog),
+      tray_icon_(NULL),
+      settings_dialog_(headless ? NULL : new SettingsDialog),
       settings_mgr_(new SettingsManager),
       certs_mgr_(new CertsManager),
+      control_server_(NULL),
+      headless_(headless),
       started_(false),
-      in_exit_(false)
+      in_exit_(false),
+      startup_time_(-1),
+      first_repo_list_time_(-1)
 {
-    tray_icon_ = new SeafileTrayIcon(this);
+    startup_timer_.start();
+    if (!headless_) {
+        tray_icon_ = new SeafileTrayIcon(this);
+    }
 }
 
 void SeafileApplet::start()
 {
-    refreshQss();
+    if (headless_) {
+        // No dialog to guide the user through the first time setup
+        if (configurator_->needInitConfig()) {
+            errorAndExit(tr("%1 is not configured yet, run it once without --headless, "
+                            "or pass the config dir with -c").arg(getBrand()));
+        }
+    } else {
+        refreshQss();
+    }
 
     configurator_->checkInit();
 
     initLog();
 
+    PerfStats::instance()->startCountingTimers();
+
     account_mgr_->start();
 
     certs_mgr_->start();
 
-    AvatarService::instance()->start();
-    SeahubNotificationsMonitor::instance()->start();
+    // While the daemons start
+    preconnectServers();
+
+    if (!headless_) {
+        AvatarService::instance()->start();
+        SeahubNotificationsMonitor::instance()->start();
+        ServerInfoService::instance()->start();
+    }
 
 #if defined(Q_WS_WIN)
     QString crash_rpt_path = QDir(configurator_->ccnetDir()).filePath("logs/seafile-crash-report.txt");
@@ -143,14 +178,50 @@ void SeafileApplet::start()
             this, SLOT(onDaemonStarted()));
 }
 
+void SeafileApplet::preconnectServers()
+{
+    QSet<QString> servers;
+    const std::vector<Account>& accounts = account_mgr_->accounts();
+    for (size_t i = 0; i < accounts.size(); i++) {
+        const QUrl& url = accounts[i].serverUrl;
+        QString server = QString("%1://%2:%3").arg(url.scheme()).arg(url.host()).arg(url.port());
+        if (!servers.contains(server)) {
+            servers.insert(server);
+            SeafileApiClient::preconnect(url);
+        }
+    }
+}
+
+void SeafileApplet::onFirstRepoList()
+{
+    if (first_repo_list_time_ >= 0) {
+        return;
+    }
+
+    first_repo_list_time_ = startup_timer_.elapsed();
+    qDebug("got the first list of libraries %lld ms after start",
+           (long long)first_repo_list_time_);
+}
+
 void SeafileApplet::onDaemonStarted()
 {
+    if (headless_) {
+        onDaemonStartedHeadless();
+        return;
+    }
+
     main_win_ = new MainWindow;
 
     rpc_client_->connectDaemon();
     message_listener_->connectDaemon();
+    TransferStatsService::instance()->start();
     seafApplet->settingsManager()->loadSettings();
 
+    int metrics_port = settings_mgr_->metricsPort();
+    if (metrics_port > 0) {
+        MetricsServer::instance()->start(metrics_port);
+    }
+
 #if defined(Q_WS_MAC)
     seafApplet->settingsManager()->setHideDockIcon(seafApplet->settingsManager()->hideDockIcon());
 #endif
@@ -179,6 +250,40 @@ void SeafileApplet::onDaemonStarted()
     }
 
     OpenLocalHelper::instance()->checkPendingOpenLocalRequest();
+
+    startup_time_ = startup_timer_.elapsed();
+    qDebug("started in %lld ms, resident memory %lld KB",
+           (long long)startup_time_, process_resident_memory() / 1024);
+}
+
+void SeafileApplet::onDaemonStartedHeadless()
+{
+    rpc_client_->connectDaemon();
+    message_listener_->connectDaemon();
+    TransferStatsService::instance()->start();
+    settings_mgr_->loadSettings();
+
+    int metrics_port = settings_mgr_->metricsPort();
+    if (metrics_port > 0) {
+        MetricsServer::instance()->start(metrics_port);
+    }
+
+    // Keep the list of the libraries on the server up to date, as the
+    // repos tab does in the gui mode
+    RepoService::instance()->start();
+    RepoService::instance()->refresh();
+
+    control_server_ = new DaemonControlServer(this);
+    if (!control_server_->start()) {
+        errorAndExit(tr("Failed to start the control server"));
+        return;
+    }
+
+    started_ = true;
+
+    startup_time_ = startup_timer_.elapsed();
+    qDebug("started in headless mode in %lld ms, resident memory %lld KB",
+           (long long)startup_time_, process_resident_memory() / 1024);
 }
 
 void SeafileApplet::checkInitVDrive()
@@ -201,6 +306,11 @@ void SeafileApplet::exit(int code)
     // Must use the global namespace, or the "exit" would call itself util
     // stack overflow
     daemon_mgr_->stopAll();
+    TransferStatsService::instance()->stop();
+    const char *trace_file = g_getenv("SEAFILE_TRACE_FILE");
+    if (trace_file && TraceRecorder::isEnabled()) {
+        TraceRecorder::instance()->exportToFile(QString::fromLocal8Bit(trace_file));
+    }
     // Remove tray icon from system tray
     delete tray_icon_;
     if (main_win_) {
@@ -227,6 +337,11 @@ void SeafileApplet::initLog()
         errorAndExit(tr("Failed to initialize log"));
     } else {
         qInstallMsgHandler(myLogHandler);
+        initTraceFromEnv();
+        // --trace-file: record from the start, and save when we exit
+        if (g_getenv("SEAFILE_TRACE_FILE")) {
+            TraceRecorder::instance()->setEnabled(true);
+        }
     }
 }
 
@@ -264,18 +379,33 @@ void SeafileApplet::refreshQss()
 
 void SeafileApplet::warningBox(const QString& msg, QWidget *parent)
 {
+    if (headless_) {
+        qWarning("%s", msg.toUtf8().data());
+        fprintf(stderr, "%s\n", msg.toUtf8().data());
+        return;
+    }
     QMessageBox::warning(parent != 0 ? parent : main_win_,
                          getBrand(), msg, QMessageBox::Ok);
 }
 
 void SeafileApplet::messageBox(const QString& msg, QWidget *parent)
 {
+    if (headless_) {
+        qDebug("%s", msg.toUtf8().data());
+        return;
+    }
     QMessageBox::information(parent != 0 ? parent : main_win_,
                              getBrand(), msg, QMessageBox::Ok);
 }
 
 bool SeafileApplet::yesOrNoBox(const QString& msg, QWidget *parent, bool default_val)
 {
+    // Nobody to ask, don't do anything that needs a confirmation
+    if (headless_) {
+        qDebug("answering no to: %s", msg.toUtf8().data());
+        return false;
+    }
+
     QMessageBox::StandardButton default_btn = default_val ? QMessageBox::Yes : QMessageBox::No;
 
     return QMessageBox::question(parent != 0 ? parent : main_win_,
@@ -287,6 +417,11 @@ bool SeafileApplet::yesOrNoBox(const QString& msg, QWidget *parent, bool default
 
 bool SeafileApplet::detailedYesOrNoBox(const QString& msg, const QString& detailed_text, QWidget *parent, bool default_val)
 {
+    if (headless_) {
+        qDebug("answering no to: %s", msg.toUtf8().data());
+        return false;
+    }
+
     QMessageBox *msgBox = new QMessageBox(QMessageBox::Question,
                        getBrand(),
                        msg,
@@ -2,6 +2,7 @@
 #define SEAFILE_CLIENT_APPLET_H
 
 #include <QObject>
+#include <QElapsedTimer>
 
 class Configurator;
 class DaemonManager;
@@ -13,6 +14,7 @@ class SeafileTrayIcon;
 class SettingsManager;
 class SettingsDialog;
 class CertsManager;
+class DaemonControlServer;
 
 #define SEAFILE_CLIENT_BRAND "Seafile"
 
@@ -26,7 +28,11 @@ class SeafileApplet : QObject {
     Q_OBJECT
 
 public:
-    SeafileApplet();
+    /**
+     * In headless mode no widget (main window, tray icon, dialogs) is
+     * created, the daemon is controlled through the DaemonControlServer.
+     */
+    explicit SeafileApplet(bool headless=false);
 
     void start();
 
@@ -64,6 +70,19 @@ public:
 
     bool started() { return started_; }
     bool inExit() { return in_exit_; }
+    bool headless() const { return headless_; }
+
+    // Milliseconds from the start of the applet to the daemon being ready,
+    // -1 if not started yet. By default the applet is considered started
+    // when it's created, main() sets the timer it started before creating
+    // the QApplication.
+    qint64 startupTime() const { return startup_time_; }
+    void setStartupTimer(const QElapsedTimer& timer) { startup_timer_ = timer; }
+
+    // Milliseconds from the start of the applet to the first list of the
+    // libraries on the server, -1 if not received yet
+    qint64 firstRepoListTime() const { return first_repo_list_time_; }
+    void onFirstRepoList();
 
 private slots:
     void onDaemonStarted();
@@ -74,11 +93,14 @@ private:
     Q_DISABLE_COPY(SeafileApplet)
 
     void initLog();
+    void preconnectServers();
 
     bool loadQss(const QString& path);
 
     void checkLatestVersionInfo();
 
+    void onDaemonStartedHeadless();
+
     Configurator *configurator_;
 
     AccountManager *account_mgr_;
@@ -99,11 +121,20 @@ private:
 
     CertsManager *certs_mgr_;
 
+    DaemonControlServer *control_server_;
+
+    bool headless_;
+
     bool started_;
 
     bool in_exit_;
 
     QString style_;
+
+    QElapsedTimer startup_timer_;
+
+    qint64 startup_time_;
+    qint64 first_repo_list_time_;
 };
 
 /**
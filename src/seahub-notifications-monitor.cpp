@@ -66,15 +66,17 @@ void SeahubNotificationsMonitor::refresh()
 
     const Account& account = seafApplet->accountManager()->currentAccount();
     if (!account.isValid()) {
+        // the last account was removed
+        if (check_messages_req_) {
+            check_messages_req_->cancel();
+        }
         resetStatus();
         return;
     }
 
     in_refresh_ = true;
 
-    if (check_messages_req_) {
-        delete check_messages_req_;
-    }
+    GetUnseenSeahubNotificationsRequest *old_req = check_messages_req_;
 
     check_messages_req_ = new GetUnseenSeahubNotificationsRequest(account);
 
@@ -84,6 +86,11 @@ void SeahubNotificationsMonitor::refresh()
             this, SLOT(onRequestFailed(const ApiError&)));
 
     check_messages_req_->send();
+
+    if (old_req) {
+        old_req->cancel();
+        old_req->deleteLater();
+    }
 }
 
 void SeahubNotificationsMonitor::onRequestFailed(const ApiError& error)
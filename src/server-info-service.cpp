@@ -0,0 +1,252 @@
+#include <sqlite3.h>
+
+#include <QDateTime>
+#include <QTimer>
+#include <QDir>
+#include <QUrl>
+
+#include "seafile-applet.h"
+#include "configurator.h"
+#include "account-mgr.h"
+#include "api/requests.h"
+#include "api/api-error.h"
+#include "utils/utils.h"
+
+#include "server-info-service.h"
+
+namespace {
+
+const qint64 kRefreshServerInfoInterval = 1000 * 60 * 60 * 24; // 1 day
+// How often the age of the records is checked, for the sessions lasting
+// for days
+const int kCheckServerInfoAgeInterval = 1000 * 60 * 60; // 1 hour
+const char *kProFeature = "seafile-pro";
+
+QString escapeSql(const QString& value)
+{
+    QString escaped = value;
+    return escaped.replace("'", "''");
+}
+
+} // namespace
+
+ServerInfoService* ServerInfoService::singleton_;
+
+ServerInfoService* ServerInfoService::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new ServerInfoService;
+    }
+
+    return singleton_;
+}
+
+ServerInfoService::ServerInfoService(QObject *parent)
+    : QObject(parent),
+      db_(NULL)
+{
+    refresh_timer_ = new QTimer(this);
+    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+ServerInfoService::~ServerInfoService()
+{
+    if (db_)
+        sqlite3_close(db_);
+}
+
+void ServerInfoService::start()
+{
+    const char *errmsg;
+    const char *sql;
+
+    QString db_path = QDir(seafApplet->configurator()->seafileDir()).filePath("server-info.db");
+    if (sqlite3_open (toCStr(db_path), &db_)) {
+        errmsg = sqlite3_errmsg (db_);
+        qWarning("failed to open server info database %s: %s",
+                 toCStr(db_path), errmsg ? errmsg : "no error given");
+        // Only a cache, every server is probed again
+        sqlite3_close(db_);
+        db_ = NULL;
+    } else {
+        sql = "CREATE TABLE IF NOT EXISTS ServerInfo ("
+            "url VARCHAR(255) PRIMARY KEY, "
+            "version TEXT, "
+            "features TEXT, "
+            "events INTEGER, "
+            "timestamp INTEGER"
+            ")";
+        sqlite_query_exec (db_, sql);
+
+        loadServerInfo();
+    }
+
+    connect(seafApplet->accountManager(), SIGNAL(accountsChanged()),
+            this, SLOT(refresh()));
+    refresh();
+    refresh_timer_->start(kCheckServerInfoAgeInterval);
+}
+
+QString ServerInfoService::serverKey(const QUrl& server_url)
+{
+    return server_url.toString();
+}
+
+ServerInfo ServerInfoService::serverInfo(const QUrl& server_url) const
+{
+    return infos_.value(serverKey(server_url));
+}
+
+void ServerInfoService::refresh()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
+    for (size_t i = 0; i < accounts.size(); i++) {
+        const ServerInfo& info = infos_.value(serverKey(accounts[i].serverUrl));
+        if (!info.isValid() || now - info.timestamp > kRefreshServerInfoInterval) {
+            refreshServer(accounts[i].serverUrl);
+        }
+    }
+}
+
+void ServerInfoService::refreshServer(const QUrl& server_url)
+{
+    QString key = serverKey(server_url);
+    if (reqs_.contains(key)) {
+        return;
+    }
+
+    GetServerInfoRequest *req = new GetServerInfoRequest(server_url);
+    reqs_[key] = req;
+
+    connect(req, SIGNAL(success(const ServerInfo&)),
+            this, SLOT(onGetServerInfoSuccess(const ServerInfo&)));
+    connect(req, SIGNAL(failed(const ApiError&)),
+            this, SLOT(onGetServerInfoFailed(const ApiError&)));
+
+    req->send();
+}
+
+void ServerInfoService::onGetServerInfoSuccess(const ServerInfo& result)
+{
+    GetServerInfoRequest *req = qobject_cast<GetServerInfoRequest *>(sender());
+    QUrl server_url = req->serverUrl();
+    reqs_.remove(serverKey(server_url));
+    req->deleteLater();
+
+    ServerInfo info = result;
+    if (info.hasFeature(kProFeature)) {
+        info.events = ServerInfo::SUPPORTED;
+    } else if (!info.features.isEmpty()) {
+        info.events = ServerInfo::NOT_SUPPORTED;
+    } else {
+        // Let the api2/events/ requests tell
+        info.events = eventsToReprobe(serverInfo(server_url));
+    }
+
+    updateServerInfo(server_url, info);
+}
+
+void ServerInfoService::onGetServerInfoFailed(const ApiError& error)
+{
+    GetServerInfoRequest *req = qobject_cast<GetServerInfoRequest *>(sender());
+    QUrl server_url = req->serverUrl();
+    reqs_.remove(serverKey(server_url));
+    req->deleteLater();
+
+    if (error.type() != ApiError::HTTP_ERROR || error.httpErrorCode() != 404) {
+        // The record is left as old as it was, so it's tried again on the
+        // next hourly check
+        return;
+    }
+
+    // A server without api2/server-info/, keep what we learned from the
+    // other requests
+    ServerInfo info = serverInfo(server_url);
+    info.version.clear();
+    info.features.clear();
+    info.events = eventsToReprobe(info);
+    updateServerInfo(server_url, info);
+}
+
+// What api2/events/ told us is refreshed along with the rest of the record:
+// a server that answered 404 once may have been upgraded since, so the
+// events are asked again instead of being given up on for good
+ServerInfo::Support ServerInfoService::eventsToReprobe(const ServerInfo& info)
+{
+    if (info.events == ServerInfo::NOT_SUPPORTED) {
+        return ServerInfo::SUPPORT_UNKNOWN;
+    }
+    return info.events;
+}
+
+void ServerInfoService::setEventsSupported(const QUrl& server_url, bool supported)
+{
+    ServerInfo info = serverInfo(server_url);
+    ServerInfo::Support events = supported ? ServerInfo::SUPPORTED : ServerInfo::NOT_SUPPORTED;
+    if (info.events == events) {
+        return;
+    }
+
+    info.events = events;
+    updateServerInfo(server_url, info);
+}
+
+void ServerInfoService::updateServerInfo(const QUrl& server_url, const ServerInfo& info)
+{
+    QString key = serverKey(server_url);
+    ServerInfo old_info = infos_.value(key);
+
+    ServerInfo new_info = info;
+    new_info.timestamp = QDateTime::currentMSecsSinceEpoch();
+    infos_[key] = new_info;
+    saveServerInfo(key, new_info);
+
+    if (old_info.events != new_info.events || old_info.version != new_info.version
+        || old_info.features != new_info.features) {
+        emit serverInfoChanged(server_url);
+    }
+}
+
+bool ServerInfoService::loadServerInfoCB(sqlite3_stmt *stmt, void *data)
+{
+    ServerInfoService *svc = (ServerInfoService *)data;
+    const char *url = (const char *)sqlite3_column_text (stmt, 0);
+    const char *version = (const char *)sqlite3_column_text (stmt, 1);
+    const char *features = (const char *)sqlite3_column_text (stmt, 2);
+    int events = sqlite3_column_int (stmt, 3);
+    qint64 timestamp = (qint64)sqlite3_column_int64 (stmt, 4);
+
+    ServerInfo info;
+    info.version = QString::fromUtf8(version);
+    info.features = QString::fromUtf8(features).split(",", QString::SkipEmptyParts);
+    if (events >= ServerInfo::SUPPORT_UNKNOWN && events <= ServerInfo::NOT_SUPPORTED) {
+        info.events = (ServerInfo::Support)events;
+    }
+    info.timestamp = timestamp;
+
+    svc->infos_[QString::fromUtf8(url)] = info;
+
+    return true;
+}
+
+void ServerInfoService::loadServerInfo()
+{
+    const char *sql = "SELECT url, version, features, events, timestamp FROM ServerInfo";
+    sqlite_foreach_selected_row (db_, sql, loadServerInfoCB, this);
+}
+
+void ServerInfoService::saveServerInfo(const QString& key, const ServerInfo& info)
+{
+    if (!db_) {
+        return;
+    }
+
+    QString sql = "REPLACE INTO ServerInfo VALUES ('%1', '%2', '%3', %4, %5)";
+    sql = sql.arg(escapeSql(key))
+        .arg(escapeSql(info.version))
+        .arg(escapeSql(info.features.join(",")))
+        .arg((int)info.events)
+        .arg(info.timestamp);
+    sqlite_query_exec (db_, toCStr(sql));
+}
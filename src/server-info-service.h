@@ -0,0 +1,79 @@
+#ifndef SEAFILE_CLIENT_SERVER_INFO_SERVICE_H
+#define SEAFILE_CLIENT_SERVER_INFO_SERVICE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+#include "api/server-info.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+class QUrl;
+class QTimer;
+
+class ApiError;
+class GetServerInfoRequest;
+
+/**
+ * Remembers what each server supports, so the ui can be laid out at start
+ * without asking the server first.
+ *
+ * The records are kept in server-info.db and refreshed in the background
+ * when they are older than a day (checked at start and then every hour),
+ * or when an account on a new server is added. A server without
+ * api2/server-info/ gets its api2/events/ probed again at each refresh.
+ */
+class ServerInfoService : public QObject
+{
+    Q_OBJECT
+public:
+    static ServerInfoService* instance();
+
+    void start();
+
+    // An invalid ServerInfo if we know nothing about the server yet
+    ServerInfo serverInfo(const QUrl& server_url) const;
+
+    // Record the answer of the server to an api2/events/ request
+    void setEventsSupported(const QUrl& server_url, bool supported);
+
+public slots:
+    void refresh();
+
+signals:
+    void serverInfoChanged(const QUrl& server_url);
+
+private slots:
+    void onGetServerInfoSuccess(const ServerInfo& info);
+    void onGetServerInfoFailed(const ApiError& error);
+
+private:
+    Q_DISABLE_COPY(ServerInfoService)
+
+    ServerInfoService(QObject *parent=0);
+    ~ServerInfoService();
+
+    static ServerInfoService *singleton_;
+
+    static QString serverKey(const QUrl& server_url);
+    static ServerInfo::Support eventsToReprobe(const ServerInfo& info);
+
+    void refreshServer(const QUrl& server_url);
+    void updateServerInfo(const QUrl& server_url, const ServerInfo& info);
+
+    void loadServerInfo();
+    static bool loadServerInfoCB(sqlite3_stmt *stmt, void *data);
+    void saveServerInfo(const QString& key, const ServerInfo& info);
+
+    QHash<QString, ServerInfo> infos_;
+
+    QHash<QString, GetServerInfoRequest *> reqs_;
+
+    QTimer *refresh_timer_;
+
+    struct sqlite3 *db_;
+};
+
+#endif // SEAFILE_CLIENT_SERVER_INFO_SERVICE_H
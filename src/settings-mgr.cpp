@@ -15,6 +15,7 @@ namespace {
 const char *kHideMainWindowWhenStarted = "hideMainWindowWhenStarted";
 const char *kHideDockIcon = "hideDockIcon";
 const char *kCheckLatestVersion = "checkLatestVersion";
+const char *kMetricsPort = "metricsPort";
 const char *kBehaviorGroup = "Behavior";
 
 //const char *kDefaultLibraryAlreadySetup = "defaultLibraryAlreadySetup";
@@ -75,6 +76,9 @@ void SettingsManager::setAutoSync(bool auto_sync)
         return;
     }
     auto_sync_ = auto_sync;
+    if (!seafApplet->trayIcon()) {
+        return;
+    }
     seafApplet->trayIcon()->setState(
         auto_sync
         ? SeafileTrayIcon::STATE_DAEMON_UP
@@ -237,6 +241,32 @@ bool SettingsManager::isCheckLatestVersionEnabled()
     return enabled;
 }
 
+int SettingsManager::metricsPort()
+{
+    QByteArray env = qgetenv("SEAFILE_METRICS_PORT");
+    if (!env.isEmpty()) {
+        return env.toInt();
+    }
+
+    QSettings settings;
+    int port;
+
+    settings.beginGroup(kBehaviorGroup);
+    port = settings.value(kMetricsPort, 0).toInt();
+    settings.endGroup();
+
+    return port;
+}
+
+void SettingsManager::setMetricsPort(int port)
+{
+    QSettings settings;
+
+    settings.beginGroup(kBehaviorGroup);
+    settings.setValue(kMetricsPort, port);
+    settings.endGroup();
+}
+
 void SettingsManager::setAllowInvalidWorktree(bool val)
 {
     if (allow_invalid_worktree_ != val) {
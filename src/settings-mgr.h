@@ -41,6 +41,12 @@ public:
 
     void setCheckLatestVersionEnabled(bool enabled);
     bool isCheckLatestVersionEnabled();
+
+    // Port of the local metrics endpoint, 0 if disabled. The
+    // SEAFILE_METRICS_PORT environment variable (--metrics-port) overrides
+    // the setting.
+    int metricsPort();
+    void setMetricsPort(int port);
     // bool defaultLibraryAlreadySetup();
     // void setDefaultLibraryAlreadySetup();
 
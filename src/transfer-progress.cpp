@@ -0,0 +1,247 @@
+#include <cstring>
+#include <cstdlib>
+#include <QDateTime>
+
+#include "seafile-applet.h"
+#include "rpc/rpc-client.h"
+#include "utils/utils.h"
+
+#include "transfer-progress.h"
+
+namespace {
+
+// The daemon sends a transfer notification about every second while there
+// is something to transfer.
+const qint64 kStaleIntervalMsec = 3000;
+
+const qint64 kPercentQueryIntervalMsec = 1000;
+
+// The percent of a library which is no longer refreshed, e.g. done syncing
+// or unsynced, is forgotten after this
+const qint64 kPercentExpiryMsec = 30 * 1000;
+
+struct ParseContext {
+    QHash<QString, RepoTransferInfo> *repos;
+    qint64 now;
+};
+
+/**
+ * key: "upload\t<rate>" or "download\t<rate>", value: repo name
+ */
+bool collectTransferInfo(void *data, const char *key, const char *value)
+{
+    ParseContext *ctx = static_cast<ParseContext*>(data);
+
+    const char *p = strchr(key, '\t');
+    if (!p) {
+        return false;
+    }
+
+    bool upload;
+    if (p - key == 6 && strncmp(key, "upload", 6) == 0) {
+        upload = true;
+    } else if (p - key == 8 && strncmp(key, "download", 8) == 0) {
+        upload = false;
+    } else {
+        return false;
+    }
+
+    int rate = atoi(p + 1);
+    QString repo_name = QString::fromUtf8(value);
+
+    RepoTransferInfo& info = (*ctx->repos)[repo_name];
+    info.repo_name = repo_name;
+    if (upload) {
+        info.uploading = true;
+        info.upload_rate = rate;
+    } else {
+        info.downloading = true;
+        info.download_rate = rate;
+    }
+    info.updated_at = ctx->now;
+
+    return true;
+}
+
+} // namespace
+
+TransferProgress* TransferProgress::singleton_;
+
+TransferProgress* TransferProgress::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new TransferProgress;
+    }
+
+    return singleton_;
+}
+
+TransferProgress::TransferProgress(QObject *parent)
+    : QObject(parent),
+      last_update_(0),
+      total_upload_rate_(0),
+      total_download_rate_(0),
+      samples_head_(0),
+      samples_count_(0)
+{
+}
+
+bool TransferProgress::updateFromNotification(const char *body)
+{
+    if (!body) {
+        return false;
+    }
+
+    // parse_key_value_pairs modifies the string in place, and expects every
+    // line to be terminated by a newline
+    QByteArray buf(body);
+    if (!buf.endsWith('\n')) {
+        buf.append('\n');
+    }
+
+    QHash<QString, RepoTransferInfo> repos;
+    ParseContext ctx;
+    ctx.repos = &repos;
+    ctx.now = QDateTime::currentMSecsSinceEpoch();
+
+    if (!parse_key_value_pairs(buf.data(), (KeyValueFunc)collectTransferInfo, &ctx)) {
+        return false;
+    }
+
+    int up = 0, down = 0;
+    QHash<QString, RepoTransferInfo>::const_iterator iter;
+    for (iter = repos.constBegin(); iter != repos.constEnd(); ++iter) {
+        up += iter.value().upload_rate;
+        down += iter.value().download_rate;
+    }
+
+    repos_.swap(repos);
+    last_update_ = ctx.now;
+    prunePercents(ctx.now);
+    total_upload_rate_ = up;
+    total_download_rate_ = down;
+
+    TransferSample sample;
+    sample.timestamp = ctx.now;
+    sample.upload_rate = up;
+    sample.download_rate = down;
+    appendSample(sample);
+
+    emit updated();
+
+    return true;
+}
+
+bool TransferProgress::isStale() const
+{
+    return QDateTime::currentMSecsSinceEpoch() - last_update_ > kStaleIntervalMsec;
+}
+
+RepoTransferInfo TransferProgress::repoTransferInfo(const QString& repo_name) const
+{
+    if (isStale()) {
+        return RepoTransferInfo();
+    }
+
+    return repos_.value(repo_name);
+}
+
+int TransferProgress::totalUploadRate() const
+{
+    return isStale() ? 0 : total_upload_rate_;
+}
+
+int TransferProgress::totalDownloadRate() const
+{
+    return isStale() ? 0 : total_download_rate_;
+}
+
+int TransferProgress::transferPercent(const QString& repo_id) const
+{
+    QHash<QString, PercentCache>::const_iterator iter = percents_.find(repo_id);
+    return iter != percents_.end() ? iter.value().percent : -1;
+}
+
+bool TransferProgress::refreshTransferPercent(const QString& repo_id)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    prunePercents(now);
+
+    QHash<QString, PercentCache>::iterator iter = percents_.find(repo_id);
+    if (iter != percents_.end()
+        && now - iter.value().queried_at < kPercentQueryIntervalMsec) {
+        return false;
+    }
+
+    PercentCache cache;
+    cache.queried_at = now;
+    int rate;
+    if (seafApplet->rpcClient()->getRepoTransferInfo(repo_id, &rate, &cache.percent) < 0) {
+        cache.percent = -1;
+    }
+
+    bool changed = iter == percents_.end() || iter.value().percent != cache.percent;
+    percents_.insert(repo_id, cache);
+    return changed;
+}
+
+void TransferProgress::prunePercents(qint64 now)
+{
+    QHash<QString, PercentCache>::iterator iter = percents_.begin();
+    while (iter != percents_.end()) {
+        if (now - iter.value().queried_at > kPercentExpiryMsec) {
+            iter = percents_.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+QString TransferProgress::toolTip() const
+{
+    QString msg;
+
+    QHash<QString, RepoTransferInfo>::const_iterator iter;
+    for (iter = repos_.constBegin(); iter != repos_.constEnd(); ++iter) {
+        const RepoTransferInfo& info = iter.value();
+        if (info.uploading) {
+            msg.append(QString("%1 %2, %3 %4 KB/s\n")
+                       .arg(tr("Uploading"))
+                       .arg(info.repo_name)
+                       .arg(tr("Speed"))
+                       .arg(info.upload_rate / 1024));
+        }
+        if (info.downloading) {
+            msg.append(QString("%1 %2, %3 %4 KB/s\n")
+                       .arg(tr("Downloading"))
+                       .arg(info.repo_name)
+                       .arg(tr("Speed"))
+                       .arg(info.download_rate / 1024));
+        }
+    }
+
+    return msg;
+}
+
+void TransferProgress::appendSample(const TransferSample& sample)
+{
+    int pos = (samples_head_ + samples_count_) % kMaxSamples;
+    samples_[pos] = sample;
+
+    if (samples_count_ < kMaxSamples) {
+        samples_count_++;
+    } else {
+        samples_head_ = (samples_head_ + 1) % kMaxSamples;
+    }
+}
+
+int TransferProgress::sampleCount() const
+{
+    return samples_count_;
+}
+
+TransferSample TransferProgress::sampleAt(int i) const
+{
+    return samples_[(samples_head_ + i) % kMaxSamples];
+}
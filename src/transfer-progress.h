@@ -0,0 +1,132 @@
+#ifndef SEAFILE_CLIENT_TRANSFER_PROGRESS_H
+#define SEAFILE_CLIENT_TRANSFER_PROGRESS_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+/**
+ * Transfer state of a library, as reported by the daemon
+ */
+struct RepoTransferInfo {
+    QString repo_name;
+    bool uploading;
+    bool downloading;
+    // bytes per second
+    int upload_rate;
+    int download_rate;
+    // msecs since epoch
+    qint64 updated_at;
+
+    RepoTransferInfo()
+        : uploading(false),
+          downloading(false),
+          upload_rate(0),
+          download_rate(0),
+          updated_at(0) {}
+
+    bool isValid() const { return updated_at != 0; }
+};
+
+/**
+ * Total transfer rates at a given time
+ */
+struct TransferSample {
+    qint64 timestamp;
+    int upload_rate;
+    int download_rate;
+};
+
+/**
+ * Keeps the per-library transfer rates reported by the daemon in "transfer"
+ * notifications, so the UI can read them without asking the daemon over
+ * rpc every second.
+ *
+ * Each notification carries the rates of all libraries being transferred,
+ * so it replaces the whole table. The daemon stops sending notifications
+ * when there is nothing to transfer, so the table is considered stale (and
+ * the rates zero) if no notification arrived in the last few seconds.
+ *
+ * The notification only carries the library names, not their ids, so the
+ * table is keyed by library name.
+ *
+ * All methods must be called in the main thread.
+ */
+class TransferProgress : public QObject {
+    Q_OBJECT
+public:
+    static TransferProgress* instance();
+
+    /**
+     * Parse the body of a "transfer" notification. Each line has the format
+     * "upload|download\t<rate> <repo_name>". Returns false if the body is
+     * malformed, in which case the table is not changed.
+     */
+    bool updateFromNotification(const char *body);
+
+    bool isStale() const;
+
+    RepoTransferInfo repoTransferInfo(const QString& repo_name) const;
+
+    // Sum of the rates of all libraries, zero if the table is stale
+    int totalUploadRate() const;
+    int totalDownloadRate() const;
+
+    /**
+     * Percent of the blocks transferred for a library, as of the last
+     * refreshTransferPercent(). Never asks the daemon, so it can be called
+     * when painting. Returns -1 if not available.
+     */
+    int transferPercent(const QString& repo_id) const;
+
+    /**
+     * The notification doesn't carry the percent, so it is queried from the
+     * daemon, but at most once per second for each library. Returns true if
+     * it has changed.
+     */
+    bool refreshTransferPercent(const QString& repo_id);
+
+    /**
+     * Human readable summary, used as the tray icon tooltip
+     */
+    QString toolTip() const;
+
+    /**
+     * Recent total rates, one sample per notification, oldest first. At most
+     * kMaxSamples samples are kept.
+     */
+    enum { kMaxSamples = 128 };
+    int sampleCount() const;
+    TransferSample sampleAt(int i) const;
+
+signals:
+    void updated();
+
+private:
+    Q_DISABLE_COPY(TransferProgress)
+
+    TransferProgress(QObject *parent=0);
+
+    static TransferProgress *singleton_;
+
+    void appendSample(const TransferSample& sample);
+    void prunePercents(qint64 now);
+
+    QHash<QString, RepoTransferInfo> repos_;
+    qint64 last_update_;
+    int total_upload_rate_;
+    int total_download_rate_;
+
+    // Fixed size ring buffer, never reallocated
+    TransferSample samples_[kMaxSamples];
+    int samples_head_;
+    int samples_count_;
+
+    struct PercentCache {
+        int percent;
+        qint64 queried_at;
+    };
+    QHash<QString, PercentCache> percents_;
+};
+
+#endif // SEAFILE_CLIENT_TRANSFER_PROGRESS_H
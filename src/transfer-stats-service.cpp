@@ -0,0 +1,367 @@
+#include <QTimer>
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include <QDateTime>
+
+#include "seafile-applet.h"
+#include "configurator.h"
+#include "transfer-progress.h"
+
+#include "transfer-stats-service.h"
+
+namespace {
+
+const int kSampleInterval = 1000; // 1s
+const int kSaveInterval = 5 * 60 * 1000; // 5min
+
+const char *kStatsFileName = "transfer-stats.dat";
+const quint32 kStatsFileMagic = 0x53545354; // "STST"
+const quint32 kStatsFileVersion = 1;
+
+// 10 minutes of seconds, 24 hours of minutes, 30 days of hours
+const int kRingCapacity[] = { 600, 24 * 60, 30 * 24 };
+
+// Number of samples of a level that make one sample of the next level
+const int kSamplesPerNextLevel = 60;
+
+// We don't keep anything older than this
+const qint64 kMaxGapSecs = 31 * 24 * 3600;
+
+// A timer firing late by up to this much is a busy event loop, not a pause,
+// and the transfers went on meanwhile
+const qint64 kMaxJitterSecs = 2;
+
+} // namespace
+
+
+TransferRateRing::TransferRateRing(int capacity)
+    : samples_(capacity),
+      head_(0),
+      count_(0)
+{
+}
+
+void TransferRateRing::append(const TransferRateSample& sample)
+{
+    int n = samples_.size();
+    samples_[(head_ + count_) % n] = sample;
+    if (count_ < n) {
+        count_++;
+    } else {
+        head_ = (head_ + 1) % n;
+    }
+}
+
+void TransferRateRing::clear()
+{
+    head_ = 0;
+    count_ = 0;
+}
+
+const TransferRateSample& TransferRateRing::at(int i) const
+{
+    return samples_[(head_ + i) % samples_.size()];
+}
+
+void TransferRateRing::save(QDataStream& stream) const
+{
+    stream << qint32(count_);
+    for (int i = 0; i < count_; i++) {
+        const TransferRateSample& sample = at(i);
+        stream << sample.upload_rate << sample.download_rate;
+    }
+}
+
+bool TransferRateRing::load(QDataStream& stream)
+{
+    clear();
+
+    qint32 count;
+    stream >> count;
+    if (stream.status() != QDataStream::Ok || count < 0) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        TransferRateSample sample;
+        stream >> sample.upload_rate >> sample.download_rate;
+        if (stream.status() != QDataStream::Ok) {
+            clear();
+            return false;
+        }
+        // If the capacity has shrunk the oldest samples are dropped
+        append(sample);
+    }
+
+    return true;
+}
+
+
+TransferStatsService* TransferStatsService::singleton_;
+
+TransferStatsService* TransferStatsService::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new TransferStatsService;
+    }
+
+    return singleton_;
+}
+
+TransferStatsService::TransferStatsService(QObject *parent)
+    : QObject(parent),
+      last_sample_time_(0)
+{
+    for (int i = 0; i < N_RESOLUTIONS; i++) {
+        rings_[i] = new TransferRateRing(kRingCapacity[i]);
+    }
+
+    sample_timer_ = new QTimer(this);
+    connect(sample_timer_, SIGNAL(timeout()), this, SLOT(takeSample()));
+
+    save_timer_ = new QTimer(this);
+    connect(save_timer_, SIGNAL(timeout()), this, SLOT(save()));
+}
+
+void TransferStatsService::start()
+{
+    load();
+
+    sample_timer_->start(kSampleInterval);
+    save_timer_->start(kSaveInterval);
+}
+
+void TransferStatsService::stop()
+{
+    sample_timer_->stop();
+    save_timer_->stop();
+
+    save();
+}
+
+int TransferStatsService::intervalOf(Resolution resolution)
+{
+    switch (resolution) {
+    case RESOLUTION_SECOND:
+        return 1;
+    case RESOLUTION_MINUTE:
+        return 60;
+    case RESOLUTION_HOUR:
+        return 3600;
+    default:
+        return 0;
+    }
+}
+
+std::vector<TransferRateSample>
+TransferStatsService::samples(Resolution resolution) const
+{
+    std::vector<TransferRateSample> ret;
+    const TransferRateRing *ring = rings_[resolution];
+
+    ret.reserve(ring->size());
+    for (int i = 0; i < ring->size(); i++) {
+        ret.push_back(ring->at(i));
+    }
+
+    return ret;
+}
+
+void TransferStatsService::append(int level, const TransferRateSample& sample)
+{
+    rings_[level]->append(sample);
+
+    if (level + 1 >= N_RESOLUTIONS) {
+        return;
+    }
+
+    Accumulator& acc = accumulators_[level];
+    acc.upload_sum += sample.upload_rate;
+    acc.download_sum += sample.download_rate;
+    acc.count++;
+
+    if (acc.count == kSamplesPerNextLevel) {
+        TransferRateSample avg;
+        avg.upload_rate = acc.upload_sum / acc.count;
+        avg.download_rate = acc.download_sum / acc.count;
+        acc = Accumulator();
+
+        append(level + 1, avg);
+    }
+}
+
+/**
+ * Fill the time we were not running (or the computer was asleep) with zero
+ * samples. Large gaps are filled directly at the coarser levels, so this is
+ * cheap even if the last sample is weeks old.
+ */
+void TransferStatsService::fillGap(qint64 now)
+{
+    qint64 gap = qMin(now - last_sample_time_ - 1, kMaxGapSecs);
+    if (gap <= 0) {
+        return;
+    }
+
+    const TransferRateSample zero;
+    qint64 secs = gap;
+    qint64 appended[N_RESOLUTIONS] = { 0, 0, 0 };
+
+    // Complete the current minute, then the current hour
+    while (secs > 0 && accumulators_[RESOLUTION_SECOND].count != 0) {
+        append(RESOLUTION_SECOND, zero);
+        appended[RESOLUTION_SECOND]++;
+        secs--;
+    }
+
+    qint64 mins = secs / 60;
+    secs %= 60;
+    while (mins > 0 && accumulators_[RESOLUTION_MINUTE].count != 0) {
+        append(RESOLUTION_MINUTE, zero);
+        appended[RESOLUTION_MINUTE]++;
+        mins--;
+    }
+
+    qint64 hours = qMin(mins / 60, qint64(kRingCapacity[RESOLUTION_HOUR]));
+    mins %= 60;
+    for (qint64 i = 0; i < hours; i++) {
+        append(RESOLUTION_HOUR, zero);
+    }
+    for (qint64 i = 0; i < mins; i++) {
+        append(RESOLUTION_MINUTE, zero);
+        appended[RESOLUTION_MINUTE]++;
+    }
+    for (qint64 i = 0; i < secs; i++) {
+        append(RESOLUTION_SECOND, zero);
+        appended[RESOLUTION_SECOND]++;
+    }
+
+    // The finer rings cover the whole gap as well. These samples are not
+    // propagated, the coarser levels already have them.
+    qint64 missing = qMin(gap, qint64(kRingCapacity[RESOLUTION_SECOND]))
+        - appended[RESOLUTION_SECOND];
+    for (qint64 i = 0; i < missing; i++) {
+        rings_[RESOLUTION_SECOND]->append(zero);
+    }
+
+    missing = qMin(gap / 60, qint64(kRingCapacity[RESOLUTION_MINUTE]))
+        - appended[RESOLUTION_MINUTE];
+    for (qint64 i = 0; i < missing; i++) {
+        rings_[RESOLUTION_MINUTE]->append(zero);
+    }
+}
+
+void TransferStatsService::takeSample()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
+
+    if (last_sample_time_ != 0 && now <= last_sample_time_) {
+        // Timer fired twice in a second, or the clock went back
+        if (now < last_sample_time_) {
+            last_sample_time_ = now;
+        }
+        return;
+    }
+
+    TransferProgress *progress = TransferProgress::instance();
+    TransferRateSample sample;
+    sample.upload_rate = progress->totalUploadRate();
+    sample.download_rate = progress->totalDownloadRate();
+
+    if (last_sample_time_ != 0) {
+        qint64 missed = now - last_sample_time_ - 1;
+        if (missed <= kMaxJitterSecs) {
+            // Zeros would show a running transfer as stalling
+            for (qint64 i = 0; i < missed; i++) {
+                append(RESOLUTION_SECOND, sample);
+            }
+        } else {
+            fillGap(now);
+        }
+    }
+
+    append(RESOLUTION_SECOND, sample);
+    last_sample_time_ = now;
+
+    emit updated();
+}
+
+QString TransferStatsService::statsFilePath() const
+{
+    return QDir(seafApplet->configurator()->seafileDir()).filePath(kStatsFileName);
+}
+
+void TransferStatsService::save()
+{
+    if (last_sample_time_ == 0) {
+        return;
+    }
+
+    const QString path = statsFilePath();
+    const QString tmp_path = path + ".tmp";
+
+    QFile file(tmp_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("failed to save transfer stats to %s", path.toUtf8().data());
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    stream << kStatsFileMagic << kStatsFileVersion << last_sample_time_;
+    for (int i = 0; i < N_RESOLUTIONS; i++) {
+        const Accumulator& acc = accumulators_[i];
+        stream << acc.upload_sum << acc.download_sum << qint32(acc.count);
+        rings_[i]->save(stream);
+    }
+
+    file.close();
+    if (stream.status() != QDataStream::Ok) {
+        QFile::remove(tmp_path);
+        return;
+    }
+
+    QFile::remove(path);
+    QFile::rename(tmp_path, path);
+}
+
+void TransferStatsService::load()
+{
+    QFile file(statsFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic, version;
+    qint64 last_sample_time;
+    stream >> magic >> version >> last_sample_time;
+    if (stream.status() != QDataStream::Ok
+        || magic != kStatsFileMagic || version != kStatsFileVersion) {
+        qWarning("ignore invalid transfer stats file");
+        return;
+    }
+
+    for (int i = 0; i < N_RESOLUTIONS; i++) {
+        Accumulator acc;
+        qint32 count;
+        stream >> acc.upload_sum >> acc.download_sum >> count;
+        acc.count = count;
+        if (stream.status() != QDataStream::Ok
+            || acc.count < 0 || acc.count >= kSamplesPerNextLevel
+            || !rings_[i]->load(stream)) {
+            qWarning("ignore invalid transfer stats file");
+            for (int j = 0; j < N_RESOLUTIONS; j++) {
+                rings_[j]->clear();
+                accumulators_[j] = Accumulator();
+            }
+            return;
+        }
+        accumulators_[i] = acc;
+    }
+
+    last_sample_time_ = last_sample_time;
+}
@@ -0,0 +1,122 @@
+#ifndef SEAFILE_CLIENT_TRANSFER_STATS_SERVICE_H
+#define SEAFILE_CLIENT_TRANSFER_STATS_SERVICE_H
+
+#include <vector>
+#include <QObject>
+
+class QTimer;
+class QDataStream;
+
+/**
+ * Average transfer rates (bytes per second) over one sampling interval
+ */
+struct TransferRateSample {
+    quint32 upload_rate;
+    quint32 download_rate;
+
+    TransferRateSample() : upload_rate(0), download_rate(0) {}
+};
+
+/**
+ * A fixed size ring buffer of TransferRateSample
+ */
+class TransferRateRing {
+public:
+    TransferRateRing(int capacity);
+
+    void append(const TransferRateSample& sample);
+    void clear();
+
+    int capacity() const { return samples_.size(); }
+    int size() const { return count_; }
+
+    // 0 is the oldest sample
+    const TransferRateSample& at(int i) const;
+
+    void save(QDataStream& stream) const;
+    bool load(QDataStream& stream);
+
+private:
+    std::vector<TransferRateSample> samples_;
+    int head_;
+    int count_;
+};
+
+/**
+ * Keeps the history of the total transfer rates, at three resolutions:
+ *
+ * - one sample per second for the last 10 minutes
+ * - one sample per minute for the last 24 hours
+ * - one sample per hour for the last 30 days
+ *
+ * The rates are sampled once per second from TransferProgress, so no rpc
+ * is made for them. The minute and hour samples are averages of the finer
+ * ones. The history is saved to "transfer-stats.dat" in the seafile data
+ * dir every few minutes and when the applet quits.
+ */
+class TransferStatsService : public QObject {
+    Q_OBJECT
+public:
+    enum Resolution {
+        RESOLUTION_SECOND = 0,
+        RESOLUTION_MINUTE,
+        RESOLUTION_HOUR,
+        N_RESOLUTIONS
+    };
+
+    static TransferStatsService* instance();
+
+    void start();
+    void stop();
+
+    /**
+     * Samples of the given resolution, oldest first. The last one is the
+     * most recent.
+     */
+    std::vector<TransferRateSample> samples(Resolution resolution) const;
+
+    // Interval between two samples of the given resolution, in seconds
+    static int intervalOf(Resolution resolution);
+
+signals:
+    void updated();
+
+public slots:
+    void save();
+
+private slots:
+    void takeSample();
+
+private:
+    Q_DISABLE_COPY(TransferStatsService)
+
+    TransferStatsService(QObject *parent=0);
+
+    static TransferStatsService *singleton_;
+
+    QString statsFilePath() const;
+    void load();
+    void append(int level, const TransferRateSample& sample);
+    void fillGap(qint64 now);
+
+    // Accumulates the samples of a level until there are enough of them to
+    // make a sample of the next level.
+    struct Accumulator {
+        quint64 upload_sum;
+        quint64 download_sum;
+        int count;
+
+        Accumulator() : upload_sum(0), download_sum(0), count(0) {}
+    };
+
+    TransferRateRing *rings_[N_RESOLUTIONS];
+    Accumulator accumulators_[N_RESOLUTIONS];
+
+    // secs since epoch of the last sample taken
+    qint64 last_sample_time_;
+
+    QTimer *sample_timer_;
+    QTimer *save_timer_;
+};
+
+#endif // SEAFILE_CLIENT_TRANSFER_STATS_SERVICE_H
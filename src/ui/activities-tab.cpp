@@ -7,9 +7,11 @@
 
 #include "seafile-applet.h"
 #include "account-mgr.h"
+#include "repo-service.h"
 #include "events-list-view.h"
 #include "loading-view.h"
 #include "events-service.h"
+#include "server-info-service.h"
 #include "avatar-service.h"
 #include "api/api-error.h"
 
@@ -18,6 +20,7 @@
 namespace {
 
 //const int kRefreshInterval = 1000 * 60 * 5; // 5 min
+const int kMaxCachedAccounts = 4;
 const char *kLoadingFailedLabelName = "loadingFailedText";
 //const char *kEmptyViewLabelName = "emptyText";
 //const char *kAuthHeader = "Authorization";
@@ -29,6 +32,11 @@ enum {
     INDEX_EVENTS_VIEW,
 };
 
+QString currentAccountKey()
+{
+    const Account& account = seafApplet->accountManager()->currentAccount();
+    return account.isValid() ? RepoService::accountKey(account) : QString();
+}
 
 }
 
@@ -44,6 +52,8 @@ ActivitiesTab::ActivitiesTab(QWidget *parent)
     mStack->insertWidget(INDEX_LOADING_FAILED_VIEW, loading_failed_view_);
     mStack->insertWidget(INDEX_EVENTS_VIEW, events_container_view_);
 
+    cache_.setMaxCost(kMaxCachedAccounts);
+
     connect(EventsService::instance(), SIGNAL(refreshSuccess(const std::vector<SeafEvent>&, bool, bool)),
             this, SLOT(refreshEvents(const std::vector<SeafEvent>&, bool, bool)));
     connect(EventsService::instance(), SIGNAL(refreshFailed(const ApiError&)),
@@ -65,6 +75,17 @@ void ActivitiesTab::loadMoreEvents()
 void ActivitiesTab::refreshEvents(const std::vector<SeafEvent>& events,
                                   bool is_loading_more,
                                   bool has_more)
+{
+    QString key = currentAccountKey();
+    if (!is_loading_more && !key.isEmpty()) {
+        cache_.insert(key, new std::vector<SeafEvent>(events));
+    }
+
+    showEvents(events, is_loading_more);
+}
+
+void ActivitiesTab::showEvents(const std::vector<SeafEvent>& events,
+                               bool is_loading_more)
 {
     emit activitiesSupported();
     mStack->setCurrentIndex(INDEX_EVENTS_VIEW);
@@ -81,7 +102,20 @@ void ActivitiesTab::refreshEvents(const std::vector<SeafEvent>& events,
 
 void ActivitiesTab::refresh()
 {
-    showLoadingView();
+    const Account& account = seafApplet->accountManager()->currentAccount();
+    ServerInfo info = ServerInfoService::instance()->serverInfo(account.serverUrl);
+    if (info.events == ServerInfo::NOT_SUPPORTED) {
+        showNotSupported();
+        return;
+    }
+
+    // Show the events we already have while fetching them again
+    const std::vector<SeafEvent> *events = cache_.object(currentAccountKey());
+    if (events) {
+        showEvents(*events, false);
+    } else {
+        showLoadingView();
+    }
 
     EventsService::instance()->refresh(true);
 }
@@ -143,17 +177,29 @@ void ActivitiesTab::showLoadingView()
 
 void ActivitiesTab::refreshFailed(const ApiError& error)
 {
-    QString text;
     if (error.type() == ApiError::HTTP_ERROR
         && error.httpErrorCode() == 404) {
-        text = tr("File Activities are only supported in Seafile Server Professional Edition.");
-    } else {
-        QString link = QString("<a style=\"color:#777\" href=\"#\">%1</a>").arg(tr("retry"));
-        text = tr("Failed to get actvities information. "
-                  "Please %1").arg(link);
+        cache_.remove(currentAccountKey());
+        showNotSupported();
+        return;
+    }
+
+    if (mStack->currentIndex() == INDEX_EVENTS_VIEW) {
+        // keep showing the events we have
+        return;
     }
 
-    loading_failed_text_->setText(text);
+    QString link = QString("<a style=\"color:#777\" href=\"#\">%1</a>").arg(tr("retry"));
+    loading_failed_text_->setText(tr("Failed to get actvities information. "
+                                     "Please %1").arg(link));
+
+    mStack->setCurrentIndex(INDEX_LOADING_FAILED_VIEW);
+}
+
+void ActivitiesTab::showNotSupported()
+{
+    loading_failed_text_->setText(
+        tr("File Activities are only supported in Seafile Server Professional Edition."));
 
     mStack->setCurrentIndex(INDEX_LOADING_FAILED_VIEW);
 }
@@ -3,7 +3,10 @@
 
 #include <vector>
 #include <QList>
+#include <QCache>
+#include <QString>
 
+#include "api/event.h"
 #include "tab-view.h"
 
 class QSslError;
@@ -13,7 +16,6 @@ class QNetworkReply;
 class QToolButton;
 class QLabel;
 
-class SeafEvent;
 class Account;
 class ApiError;
 class EventsListView;
@@ -49,6 +51,8 @@ private:
     void createLoadingView();
     void createLoadingFailedView();
     void showLoadingView();
+    void showEvents(const std::vector<SeafEvent>& events, bool is_loading_more);
+    void showNotSupported();
     void loadPage(const Account& account);
 
     QWidget *loading_view_;
@@ -61,6 +65,10 @@ private:
     QToolButton *load_more_btn_;
 
     QLabel *loading_failed_text_;
+
+    // The first page of events of the recently used accounts, keyed by
+    // RepoService::accountKey()
+    QCache<QString, std::vector<SeafEvent> > cache_;
 };
 
 #endif // SEAFILE_CLIENT_UI_ACTIVITIES_TAB_H
@@ -3,6 +3,7 @@
 
 #include "QtAwesome.h"
 #include "utils/utils.h"
+#include "utils/perf-stats.h"
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
 #include "rpc/clone-task.h"
@@ -33,6 +34,7 @@ CloneTasksTableModel::CloneTasksTableModel(QObject *parent)
 
 void CloneTasksTableModel::updateTasks()
 {
+    PerfScope perf(PerfStats::MODEL, "CloneTasksTableModel::updateTasks");
     std::vector<CloneTask> tasks;
     int ret = seafApplet->rpcClient()->getCloneTasks(&tasks);
     if (ret < 0) {
@@ -11,6 +11,7 @@ extern "C" {
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
 #include "account-mgr.h"
+#include "server-info-service.h"
 #include "create-repo-dialog.h"
 #include "clone-tasks-dialog.h"
 #include "server-status-dialog.h"
@@ -21,12 +22,17 @@ extern "C" {
 #include "account-view.h"
 #include "seafile-tab-widget.h"
 #include "utils/paint-utils.h"
+#include "utils/trace-recorder.h"
+#include "transfer-progress.h"
+#include "transfer-stats-service.h"
+#include "transfer-chart.h"
 
 #include "cloud-view.h"
 
 namespace {
 
 const int kRefreshStatusInterval = 1000;
+const int kSparklineSamples = 60;
 
 const int kIndexOfAccountView = 1;
 const int kIndexOfToolBar = 2;
@@ -137,6 +143,47 @@ void CloudView::createTabs()
 
     connect(activities_tab_, SIGNAL(activitiesSupported()),
             this, SLOT(addActivitiesTab()));
+
+    // Lay out the tabs with what we know about the server, instead of
+    // waiting for it to answer
+    updateActivitiesTab();
+    connect(ServerInfoService::instance(), SIGNAL(serverInfoChanged(const QUrl&)),
+            this, SLOT(onServerInfoChanged(const QUrl&)));
+}
+
+// Show the activities tab if the server of the current account is known to
+// have them. Returns true if the tab was added.
+bool CloudView::updateActivitiesTab()
+{
+    const Account& account = seafApplet->accountManager()->currentAccount();
+    ServerInfo info = ServerInfoService::instance()->serverInfo(account.serverUrl);
+
+    if (info.events == ServerInfo::SUPPORTED) {
+        if (tabs_->count() < 3) {
+            addActivitiesTab();
+            return true;
+        }
+    } else if (info.events == ServerInfo::NOT_SUPPORTED || !account.isValid()) {
+        tabs_->removeTab(2, activities_tab_);
+        tabs_->adjustTabsWidth(rect().width());
+    }
+    return false;
+}
+
+void CloudView::onServerInfoChanged(const QUrl& server_url)
+{
+    const Account& account = seafApplet->accountManager()->currentAccount();
+    if (account.serverUrl != server_url) {
+        return;
+    }
+
+    // The events of the server are to be probed again, the tab isn't there
+    // to do it on its own
+    bool reprobe = ServerInfoService::instance()->serverInfo(server_url).events
+        == ServerInfo::SUPPORT_UNKNOWN;
+    if (updateActivitiesTab() || reprobe) {
+        activities_tab_->refresh();
+    }
 }
 
 void CloudView::addActivitiesTab()
@@ -178,6 +225,12 @@ void CloudView::setupFooter()
     mUploadRateArrow->setPixmap(QPixmap(":/images/arrow-up.png"));
     mUploadRate->setText("0 kB/s");
     mUploadRate->setToolTip(tr("current upload rate"));
+
+    // Insert the sparkline between the spacer and the download rate
+    transfer_sparkline_ = new TransferChart;
+    transfer_sparkline_->setMaxSamples(kSparklineSamples);
+    transfer_sparkline_->setToolTip(tr("transfer rates in the last minute"));
+    horizontalLayout_2->insertWidget(2, transfer_sparkline_);
 }
 
 void CloudView::chooseFolderToSync()
@@ -200,11 +253,13 @@ void CloudView::chooseFolderToSync()
 
 void CloudView::showCreateRepoDialog(const QString& path)
 {
-    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
-    if (accounts.empty()) {
+    // The libraries of all the accounts are listed, but a new one is
+    // created in the current account
+    const Account account = seafApplet->accountManager()->currentAccount();
+    if (!account.isValid()) {
         return;
     }
-    CreateRepoDialog dialog(accounts[0], path, this);
+    CreateRepoDialog dialog(account, path, this);
     if (dialog.exec() == QDialog::Accepted) {
         repos_tab_->refresh();
     }
@@ -349,21 +404,20 @@ void CloudView::refreshServerStatus()
 
 void CloudView::refreshTransferRate()
 {
-    int up_rate, down_rate;
-    if (seafApplet->rpcClient()->getUploadRate(&up_rate) < 0) {
-        return;
-    }
-
-    if (seafApplet->rpcClient()->getDownloadRate(&down_rate) < 0) {
-        return;
-    }
+    TransferProgress *progress = TransferProgress::instance();
+    int up_rate = progress->totalUploadRate();
+    int down_rate = progress->totalDownloadRate();
 
     mUploadRate->setText(tr("%1 kB/s").arg(up_rate / 1024));
     mDownloadRate->setText(tr("%1 kB/s").arg(down_rate / 1024));
+
+    transfer_sparkline_->setSamples(
+        TransferStatsService::instance()->samples(TransferStatsService::RESOLUTION_SECOND));
 }
 
 void CloudView::refreshStatusBar()
 {
+    SEAFILE_TRACE_SPAN("timer", "CloudView::refreshStatusBar");
     if (!seafApplet->mainWindow()->isVisible()) {
         return;
     }
@@ -442,8 +496,14 @@ void CloudView::onAccountChanged()
 {
     refresh_action_->setEnabled(hasAccount());
 
-    tabs_->removeTab(2, activities_tab_);
-    tabs_->adjustTabsWidth(rect().width());
+    // Unknown servers show the tab once the events are fetched
+    const Account& account = seafApplet->accountManager()->currentAccount();
+    if (ServerInfoService::instance()->serverInfo(account.serverUrl).events
+        != ServerInfo::SUPPORTED) {
+        tabs_->removeTab(2, activities_tab_);
+        tabs_->adjustTabsWidth(rect().width());
+    }
+    updateActivitiesTab();
 
     repos_tab_->refresh();
     starred_files_tab_->refresh();
@@ -11,6 +11,7 @@ class QToolButton;
 class QToolBar;
 class QSizeGrip;
 class QTabWidget;
+class QUrl;
 
 class SeafileTabWidget;
 class ReposTab;
@@ -18,6 +19,7 @@ class StarredFilesTab;
 class ActivitiesTab;
 class CloneTasksDialog;
 class AccountView;
+class TransferChart;
 
 class CloudView : public QWidget,
                   public Ui::CloudView
@@ -47,11 +49,13 @@ private slots:
     void onAccountChanged();
     void onTabChanged(int index);
     void addActivitiesTab();
+    void onServerInfoChanged(const QUrl& server_url);
 
 private:
     Q_DISABLE_COPY(CloudView)
 
     bool hasAccount();
+    bool updateActivitiesTab();
 
     void setupHeader();
     void createAccountView();
@@ -80,6 +84,8 @@ private:
 
     QSizeGrip *resizer_;
 
+    TransferChart *transfer_sparkline_;
+
     CloneTasksDialog* clone_task_dialog_;
 };
 
@@ -34,8 +34,10 @@ CreateRepoDialog::CreateRepoDialog(const Account& account,
 
 CreateRepoDialog::~CreateRepoDialog()
 {
-    if (request_)
-        delete request_;
+    if (request_) {
+        request_->cancel();
+        request_->deleteLater();
+    }
 }
 
 void CreateRepoDialog::chooseDirAction()
@@ -77,7 +79,9 @@ void CreateRepoDialog::createAction()
     setAllInputsEnabled(false);
 
     if (request_) {
-        delete request_;
+        // It may be the request reporting to us right now
+        request_->cancel();
+        request_->deleteLater();
     }
     request_ = new CreateRepoRequest(account_, name_, desc_, passwd_);
 
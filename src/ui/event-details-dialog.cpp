@@ -54,7 +54,9 @@ void EventDetailsDialog::sendRequest()
     const Account& account = seafApplet->accountManager()->currentAccount();
 
     if (request_) {
-        delete request_;
+        // It may be the request reporting to us right now
+        request_->cancel();
+        request_->deleteLater();
     }
 
     request_ = new GetCommitDetailsRequest(account, event_.repo_id, event_.commit_id);
@@ -77,17 +79,18 @@ void EventDetailsDialog::updateContent(const CommitDetails& details)
 
 void EventDetailsDialog::getCommitDetailsFailed(const ApiError& error)
 {
-    ServerRepo repo = RepoService::instance()->getRepo(event_.repo_id);
+    RepoSnapshot snapshot = RepoService::instance()->snapshot();
+    const ServerRepo *repo = snapshot.findRepo(event_.repo_id);
 
-    if (!repo.isValid()) {
+    if (!repo) {
         return;
     }
 
-    if (repo.encrypted &&
+    if (repo->encrypted &&
         error.type() == ApiError::HTTP_ERROR &&
         error.httpErrorCode() == 400) {
 
-        SetRepoPasswordDialog dialog(repo, this);
+        SetRepoPasswordDialog dialog(*repo, this);
 
         if (dialog.exec() == QDialog::Accepted) {
             sendRequest();
@@ -5,7 +5,7 @@
 #include "account-mgr.h"
 #include "seafile-applet.h"
 #include "api/api-error.h"
-#include "api/requests.h"
+#include "api/racing-login-request.h"
 #include "login-dialog.h"
 #include "utils/utils.h"
 
@@ -52,14 +52,16 @@ void LoginDialog::doLogin()
     disableInputs();
 
     if (request_) {
-        delete request_;
+        request_->cancel();
+        request_->deleteLater();
     }
 
-    request_ = new LoginRequest(url_, username_, password_, computer_name_);
-    request_->setIgnoreSslErrors(false);
+    // The address may lack the scheme or have a wrong path, the possible
+    // server urls are tried at the same time
+    request_ = new RacingLoginRequest(server_addr_, username_, password_, computer_name_);
 
-    connect(request_, SIGNAL(success(const QString&)),
-            this, SLOT(loginSuccess(const QString&)));
+    connect(request_, SIGNAL(success(const QUrl&, const QString&)),
+            this, SLOT(loginSuccess(const QUrl&, const QString&)));
 
     connect(request_, SIGNAL(failed(const ApiError&)),
             this, SLOT(loginFailed(const ApiError&)));
@@ -106,24 +108,14 @@ void LoginDialog::onSslErrors(QNetworkReply* reply, const QList<QSslError>& erro
 
 bool LoginDialog::validateInputs()
 {
-    QString serverAddr = mServerAddr->currentText();
-    QString protocol;
-    QUrl url;
+    QString serverAddr = mServerAddr->currentText().trimmed();
 
     if (serverAddr.size() == 0) {
         showWarning(tr("Please enter the server address"));
         return false;
-    } else {
-        if (!serverAddr.startsWith("http://") && !serverAddr.startsWith("https://")) {
-            showWarning(tr("%1 is not a valid server address").arg(serverAddr));
-            return false;
-        }
-
-        url = QUrl(serverAddr, QUrl::StrictMode);
-        if (!url.isValid()) {
-            showWarning(tr("%1 is not a valid server address").arg(serverAddr));
-            return false;
-        }
+    } else if (RacingLoginRequest::candidateUrls(serverAddr).isEmpty()) {
+        showWarning(tr("%1 is not a valid server address").arg(serverAddr));
+        return false;
     }
 
     QString email = mUsername->text();
@@ -142,7 +134,7 @@ bool LoginDialog::validateInputs()
         showWarning(tr("Please enter the computer name"));
     }
 
-    url_ = url;
+    server_addr_ = serverAddr;
     username_ = mUsername->text();
     password_ = mPassword->text();
     computer_name_ = mComputerName->text();
@@ -152,9 +144,10 @@ bool LoginDialog::validateInputs()
     return true;
 }
 
-void LoginDialog::loginSuccess(const QString& token)
+void LoginDialog::loginSuccess(const QUrl& server_url, const QString& token)
 {
-    Account account(url_, username_, token);
+    // Saved with the url that worked, so the next requests go straight to it
+    Account account(server_url, username_, token);
     if (seafApplet->accountManager()->saveAccount(account) < 0) {
         showWarning(tr("Failed to save current account"));
     } else {
@@ -9,7 +9,7 @@
 #include <QNetworkReply>
 
 class Account;
-class LoginRequest;
+class RacingLoginRequest;
 class QNetworkReply;
 class QSslError;
 class ApiError;
@@ -23,7 +23,7 @@ public:
 
 private slots:
     void doLogin();
-    void loginSuccess(const QString& token);
+    void loginSuccess(const QUrl& server_url, const QString& token);
     void loginFailed(const ApiError& error);
 
 private:
@@ -37,11 +37,12 @@ private:
     void onSslErrors(QNetworkReply *reply, const QList<QSslError>& errors);
     void onHttpError(int code);
 
-    QUrl url_;
+    // as typed, see RacingLoginRequest::candidateUrls
+    QString server_addr_;
     QString username_;
     QString password_;
     QString computer_name_;
-    LoginRequest *request_;
+    RacingLoginRequest *request_;
 };
 
 #endif // SEAFILE_CLIENT_LOGIN_DIALOG_H
@@ -10,6 +10,7 @@
 #include "rpc/rpc-client.h"
 #include "rpc/clone-task.h"
 #include "rpc/local-repo.h"
+#include "transfer-progress.h"
 
 #include "repo-detail-dialog.h"
 
@@ -94,8 +95,12 @@ void RepoDetailDialog::updateRepoStatus()
             text = r.sync_state_str;
             if (r.sync_state == LocalRepo::SYNC_STATE_ING) {
                 // add transfer rate and finished percent
-                int rate, percent;
-                if (seafApplet->rpcClient()->getRepoTransferInfo(repo_.id, &rate, &percent) == 0) {
+                TransferProgress *progress = TransferProgress::instance();
+                progress->refreshTransferPercent(repo_.id);
+                int percent = progress->transferPercent(repo_.id);
+                if (percent >= 0) {
+                    RepoTransferInfo info = progress->repoTransferInfo(r.name);
+                    int rate = info.upload_rate + info.download_rate;
                     text += ", " + QString::number(percent) + "%, " +  QString("%1 kB/s").arg(rate / 1024);
                 }
             }
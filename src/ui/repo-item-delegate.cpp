@@ -5,6 +5,8 @@
 
 #include "utils/utils.h"
 #include "utils/paint-utils.h"
+#include "utils/trace-recorder.h"
+#include "utils/probes.h"
 #include "seafile-applet.h"
 #include "api/server-repo.h"
 #include "repo-item.h"
@@ -12,6 +14,7 @@
 #include "repo-tree-model.h"
 #include "rpc/rpc-client.h"
 #include "rpc/local-repo.h"
+#include "transfer-progress.h"
 
 #include "repo-item-delegate.h"
 
@@ -123,18 +126,18 @@ void RepoItemDelegate::paint(QPainter *painter,
                              const QStyleOptionViewItem& option,
                              const QModelIndex& index) const
 {
+    SEAFILE_TRACE_SPAN("paint", "RepoItemDelegate::paint");
+    SEAFILE_PROBE1(paint__start, index.row());
     QStandardItem *item = getItem(index);
     if (!item) {
         QStyledItemDelegate::paint(painter, option, index);
-        return;
-    }
-
-    if (item->type() == REPO_ITEM_TYPE) {
+    } else if (item->type() == REPO_ITEM_TYPE) {
         paintRepoItem(painter, option, (RepoItem *)item);
     } else {
         // QStyledItemDelegate::paint(painter, option, index);
         paintRepoCategoryItem(painter, option, (RepoCategoryItem *)item);
     }
+    SEAFILE_PROBE1(paint__done, index.row());
 }
 
 void RepoItemDelegate::paintRepoItem(QPainter *painter,
@@ -193,8 +196,8 @@ void RepoItemDelegate::paintRepoItem(QPainter *painter,
     const LocalRepo& r = item->localRepo();
     if (r.isValid() && r.sync_state == LocalRepo::SYNC_STATE_ING) {
         description = r.sync_state_str;
-        int rate, percent;
-        if (seafApplet->rpcClient()->getRepoTransferInfo(r.id, &rate, &percent) == 0) {
+        int percent = TransferProgress::instance()->transferPercent(r.id);
+        if (percent >= 0) {
             description += ", " + QString::number(percent) + "%";
         }
     } else {
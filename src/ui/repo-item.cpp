@@ -49,9 +49,11 @@ RepoCategoryItem::RepoCategoryItem(const QString& name)
     setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
 }
 
-RepoCategoryItem::RepoCategoryItem(const QString& name, int group_id)
+RepoCategoryItem::RepoCategoryItem(const QString& name, int group_id,
+                                   const QString& account)
     : name_(name),
-      group_id_(group_id)
+      group_id_(group_id),
+      account_(account)
 {
     setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
 }
@@ -74,9 +74,11 @@ public:
     RepoCategoryItem(const QString& name);
 
     /**
-     * Create a group category
+     * Create a group category. Groups of different accounts may have the
+     * same id, so the account (see ServerRepo::account) is part of it.
      */
-    RepoCategoryItem(const QString& name, int group_id);
+    RepoCategoryItem(const QString& name, int group_id,
+                     const QString& account=QString());
 
     virtual int type() const { return REPO_CATEGORY_TYPE; }
 
@@ -87,9 +89,12 @@ public:
 
     int groupId() const { return group_id_; }
 
+    const QString& account() const { return account_; }
+
 private:
     QString name_;
     int group_id_;
+    QString account_;
 };
 
 #endif // SEAFILE_CLIENT_REPO_ITEM_H
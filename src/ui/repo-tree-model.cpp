@@ -5,9 +5,16 @@
 
 #include "api/server-repo.h"
 #include "utils/utils.h"
+#include "utils/repo-id.h"
+#include "utils/trace.h"
+#include "utils/trace-recorder.h"
+#include "utils/perf-stats.h"
 #include "seafile-applet.h"
+#include "account-mgr.h"
+#include "repo-service.h"
 #include "main-window.h"
 #include "rpc/rpc-client.h"
+#include "transfer-progress.h"
 #include "repo-item.h"
 #include "repo-tree-view.h"
 #include "repo-tree-model.h"
@@ -19,9 +26,15 @@ const int kRefreshLocalReposInterval = 1000;
 const int kMaxRecentUpdatedRepos = 10;
 const int kIndexOfVirtualReposCategory = 2;
 
-bool compareRepoByTimestamp(const ServerRepo& a, const ServerRepo& b)
+// Ids of the categories of the personal, virtual and shared libraries of
+// the accounts other than the current one. Negative, unlike the group ids.
+const int kOtherMyReposCategoryId = -2;
+const int kOtherVirtualReposCategoryId = -3;
+const int kOtherSharedReposCategoryId = -4;
+
+bool compareRepoByTimestamp(const ServerRepo *a, const ServerRepo *b)
 {
-    return a.mtime > b.mtime;
+    return a->mtime > b->mtime;
 }
 
 /*
@@ -72,12 +85,18 @@ void RepoTreeModel::clear()
 
 void RepoTreeModel::setRepos(const std::vector<ServerRepo>& repos)
 {
+    SEAFILE_TRACE_SPAN("model", "RepoTreeModel::setRepos");
+    PerfScope perf(PerfStats::MODEL, "RepoTreeModel::setRepos");
     int i, n = repos.size();
     // removeReposDeletedOnServer(repos);
 
     clear();
 
-    QHash<QString, ServerRepo> map;
+    // A library may appear more than once, e.g. shared to several groups.
+    // Index them by the binary id and keep pointers to avoid copying them.
+    // An id which isn't a uuid has a null RepoId, index these by string.
+    QHash<RepoId, const ServerRepo*> map;
+    QHash<QString, const ServerRepo*> other_ids;
     for (i = 0; i < n; i++) {
         const ServerRepo& repo = repos[i];
         if (repo.isPersonalRepo()) {
@@ -92,18 +111,26 @@ void RepoTreeModel::setRepos(const std::vector<ServerRepo>& repos)
             checkGroupRepo(repo);
         }
 
-        map[repo.id] = repo;
+        RepoId repo_id = repo.repoId();
+        if (repo_id.isNull()) {
+            other_ids[repo.id] = &repo;
+        } else {
+            map[repo_id] = &repo;
+        }
     }
 
-    QList<ServerRepo> list = map.values();
+    QList<const ServerRepo*> list = map.values() + other_ids.values();
     // sort all repos by timestamp
     std::sort(list.begin(), list.end(), compareRepoByTimestamp);
 
     n = qMin(list.size(), kMaxRecentUpdatedRepos);
     for (i = 0; i < n; i++) {
-        RepoItem *item = new RepoItem(list[i]);
+        RepoItem *item = new RepoItem(*list[i]);
         recent_updated_category_->appendRow(item);
     }
+
+    SEAFILE_TRACE(TRACE_MODEL, "set %d repos (%d unique)",
+                  (int)repos.size(), list.size());
 }
 
 struct DeleteRepoData {
@@ -149,29 +176,49 @@ void RepoTreeModel::removeReposDeletedOnServer(const std::vector<ServerRepo>& re
 
 void RepoTreeModel::checkPersonalRepo(const ServerRepo& repo)
 {
-    int row, n = my_repos_catetory_->rowCount();
-    for (row = 0; row < n; row++) {
-        RepoItem *item = (RepoItem *)(my_repos_catetory_->child(row));
-        if (item->repo().id == repo.id) {
-            updateRepoItem(item, repo);
-            return;
-        }
+    if (isOfOtherAccount(repo)) {
+        checkRepoInCategory(otherAccountCategory(repo, kOtherMyReposCategoryId,
+                                                 tr("My Libraries")),
+                            repo);
+        return;
     }
 
-    // The repo is new
-    RepoItem *item = new RepoItem(repo);
-    my_repos_catetory_->appendRow(item);
+    checkRepoInCategory(my_repos_catetory_, repo);
 }
 
 void RepoTreeModel::checkVirtualRepo(const ServerRepo& repo)
 {
+    if (isOfOtherAccount(repo)) {
+        checkRepoInCategory(otherAccountCategory(repo, kOtherVirtualReposCategoryId,
+                                                 tr("Sub Libraries")),
+                            repo);
+        return;
+    }
+
     if (item(kIndexOfVirtualReposCategory) != virtual_repos_catetory_) {
         insertRow(kIndexOfVirtualReposCategory, virtual_repos_catetory_);
     }
 
-    int row, n = virtual_repos_catetory_->rowCount();
+    checkRepoInCategory(virtual_repos_catetory_, repo);
+}
+
+void RepoTreeModel::checkSharedRepo(const ServerRepo& repo)
+{
+    if (isOfOtherAccount(repo)) {
+        checkRepoInCategory(otherAccountCategory(repo, kOtherSharedReposCategoryId,
+                                                 tr("Private Shares")),
+                            repo);
+        return;
+    }
+
+    checkRepoInCategory(shared_repos_catetory_, repo);
+}
+
+void RepoTreeModel::checkRepoInCategory(RepoCategoryItem *category, const ServerRepo& repo)
+{
+    int row, n = category->rowCount();
     for (row = 0; row < n; row++) {
-        RepoItem *item = (RepoItem *)(virtual_repos_catetory_->child(row));
+        RepoItem *item = (RepoItem *)(category->child(row));
         if (item->repo().id == repo.id) {
             updateRepoItem(item, repo);
             return;
@@ -180,23 +227,35 @@ void RepoTreeModel::checkVirtualRepo(const ServerRepo& repo)
 
     // The repo is new
     RepoItem *item = new RepoItem(repo);
-    virtual_repos_catetory_->appendRow(item);
+    category->appendRow(item);
 }
 
-void RepoTreeModel::checkSharedRepo(const ServerRepo& repo)
+bool RepoTreeModel::isOfOtherAccount(const ServerRepo& repo) const
+{
+    const Account& current = seafApplet->accountManager()->currentAccount();
+    return !repo.account.isEmpty() && repo.account != RepoService::accountKey(current);
+}
+
+// e.g. "My Libraries (cloud.example.com)", created on first use after the
+// categories of the current account
+RepoCategoryItem* RepoTreeModel::otherAccountCategory(const ServerRepo& repo,
+                                                      int category_id,
+                                                      const QString& title)
 {
-    int row, n = shared_repos_catetory_->rowCount();
+    QStandardItem *root = invisibleRootItem();
+    int row, n = root->rowCount();
     for (row = 0; row < n; row++) {
-        RepoItem *item = (RepoItem *)(shared_repos_catetory_->child(row));
-        if (item->repo().id == repo.id) {
-            updateRepoItem(item, repo);
-            return;
+        RepoCategoryItem *item = (RepoCategoryItem *)(root->child(row));
+        if (item->groupId() == category_id && item->account() == repo.account) {
+            return item;
         }
     }
 
-    // The repo is new
-    RepoItem *item = new RepoItem(repo);
-    shared_repos_catetory_->appendRow(item);
+    QString name = QString("%1 (%2)").arg(title)
+        .arg(RepoService::instance()->accountForRepo(repo).serverUrl.host());
+    RepoCategoryItem *category = new RepoCategoryItem(name, category_id, repo.account);
+    appendRow(category);
+    return category;
 }
 
 void RepoTreeModel::checkGroupRepo(const ServerRepo& repo)
@@ -208,35 +267,29 @@ void RepoTreeModel::checkGroupRepo(const ServerRepo& repo)
 
     for (row = 0; row < n; row ++) {
         RepoCategoryItem *item = (RepoCategoryItem *)(root->child(row));
-        if (item->groupId() == repo.group_id) {
+        if (item->groupId() == repo.group_id && item->account() == repo.account) {
             group = item;
             break;
         }
     }
     if (!group) {
+        QString name = repo.group_name == "Organization" ? tr("Organization") : repo.group_name;
+
+        // Tell apart the groups of the accounts other than the current one
+        if (isOfOtherAccount(repo)) {
+            name += QString(" (%1)").arg(RepoService::instance()->accountForRepo(repo).serverUrl.host());
+        }
+
+        group = new RepoCategoryItem(name, repo.group_id, repo.account);
         if (repo.group_name == "Organization") {
-            group = new RepoCategoryItem(tr("Organization"), repo.group_id);
             // Insert pub repos after "recent updated", "my libraries", "shared libraries"
             insertRow(3, group);
         } else {
-            group = new RepoCategoryItem(repo.group_name, repo.group_id);
             appendRow(group);
         }
     }
 
-    // Find the repo in this group
-    n = group->rowCount();
-    for (row = 0; row < n; row++) {
-        RepoItem *item = (RepoItem *)(group->child(row));
-        if (item->repo().id == repo.id) {
-            updateRepoItem(item, repo);
-            return;
-        }
-    }
-
-    // Current repo not in this group yet
-    RepoItem *item = new RepoItem(repo);
-    group->appendRow(item);
+    checkRepoInCategory(group, repo);
 }
 
 void RepoTreeModel::updateRepoItem(RepoItem *item, const ServerRepo& repo)
@@ -264,10 +317,12 @@ void RepoTreeModel::forEachRepoItem(void (RepoTreeModel::*func)(RepoItem *, void
 
 void RepoTreeModel::refreshLocalRepos()
 {
-    if (!seafApplet->mainWindow()->isVisible()) {
+    SEAFILE_TRACE_SPAN("timer", "RepoTreeModel::refreshLocalRepos");
+    if (!seafApplet->mainWindow() || !seafApplet->mainWindow()->isVisible()) {
         return;
     }
 
+    PerfScope perf(PerfStats::MODEL, "RepoTreeModel::refreshLocalRepos");
     std::vector<CloneTask> tasks;
     seafApplet->rpcClient()->getCloneTasks(&tasks);
 
@@ -288,11 +343,19 @@ void RepoTreeModel::refreshRepoItem(RepoItem *item, void *data)
 
     LocalRepo local_repo;
     seafApplet->rpcClient()->getLocalRepo(item->repo().id, &local_repo);
+    // Here rather than in the delegate, which must not call the daemon
+    // when painting
+    bool percent_changed = local_repo.isValid()
+        && local_repo.sync_state == LocalRepo::SYNC_STATE_ING
+        && TransferProgress::instance()->refreshTransferPercent(local_repo.id);
     if (local_repo != item->localRepo()) {
         item->setLocalRepo(local_repo);
         QModelIndex index = indexFromItem(item);
         emit dataChanged(index,index);
-        // qDebug("repo %s is changed\n", toCStr(item->repo().name));
+        SEAFILE_TRACE(TRACE_MODEL, "repo %s is changed", toCStr(item->repo().name));
+    } else if (percent_changed) {
+        QModelIndex index = indexFromItem(item);
+        emit dataChanged(index,index);
     }
 
     item->setCloneTask();
@@ -50,6 +50,11 @@ private:
     void checkVirtualRepo(const ServerRepo& repo);
     void checkSharedRepo(const ServerRepo& repo);
     void checkGroupRepo(const ServerRepo& repo);
+    void checkRepoInCategory(RepoCategoryItem *category, const ServerRepo& repo);
+    bool isOfOtherAccount(const ServerRepo& repo) const;
+    RepoCategoryItem* otherAccountCategory(const ServerRepo& repo,
+                                           int category_id,
+                                           const QString& title);
     void initialize();
     void updateRepoItem(RepoItem *item, const ServerRepo& repo);
     void refreshRepoItem(RepoItem *item, void *data);
@@ -9,6 +9,7 @@
 #include "utils/utils.h"
 #include "seafile-applet.h"
 #include "account-mgr.h"
+#include "repo-service.h"
 #include "rpc/rpc-client.h"
 #include "rpc/local-repo.h"
 #include "download-repo-dialog.h"
@@ -283,7 +284,7 @@ void RepoTreeView::createActions()
 void RepoTreeView::downloadRepo()
 {
     ServerRepo repo = qvariant_cast<ServerRepo>(download_action_->data());
-    DownloadRepoDialog dialog(seafApplet->accountManager()->accounts()[0], repo, this);
+    DownloadRepoDialog dialog(RepoService::instance()->accountForRepo(repo), repo, this);
 
     dialog.exec();
 
@@ -367,7 +368,7 @@ void RepoTreeView::onItemDoubleClicked(const QModelIndex& index)
             QDesktopServices::openUrl(QUrl::fromLocalFile(local_repo.worktree));
         } else {
             // open seahub repo page for not downloaded repo
-            const Account& account = seafApplet->accountManager()->accounts()[0];
+            Account account = RepoService::instance()->accountForRepo(it->repo());
             if (account.isValid()) {
                 QUrl url = account.getAbsoluteUrl("repo/" + it->repo().id);
                 QDesktopServices::openUrl(url);
@@ -379,7 +380,8 @@ void RepoTreeView::onItemDoubleClicked(const QModelIndex& index)
 void RepoTreeView::viewRepoOnWeb()
 {
     QString repo_id = view_on_web_action_->data().toString();
-    const Account& account = seafApplet->accountManager()->accounts()[0];
+    RepoService *svc = RepoService::instance();
+    Account account = svc->accountForRepo(svc->getRepo(repo_id));
     if (account.isValid()) {
         QDesktopServices::openUrl(account.getAbsoluteUrl("repo/" + repo_id));
     }
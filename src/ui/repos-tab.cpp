@@ -40,8 +40,8 @@ ReposTab::ReposTab(QWidget *parent)
 
     RepoService *svc = RepoService::instance();
 
-    connect(svc, SIGNAL(refreshSuccess(const std::vector<ServerRepo>&)),
-            this, SLOT(refreshRepos(const std::vector<ServerRepo>&)));
+    connect(svc, SIGNAL(refreshSuccess(const RepoSnapshot&)),
+            this, SLOT(refreshRepos(const RepoSnapshot&)));
     connect(svc, SIGNAL(refreshFailed(const ApiError&)),
             this, SLOT(refreshReposFailed(const ApiError&)));
 
@@ -84,9 +84,9 @@ void ReposTab::createLoadingFailedView()
     layout->addWidget(label);
 }
 
-void ReposTab::refreshRepos(const std::vector<ServerRepo>& repos)
+void ReposTab::refreshRepos(const RepoSnapshot& snapshot)
 {
-    repos_model_->setRepos(repos);
+    repos_model_->setRepos(snapshot.repos());
 
     mStack->setCurrentIndex(INDEX_REPOS_VIEW);
 }
@@ -112,7 +112,15 @@ void ReposTab::showLoadingView()
 
 void ReposTab::refresh()
 {
-    showLoadingView();
+    // The libraries of all the accounts are kept while refreshing. Render
+    // them again right away, e.g. the group names depend on the current
+    // account, and only show the loading view if there is nothing yet.
+    RepoSnapshot snapshot = RepoService::instance()->snapshot();
+    if (snapshot.isEmpty()) {
+        showLoadingView();
+    } else {
+        refreshRepos(snapshot);
+    }
     RepoService::instance()->refresh(true);
 }
 
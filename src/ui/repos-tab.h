@@ -8,6 +8,7 @@ class QTimer;
 class RepoTreeModel;
 class RepoTreeView;
 class ServerRepo;
+class RepoSnapshot;
 class ListReposRequest;
 class ApiError;
 
@@ -29,7 +30,7 @@ protected:
     void stopRefresh();
 
 private slots:
-    void refreshRepos(const std::vector<ServerRepo>& repos);
+    void refreshRepos(const RepoSnapshot& snapshot);
     void refreshReposFailed(const ApiError& error);
 
 private:
@@ -5,9 +5,16 @@ extern "C" {
 }
 
 #include <QTimer>
+#include <QClipboard>
+#include <QApplication>
 
 #include "seafile-applet.h"
 #include "rpc/rpc-client.h"
+#include "utils/utils.h"
+#include "utils/perf-stats.h"
+#include "api/api-client.h"
+#include "transfer-stats-service.h"
+#include "transfer-chart.h"
 #include "server-status-dialog.h"
 
 
@@ -15,6 +22,35 @@ namespace {
 
 const int kRefreshStatusInterval = 1000; // 1 sec
 
+enum {
+    COLUMN_NAME = 0,
+    COLUMN_COUNT,
+    COLUMN_ERRORS,
+    COLUMN_P50,
+    COLUMN_P99,
+    COLUMN_MAX,
+    COLUMN_BYTES,
+    N_COLUMNS
+};
+
+QString formatDuration(qint64 usecs)
+{
+    if (usecs < 1000) {
+        return QString("%1 us").arg(usecs);
+    }
+    return QString("%1 ms").arg(usecs / 1000.0, 0, 'f', 1);
+}
+
+bool lessThanByName(const PerfStats::CallSummary& a, const PerfStats::CallSummary& b)
+{
+    return a.name < b.name;
+}
+
+bool timerLessThanByRate(const PerfStats::TimerSummary& a, const PerfStats::TimerSummary& b)
+{
+    return a.per_second > b.per_second;
+}
+
 } // namespace
 
 ServerStatusDialog::ServerStatusDialog(QWidget *parent) : QDialog(parent)
@@ -29,10 +65,38 @@ ServerStatusDialog::ServerStatusDialog(QWidget *parent) : QDialog(parent)
     setWindowTitle(tr("Servers connection status"));
     setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint);
 
+    mResolutionComboBox->addItem(tr("Last 10 minutes"),
+                                 TransferStatsService::RESOLUTION_SECOND);
+    mResolutionComboBox->addItem(tr("Last 24 hours"),
+                                 TransferStatsService::RESOLUTION_MINUTE);
+    mResolutionComboBox->addItem(tr("Last 30 days"),
+                                 TransferStatsService::RESOLUTION_HOUR);
+    connect(mResolutionComboBox, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(refreshTransferHistory()));
+    connect(mTabWidget, SIGNAL(currentChanged(int)),
+            this, SLOT(refreshTransferHistory()));
+
+    transfer_chart_ = new TransferChart;
+    transfer_chart_->setShowLabels(true);
+    mTransferTabLayout->addWidget(transfer_chart_, 1);
+
+    mPerfTree->header()->setResizeMode(COLUMN_NAME, QHeaderView::Stretch);
+    for (int i = COLUMN_COUNT; i < N_COLUMNS; i++) {
+        mPerfTree->header()->setResizeMode(i, QHeaderView::ResizeToContents);
+    }
+    mPerfTree->header()->setStretchLastSection(false);
+    connect(mPerfResetButton, SIGNAL(clicked()), this, SLOT(resetPerfStats()));
+    connect(mPerfCopyButton, SIGNAL(clicked()), this, SLOT(copyPerfStats()));
+    connect(mTabWidget, SIGNAL(currentChanged(int)),
+            this, SLOT(refreshPerfStats()));
+
     refresh_timer_ = new QTimer(this);
     connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshStatus()));
+    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshTransferHistory()));
+    connect(refresh_timer_, SIGNAL(timeout()), this, SLOT(refreshPerfStats()));
 
     refreshStatus();
+    refreshTransferHistory();
     refresh_timer_->start(kRefreshStatusInterval);
 }
 
@@ -74,4 +138,120 @@ void ServerStatusDialog::refreshStatus()
     g_list_free (servers);
 }
 
+void ServerStatusDialog::refreshTransferHistory()
+{
+    if (mTabWidget->currentWidget() != mTransferTab) {
+        return;
+    }
+
+    int index = mResolutionComboBox->currentIndex();
+    TransferStatsService::Resolution resolution =
+        (TransferStatsService::Resolution)mResolutionComboBox->itemData(index).toInt();
+
+    transfer_chart_->setSamples(TransferStatsService::instance()->samples(resolution));
+}
+
+void ServerStatusDialog::refreshPerfStats()
+{
+    if (mTabWidget->currentWidget() != mPerfTab) {
+        return;
+    }
+
+    mPerfTree->clear();
+
+    addPerfGroup(tr("Daemon RPC calls"), PerfStats::RPC);
+    addPerfGroup(tr("Server API requests"), PerfStats::API);
+    addCompressionStats();
+    addPerfGroup(tr("Model updates"), PerfStats::MODEL);
+
+    QList<PerfStats::TimerSummary> timers = PerfStats::instance()->timerSummaries();
+    qSort(timers.begin(), timers.end(), timerLessThanByRate);
 
+    double total_per_second = 0;
+    foreach (const PerfStats::TimerSummary& timer, timers) {
+        total_per_second += timer.per_second;
+    }
+
+    QTreeWidgetItem *group = new QTreeWidgetItem(mPerfTree);
+    group->setText(COLUMN_NAME, tr("Timer wakeups (%1/s)").arg(total_per_second, 0, 'f', 1));
+    group->setFirstColumnSpanned(true);
+    QFont font = group->font(COLUMN_NAME);
+    font.setBold(true);
+    group->setFont(COLUMN_NAME, font);
+
+    foreach (const PerfStats::TimerSummary& timer, timers) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(mPerfTree);
+        item->setText(COLUMN_NAME, "    " + timer.name);
+        item->setText(COLUMN_COUNT, tr("%1 (%2/s)")
+                      .arg(timer.wakeups)
+                      .arg(timer.per_second, 0, 'f', 1));
+    }
+}
+
+void ServerStatusDialog::addPerfGroup(const QString& title, int kind)
+{
+    QList<PerfStats::CallSummary> calls =
+        PerfStats::instance()->callSummaries((PerfStats::Kind)kind);
+    qSort(calls.begin(), calls.end(), lessThanByName);
+
+    QTreeWidgetItem *group = new QTreeWidgetItem(mPerfTree);
+    group->setText(COLUMN_NAME, title);
+    group->setFirstColumnSpanned(true);
+    QFont font = group->font(COLUMN_NAME);
+    font.setBold(true);
+    group->setFont(COLUMN_NAME, font);
+
+    foreach (const PerfStats::CallSummary& call, calls) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(mPerfTree);
+        item->setText(COLUMN_NAME, "    " + call.name);
+        item->setToolTip(COLUMN_NAME, call.name);
+        item->setText(COLUMN_COUNT, QString::number(call.count));
+        item->setText(COLUMN_ERRORS, QString::number(call.errors));
+        item->setText(COLUMN_P50, formatDuration(call.p50_us));
+        item->setText(COLUMN_P99, formatDuration(call.p99_us));
+        item->setText(COLUMN_MAX, formatDuration(call.max_us));
+        if (kind == PerfStats::API) {
+            item->setText(COLUMN_BYTES, readableFileSize(call.bytes));
+        }
+    }
+}
+
+// Since the start of the applet, not cleared by "Reset"
+void ServerStatusDialog::addCompressionStats()
+{
+    quint64 compressed = SeafileApiClient::compressedBytesTotal();
+    quint64 decompressed = SeafileApiClient::decompressedBytesTotal();
+
+    QTreeWidgetItem *item = new QTreeWidgetItem(mPerfTree);
+    item->setText(COLUMN_NAME, "    " + tr("Compressed responses (%1 once decompressed)")
+                  .arg(readableFileSize(decompressed)));
+    item->setToolTip(COLUMN_NAME, tr("Since the applet started"));
+    item->setText(COLUMN_BYTES, readableFileSize(compressed));
+}
+
+void ServerStatusDialog::resetPerfStats()
+{
+    PerfStats::instance()->reset();
+    refreshPerfStats();
+}
+
+void ServerStatusDialog::copyPerfStats()
+{
+    QStringList lines;
+    QStringList header;
+    for (int i = 0; i < N_COLUMNS; i++) {
+        header << mPerfTree->headerItem()->text(i);
+    }
+    lines << header.join("\t");
+
+    for (int i = 0; i < mPerfTree->topLevelItemCount(); i++) {
+        QTreeWidgetItem *item = mPerfTree->topLevelItem(i);
+        QStringList fields;
+        for (int j = 0; j < N_COLUMNS; j++) {
+            fields << item->text(j).trimmed();
+        }
+        lines << fields.join("\t").trimmed();
+    }
+
+    QApplication::clipboard()->setText(lines.join("\n") + "\n");
+}
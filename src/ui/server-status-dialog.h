@@ -5,6 +5,7 @@
 #include "ui_server-status-dialog.h"
 
 class QTimer;
+class TransferChart;
 
 class ServerStatusDialog : public QDialog,
                            public Ui::ServerStatusDialog
@@ -15,11 +16,20 @@ public:
 
 private slots:
     void refreshStatus();
+    void refreshTransferHistory();
+    void refreshPerfStats();
+    void resetPerfStats();
+    void copyPerfStats();
 
 private:
     Q_DISABLE_COPY(ServerStatusDialog)
 
+    void addPerfGroup(const QString& title, int kind);
+    void addCompressionStats();
+
     QTimer *refresh_timer_;
+
+    TransferChart *transfer_chart_;
 };
 
 #endif // SEAFILE_CLIENT_SERVER_STATUS_DIALOG_H
@@ -42,7 +42,9 @@ void SetRepoPasswordDialog::onOkBtnClicked()
     const Account& account = seafApplet->accountManager()->currentAccount();
 
     if (request_) {
-        delete request_;
+        // It may be the request reporting to us right now
+        request_->cancel();
+        request_->deleteLater();
     }
 
     request_ = new SetRepoPasswordRequest(account, repo_.id, password);
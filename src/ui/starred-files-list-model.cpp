@@ -4,6 +4,7 @@
 #include <algorithm>            // std::sort
 
 #include "utils/utils.h"
+#include "utils/perf-stats.h"
 #include "seafile-applet.h"
 #include "main-window.h"
 #include "rpc/rpc-client.h"
@@ -27,6 +28,7 @@ StarredFilesListModel::StarredFilesListModel(QObject *parent)
 
 void StarredFilesListModel::setFiles(const std::vector<StarredFile>& files)
 {
+    PerfScope perf(PerfStats::MODEL, "StarredFilesListModel::setFiles");
     int i, n = files.size();
 
     clear();
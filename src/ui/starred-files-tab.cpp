@@ -6,8 +6,8 @@
 
 #include "seafile-applet.h"
 #include "account-mgr.h"
+#include "repo-service.h"
 #include "api/requests.h"
-#include "api/starred-file.h"
 #include "loading-view.h"
 #include "starred-files-list-view.h"
 #include "starred-files-list-model.h"
@@ -18,6 +18,7 @@
 namespace {
 
 const int kRefreshInterval = 1000 * 60 * 5; // 5 min
+const int kMaxCachedAccounts = 4;
 const char *kLoadingFaieldLabelName = "loadingFailedText";
 const char *kEmptyViewLabelName = "emptyText";
 
@@ -49,6 +50,8 @@ StarredFilesTab::StarredFilesTab(QWidget *parent)
 
     get_starred_files_req_ = NULL;
 
+    cache_.setMaxCost(kMaxCachedAccounts);
+
     refresh();
 }
 
@@ -106,31 +109,41 @@ void StarredFilesTab::createEmptyView()
 
 void StarredFilesTab::refresh()
 {
-    if (in_refresh_) {
+    const Account& account = seafApplet->accountManager()->currentAccount();
+    if (!account.isValid()) {
+        showLoadingView();
         return;
     }
 
-    in_refresh_ = true;
-
-    showLoadingView();
-    //AccountManager *account_mgr = seafApplet->accountManager();
-
-    const std::vector<Account>& accounts = seafApplet->accountManager()->accounts();
-    if (accounts.empty()) {
-        in_refresh_ = false;
+    QString key = RepoService::accountKey(account);
+    if (in_refresh_ && key == req_account_) {
         return;
     }
 
-    if (get_starred_files_req_) {
-        delete get_starred_files_req_;
+    in_refresh_ = true;
+
+    // Show the files we already have while fetching them again
+    const std::vector<StarredFile> *files = cache_.object(key);
+    if (files) {
+        showStarredFiles(*files);
+    } else {
+        showLoadingView();
     }
 
-    get_starred_files_req_ = new GetStarredFilesRequest(accounts[0]);
+    GetStarredFilesRequest *old_req = get_starred_files_req_;
+
+    get_starred_files_req_ = new GetStarredFilesRequest(account);
+    req_account_ = key;
     connect(get_starred_files_req_, SIGNAL(success(const std::vector<StarredFile>&)),
             this, SLOT(refreshStarredFiles(const std::vector<StarredFile>&)));
     connect(get_starred_files_req_, SIGNAL(failed(const ApiError&)),
             this, SLOT(refreshStarredFilesFailed(const ApiError&)));
     get_starred_files_req_->send();
+
+    if (old_req) {
+        old_req->cancel();
+        old_req->deleteLater();
+    }
 }
 
 void StarredFilesTab::refreshStarredFiles(const std::vector<StarredFile>& files)
@@ -140,6 +153,13 @@ void StarredFilesTab::refreshStarredFiles(const std::vector<StarredFile>& files)
     get_starred_files_req_->deleteLater();
     get_starred_files_req_ = NULL;
 
+    cache_.insert(req_account_, new std::vector<StarredFile>(files));
+
+    showStarredFiles(files);
+}
+
+void StarredFilesTab::showStarredFiles(const std::vector<StarredFile>& files)
+{
     files_list_model_->setFiles(files);
     if (files.empty()) {
         mStack->setCurrentIndex(INDEX_EMPTY_VIEW);
@@ -1,6 +1,11 @@
 #ifndef SEAFILE_CLIENT_UI_STARRED_FILES_TAB_H
 #define SEAFILE_CLIENT_UI_STARRED_FILES_TAB_H
 
+#include <vector>
+#include <QCache>
+#include <QString>
+
+#include "api/starred-file.h"
 #include "tab-view.h"
 
 class QTimer;
@@ -8,7 +13,6 @@ class QListWidget;
 
 class GetStarredFilesRequest;
 class ApiError;
-class StarredFile;
 class StarredFilesListView;
 class StarredFilesListModel;
 
@@ -37,6 +41,7 @@ private:
     void createLoadingFailedView();
     void createEmptyView();
     void showLoadingView();
+    void showStarredFiles(const std::vector<StarredFile>& files);
 
     QTimer *refresh_timer_;
     bool in_refresh_;
@@ -49,6 +54,12 @@ private:
     QWidget *empty_view_;
 
     GetStarredFilesRequest *get_starred_files_req_;
+    // the account of get_starred_files_req_, see RepoService::accountKey()
+    QString req_account_;
+
+    // The starred files of the recently used accounts, shown right away when
+    // switching back to one of them
+    QCache<QString, std::vector<StarredFile> > cache_;
 };
 
 #endif // SEAFILE_CLIENT_UI_STARRED_FILES_TAB_H
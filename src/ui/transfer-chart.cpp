@@ -0,0 +1,106 @@
+#include <QPainter>
+#include <QPaintEvent>
+#include <QPolygonF>
+
+#include "utils/paint-utils.h"
+
+#include "transfer-chart.h"
+
+namespace {
+
+const char *kDownloadColor = "#3A87AD";
+const char *kUploadColor = "#5CB85C";
+const char *kFrameColor = "#DDDDDD";
+const char *kLabelColor = "#999999";
+
+const int kLabelFontSize = 11;
+
+QString formatRate(quint32 rate)
+{
+    if (rate >= 1024 * 1024) {
+        return QObject::tr("%1 MB/s").arg(rate / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+    return QObject::tr("%1 kB/s").arg(rate / 1024);
+}
+
+} // namespace
+
+TransferChart::TransferChart(QWidget *parent)
+    : QWidget(parent),
+      show_labels_(false),
+      max_samples_(0)
+{
+}
+
+void TransferChart::setSamples(const std::vector<TransferRateSample>& samples)
+{
+    if (max_samples_ > 0 && (int)samples.size() > max_samples_) {
+        samples_.assign(samples.end() - max_samples_, samples.end());
+    } else {
+        samples_ = samples;
+    }
+    update();
+}
+
+void TransferChart::setShowLabels(bool show)
+{
+    show_labels_ = show;
+    update();
+}
+
+void TransferChart::setMaxSamples(int max)
+{
+    max_samples_ = max;
+}
+
+QSize TransferChart::sizeHint() const
+{
+    if (show_labels_) {
+        return QSize(400, 150);
+    }
+    return QSize(::getDPIScaledSize(60), ::getDPIScaledSize(16));
+}
+
+void TransferChart::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QRectF area = QRectF(rect()).adjusted(1, 1, -1, -1);
+
+    if (show_labels_) {
+        painter.setPen(QColor(kFrameColor));
+        painter.drawRect(area);
+    }
+
+    int n = samples_.size();
+    if (n < 2) {
+        return;
+    }
+
+    quint32 peak = 1;
+    for (int i = 0; i < n; i++) {
+        peak = qMax(peak, qMax(samples_[i].upload_rate, samples_[i].download_rate));
+    }
+
+    QPolygonF up, down;
+    double step = area.width() / (n - 1);
+    for (int i = 0; i < n; i++) {
+        double x = area.left() + i * step;
+        up << QPointF(x, area.bottom() - area.height() * samples_[i].upload_rate / peak);
+        down << QPointF(x, area.bottom() - area.height() * samples_[i].download_rate / peak);
+    }
+
+    painter.setPen(QPen(QColor(kDownloadColor), 1));
+    painter.drawPolyline(down);
+    painter.setPen(QPen(QColor(kUploadColor), 1));
+    painter.drawPolyline(up);
+
+    if (show_labels_ && peak > 1) {
+        painter.setPen(QColor(kLabelColor));
+        painter.setFont(changeFontSize(painter.font(), kLabelFontSize));
+        painter.drawText(area.adjusted(4, 2, -4, -2),
+                         Qt::AlignRight | Qt::AlignTop,
+                         tr("peak %1").arg(formatRate(peak)));
+    }
+}
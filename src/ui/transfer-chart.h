@@ -0,0 +1,42 @@
+#ifndef SEAFILE_CLIENT_TRANSFER_CHART_H_
+#define SEAFILE_CLIENT_TRANSFER_CHART_H_
+
+#include <vector>
+#include <QWidget>
+
+#include "transfer-stats-service.h"
+
+class QPaintEvent;
+
+/**
+ * Draws the upload and download rates as two lines. Used as a small
+ * sparkline in the footer of the main window, and as a larger chart (with
+ * labels) in the server status dialog.
+ */
+class TransferChart : public QWidget {
+    Q_OBJECT
+public:
+    TransferChart(QWidget *parent=0);
+
+    void setSamples(const std::vector<TransferRateSample>& samples);
+
+    // Show the peak rate and a frame. Off by default.
+    void setShowLabels(bool show);
+
+    // Only draw the last @max samples. 0 (the default) means all of them.
+    void setMaxSamples(int max);
+
+    QSize sizeHint() const;
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private:
+    Q_DISABLE_COPY(TransferChart)
+
+    std::vector<TransferRateSample> samples_;
+    bool show_labels_;
+    int max_samples_;
+};
+
+#endif // SEAFILE_CLIENT_TRANSFER_CHART_H_
@@ -16,6 +16,8 @@ extern "C" {
 #include "settings-dialog.h"
 #include "settings-mgr.h"
 #include "seahub-notifications-monitor.h"
+#include "utils/utils.h"
+#include "utils/trace-recorder.h"
 
 #include "tray-icon.h"
 #if defined(Q_WS_MAC)
@@ -122,6 +124,11 @@ void SeafileTrayIcon::createActions()
     open_help_action_ = new QAction(tr("&Online help"), this);
     open_help_action_->setStatusTip(tr("open seafile online help"));
     connect(open_help_action_, SIGNAL(triggered()), this, SLOT(openHelp()));
+
+    // Only shown when the menu is opened with shift pressed, or when
+    // recording is on
+    performance_trace_action_ = new QAction(this);
+    connect(performance_trace_action_, SIGNAL(triggered()), this, SLOT(togglePerformanceTrace()));
 }
 
 void SeafileTrayIcon::createContextMenu()
@@ -135,6 +142,7 @@ void SeafileTrayIcon::createContextMenu()
     context_menu_->addAction(toggle_main_window_action_);
     context_menu_->addAction(settings_action_);
     context_menu_->addAction(open_log_directory_action_);
+    context_menu_->addAction(performance_trace_action_);
     context_menu_->addMenu(help_menu_);
     context_menu_->addSeparator();
     context_menu_->addAction(enable_auto_sync_action_);
@@ -163,6 +171,13 @@ void SeafileTrayIcon::prepareContextMenu()
     }
 
     view_unread_seahub_notifications_action_->setVisible(state_ == STATE_HAVE_UNREAD_MESSAGE);
+
+    bool recording = TraceRecorder::isEnabled();
+    performance_trace_action_->setText(recording
+                                       ? tr("Save performance trace")
+                                       : tr("Record performance trace"));
+    performance_trace_action_->setVisible(
+        recording || (QApplication::keyboardModifiers() & Qt::ShiftModifier));
 }
 
 void SeafileTrayIcon::notify(const QString &title, const QString &content)
@@ -346,6 +361,26 @@ void SeafileTrayIcon::openLogDirectory()
     QDesktopServices::openUrl(QUrl::fromLocalFile(log_path));
 }
 
+void SeafileTrayIcon::togglePerformanceTrace()
+{
+    TraceRecorder *recorder = TraceRecorder::instance();
+    if (!TraceRecorder::isEnabled()) {
+        recorder->setEnabled(true);
+        return;
+    }
+
+    recorder->setEnabled(false);
+
+    QString name = QString("applet-trace-%1.json")
+        .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    QString path = QDir(seafApplet->configurator()->ccnetDir()).filePath("logs/" + name);
+    if (recorder->exportToFile(path)) {
+        notify(getBrand(), tr("Performance trace saved to %1").arg(path));
+    } else {
+        notify(getBrand(), tr("Failed to save performance trace"));
+    }
+}
+
 void SeafileTrayIcon::showSettingsWindow()
 {
     seafApplet->settingsDialog()->show();
@@ -394,6 +429,7 @@ void SeafileTrayIcon::quitSeafile()
 
 void SeafileTrayIcon::refreshTrayIcon()
 {
+    SEAFILE_TRACE_SPAN("timer", "SeafileTrayIcon::refreshTrayIcon");
     if (rotate_timer_->isActive()) {
         return;
     }
@@ -52,6 +52,7 @@ private slots:
     void about();
     void onSeahubNotificationsChanged();
     void viewUnreadNotifications();
+    void togglePerformanceTrace();
 
 private:
     Q_DISABLE_COPY(SeafileTrayIcon)
@@ -74,6 +75,7 @@ private:
     QAction *settings_action_;
     QAction *open_log_directory_action_;
     QAction *view_unread_seahub_notifications_action_;
+    QAction *performance_trace_action_;
 
     QAction *about_action_;
     QAction *open_help_action_;
@@ -4,9 +4,70 @@
 
 #include "log.h"
 
-static FILE *logfp;
+/*
+ * Messages are passed from the logging threads to the writer thread through
+ * a bounded lock-free queue (Dmitry Vyukov's MPMC queue, with a single
+ * consumer). Each slot carries a sequence number telling whether it is free
+ * for the producer at a given position, or ready for the consumer.
+ *
+ * The calling thread only copies the message into a slot. Formatting the
+ * timestamp, writing and flushing the file, and rotating it are done by
+ * the writer thread. If the queue is full the message is dropped and
+ * counted, the caller never blocks.
+ */
+
+#define LOG_QUEUE_SIZE 4096     /* must be a power of 2 */
+#define LOG_QUEUE_MASK (LOG_QUEUE_SIZE - 1)
+#define LOG_SLOT_MSG_SIZE 480   /* longer messages are allocated */
+
+#define LOG_FLUSH_INTERVAL_MS 100
+#define LOG_DEFAULT_MAX_FILE_SIZE (10 * 1024 * 1024)
+#define LOG_MAX_ROTATED_FILES 3
+#define LOG_REOPEN_INTERVAL_US (5 * G_USEC_PER_SEC)
+
+#define LOG_MAX_CATEGORIES 32
+#define LOG_MAX_CATEGORY_NAME 32
+
+typedef struct {
+    volatile gint seq;
+    gint level;
+    gint64 time_us;
+    char *long_msg;
+    char msg[LOG_SLOT_MSG_SIZE];
+} LogSlot;
+
+typedef struct {
+    char name[LOG_MAX_CATEGORY_NAME];
+    volatile gint level;
+} LogCategory;
 
-static GLogLevelFlags applet_log_level;
+static LogSlot *slots;
+static volatile gint enqueue_pos;
+/* only accessed by the writer thread */
+static gint dequeue_pos;
+/* position up to which messages are written, for applet_log_flush */
+static volatile gint written_pos;
+/* dropped since the last "messages dropped" line, reset by the writer */
+static volatile gint dropped;
+/* dropped since the start, for applet_log_dropped_count */
+static volatile gint dropped_total;
+static volatile gint stopping;
+
+static GThread *writer_thread;
+static GMutex *wake_lock;
+static GCond *wake_cond;
+
+static volatile gint default_level = G_LOG_LEVEL_DEBUG;
+static LogCategory categories[LOG_MAX_CATEGORIES];
+static volatile gint n_categories;
+static GMutex *categories_lock;
+
+static FILE *logfp;
+static char *log_file;
+static gint64 log_file_size;
+static gint64 max_file_size = LOG_DEFAULT_MAX_FILE_SIZE;
+/* when to try to open the log file again after a failure */
+static gint64 next_reopen_us;
 
 static int
 checkdir_with_mkdir (const char *dir)
@@ -24,63 +85,462 @@ checkdir_with_mkdir (const char *dir)
 #endif
 }
 
+/* Compatibility with glib < 2.32 */
+
+static GMutex *
+log_mutex_new (void)
+{
+#if GLIB_CHECK_VERSION(2, 32, 0)
+    GMutex *mutex = g_new0 (GMutex, 1);
+    g_mutex_init (mutex);
+    return mutex;
+#else
+    return g_mutex_new ();
+#endif
+}
+
+static GCond *
+log_cond_new (void)
+{
+#if GLIB_CHECK_VERSION(2, 32, 0)
+    GCond *cond = g_new0 (GCond, 1);
+    g_cond_init (cond);
+    return cond;
+#else
+    return g_cond_new ();
+#endif
+}
+
+static void
+log_cond_wait_ms (GCond *cond, GMutex *mutex, int ms)
+{
+#if GLIB_CHECK_VERSION(2, 32, 0)
+    g_cond_wait_until (cond, mutex,
+                       g_get_monotonic_time () + ms * G_TIME_SPAN_MILLISECOND);
+#else
+    GTimeVal tv;
+    g_get_current_time (&tv);
+    g_time_val_add (&tv, ms * 1000);
+    g_cond_timed_wait (cond, mutex, &tv);
+#endif
+}
+
+static void
+wake_writer (void)
+{
+    g_mutex_lock (wake_lock);
+    g_cond_signal (wake_cond);
+    g_mutex_unlock (wake_lock);
+}
+
+/* Categories */
+
+static int
+find_category (const char *name, size_t len)
+{
+    int i, n = g_atomic_int_get (&n_categories);
+
+    if (len == 0 || len >= LOG_MAX_CATEGORY_NAME)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        if (strncmp (categories[i].name, name, len) == 0
+            && categories[i].name[len] == '\0')
+            return i;
+    }
+    return -1;
+}
+
+static gint
+level_for_message (const gchar *log_domain, const gchar *message)
+{
+    int i = -1;
+
+    if (g_atomic_int_get (&n_categories) == 0)
+        return g_atomic_int_get (&default_level);
+
+    if (log_domain) {
+        i = find_category (log_domain, strlen(log_domain));
+    } else if (message && message[0] == '[') {
+        const char *end = strchr (message, ']');
+        if (end)
+            i = find_category (message + 1, end - message - 1);
+    }
+
+    if (i < 0)
+        return g_atomic_int_get (&default_level);
+    return g_atomic_int_get (&categories[i].level);
+}
+
+void
+applet_log_set_level (const char *category, GLogLevelFlags level)
+{
+    int i;
+
+    if (!category || g_strcmp0 (category, "default") == 0) {
+        g_atomic_int_set (&default_level, level & G_LOG_LEVEL_MASK);
+        return;
+    }
+
+    if (strlen(category) >= LOG_MAX_CATEGORY_NAME)
+        return;
+
+    if (!categories_lock)
+        categories_lock = log_mutex_new ();
+
+    g_mutex_lock (categories_lock);
+    i = find_category (category, strlen(category));
+    if (i < 0 && n_categories < LOG_MAX_CATEGORIES) {
+        i = n_categories;
+        g_strlcpy (categories[i].name, category, LOG_MAX_CATEGORY_NAME);
+        categories[i].level = level & G_LOG_LEVEL_MASK;
+        /* publish the entry after it is filled */
+        g_atomic_int_set (&n_categories, i + 1);
+    } else if (i >= 0) {
+        g_atomic_int_set (&categories[i].level, level & G_LOG_LEVEL_MASK);
+    }
+    g_mutex_unlock (categories_lock);
+}
+
+static GLogLevelFlags
+parse_level (const char *str)
+{
+    if (g_ascii_strcasecmp (str, "error") == 0)
+        return G_LOG_LEVEL_ERROR;
+    if (g_ascii_strcasecmp (str, "critical") == 0)
+        return G_LOG_LEVEL_CRITICAL;
+    if (g_ascii_strcasecmp (str, "warning") == 0)
+        return G_LOG_LEVEL_WARNING;
+    if (g_ascii_strcasecmp (str, "message") == 0)
+        return G_LOG_LEVEL_MESSAGE;
+    if (g_ascii_strcasecmp (str, "info") == 0)
+        return G_LOG_LEVEL_INFO;
+    return G_LOG_LEVEL_DEBUG;
+}
+
+/* format: "category=level,category=level" */
+static void
+load_levels_from_env (void)
+{
+    const char *env = g_getenv ("SEAFILE_APPLET_LOG_LEVELS");
+    char **items, **p;
+
+    if (!env)
+        return;
+
+    items = g_strsplit (env, ",", -1);
+    for (p = items; *p; p++) {
+        char *eq = strchr (*p, '=');
+        if (!eq)
+            continue;
+        *eq = '\0';
+        applet_log_set_level (g_strstrip(*p), parse_level (g_strstrip(eq + 1)));
+    }
+    g_strfreev (items);
+}
+
+/* Producer side */
+
+static gboolean
+log_enqueue (gint level, const gchar *message, gint *pos_out)
+{
+    LogSlot *slot;
+    gint pos, seq, diff;
+    size_t len;
+
+    pos = g_atomic_int_get (&enqueue_pos);
+    for (;;) {
+        slot = &slots[pos & LOG_QUEUE_MASK];
+        seq = g_atomic_int_get (&slot->seq);
+        diff = (gint)((guint)seq - (guint)pos);
+        if (diff == 0) {
+            if (g_atomic_int_compare_and_exchange (&enqueue_pos, pos, (gint)((guint)pos + 1)))
+                break;
+        } else if (diff < 0) {
+            /* full */
+            g_atomic_int_inc (&dropped);
+            g_atomic_int_inc (&dropped_total);
+            return FALSE;
+        } else {
+            pos = g_atomic_int_get (&enqueue_pos);
+        }
+    }
+
+    slot->level = level;
+    slot->time_us = g_get_real_time ();
+
+    len = message ? strlen(message) : 0;
+    if (len < LOG_SLOT_MSG_SIZE) {
+        memcpy (slot->msg, message ? message : "", len + 1);
+        slot->long_msg = NULL;
+    } else {
+        slot->msg[0] = '\0';
+        slot->long_msg = g_strdup (message);
+    }
+
+    /* hand the slot to the writer */
+    g_atomic_int_set (&slot->seq, (gint)((guint)pos + 1));
+
+    if (pos_out)
+        *pos_out = pos;
+    return TRUE;
+}
+
 static void
 applet_log (const gchar *log_domain, GLogLevelFlags log_level,
             const gchar *message, gpointer user_data)
 {
-    if (log_level > applet_log_level)
-        return;
+    gint level = log_level & G_LOG_LEVEL_MASK;
+    gint pos;
 
     if (log_level & G_LOG_FLAG_FATAL)
         fputs (message, stderr);
 
-    time_t t;
+    if (level > level_for_message (log_domain, message))
+        return;
+
+    if (!log_enqueue (level, message, &pos))
+        return;
+
+    if (log_level & G_LOG_FLAG_FATAL) {
+        /* We are about to abort, make sure the message gets to the file */
+        applet_log_flush ();
+    } else if (level <= G_LOG_LEVEL_WARNING
+               || (guint)pos - (guint)g_atomic_int_get (&written_pos) >= LOG_QUEUE_SIZE / 2) {
+        wake_writer ();
+    }
+}
+
+/* Writer side */
+
+static void
+open_log_file (void)
+{
+    if ((logfp = (FILE *)(long)g_fopen (log_file, "a+")) == NULL) {
+        log_file_size = 0;
+        next_reopen_us = g_get_monotonic_time () + LOG_REOPEN_INTERVAL_US;
+        return;
+    }
+
+    fseek (logfp, 0, SEEK_END);
+    log_file_size = ftell (logfp);
+}
+
+static void
+rotate_log_file (void)
+{
+    int i;
+
+    fclose (logfp);
+    logfp = NULL;
+
+    for (i = LOG_MAX_ROTATED_FILES - 1; i >= 0; i--) {
+        char *from = i == 0 ? g_strdup (log_file) : g_strdup_printf ("%s.%d", log_file, i);
+        char *to = g_strdup_printf ("%s.%d", log_file, i + 1);
+        /* rename fails on windows if the target exists */
+        g_unlink (to);
+        g_rename (from, to);
+        g_free (from);
+        g_free (to);
+    }
+
+    open_log_file ();
+}
+
+/* Format "[%x %X] " only once per second */
+static const char *
+format_timestamp (gint64 time_us)
+{
+    static char buf[128];
+    static time_t cached_sec = (time_t)-1;
+    time_t t = (time_t)(time_us / G_USEC_PER_SEC);
     struct tm *tm;
-    char buf[1024];
+
+    if (t != cached_sec) {
+        tm = localtime (&t);
+        if (strftime (buf, sizeof(buf), "[%x %X] ", tm) == 0)
+            buf[0] = '\0';
+        cached_sec = t;
+    }
+
+    return buf;
+}
+
+/* Write all the messages in the queue. Returns the number written. */
+static int
+write_pending (GString *batch)
+{
+    LogSlot *slot;
+    gint seq;
+    const char *msg;
     size_t len;
+    int n = 0;
+    guint ndropped;
 
-    if (log_level > applet_log_level)
-        return;
+    g_string_truncate (batch, 0);
+
+    for (;;) {
+        slot = &slots[dequeue_pos & LOG_QUEUE_MASK];
+        seq = g_atomic_int_get (&slot->seq);
+        if (seq != (gint)((guint)dequeue_pos + 1))
+            break;
+
+        msg = slot->long_msg ? slot->long_msg : slot->msg;
+        len = strlen(msg);
+
+        g_string_append (batch, format_timestamp (slot->time_us));
+        g_string_append_len (batch, msg, len);
+        if (len > 0 && msg[len - 1] != '\n')
+            g_string_append_c (batch, '\n');
+
+        g_free (slot->long_msg);
+        slot->long_msg = NULL;
+
+        /* free the slot for the producer one round later */
+        g_atomic_int_set (&slot->seq, (gint)((guint)dequeue_pos + LOG_QUEUE_SIZE));
+        dequeue_pos = (gint)((guint)dequeue_pos + 1);
+        n++;
+    }
+
+    ndropped = (guint)g_atomic_int_get (&dropped);
+    if (ndropped > 0) {
+        g_atomic_int_add (&dropped, -(gint)ndropped);
+        g_string_append_printf (batch, "%s[log] %u messages dropped\n",
+                                format_timestamp (g_get_real_time ()), ndropped);
+    }
+
+    if (batch->len > 0 && !logfp && g_get_monotonic_time () >= next_reopen_us) {
+        /* e.g. the rotation failed to reopen the file */
+        open_log_file ();
+    }
+
+    if (batch->len > 0 && logfp) {
+        fwrite (batch->str, 1, batch->len, logfp);
+        fflush (logfp);
+        log_file_size += batch->len;
+        if (log_file_size > max_file_size)
+            rotate_log_file ();
+    } else if (batch->len > 0) {
+        /* better there than nowhere until the file can be opened again */
+        fwrite (batch->str, 1, batch->len, stderr);
+    }
+
+    g_atomic_int_set (&written_pos, dequeue_pos);
 
-    t = time(NULL);
-    tm = localtime(&t);
-    len = strftime (buf, 1024, "[%x %X] ", tm);
-    g_return_if_fail (len < 1024);
-    fputs (buf, logfp);
-    fputs (message, logfp);
+    return n;
+}
+
+static gpointer
+writer_thread_func (gpointer data)
+{
+    GString *batch = g_string_sized_new (64 * 1024);
 
-    if (message && strlen(message) > 0 && message[strlen(message) - 1] != '\n') {
-        fputs("\n", logfp);
+    while (!g_atomic_int_get (&stopping)) {
+        if (write_pending (batch) == 0) {
+            g_mutex_lock (wake_lock);
+            log_cond_wait_ms (wake_cond, wake_lock, LOG_FLUSH_INTERVAL_MS);
+            g_mutex_unlock (wake_lock);
+        }
     }
-    fflush (logfp);
+
+    write_pending (batch);
+    g_string_free (batch, TRUE);
+
+    return NULL;
+}
+
+void
+applet_log_flush (void)
+{
+    gint target = g_atomic_int_get (&enqueue_pos);
+    int i;
+
+    if (!writer_thread)
+        return;
+
+    /* Don't wait forever if the writer is stuck, e.g. the disk is full */
+    for (i = 0; i < 1000; i++) {
+        if ((gint)((guint)g_atomic_int_get (&written_pos) - (guint)target) >= 0)
+            return;
+        wake_writer ();
+        g_usleep (1000);
+    }
+}
+
+guint
+applet_log_dropped_count (void)
+{
+    return (guint)g_atomic_int_get (&dropped_total);
+}
+
+void
+applet_log_set_max_file_size (gint64 max_size)
+{
+    max_file_size = max_size;
+}
+
+void
+applet_log_shutdown (void)
+{
+    if (!writer_thread)
+        return;
+
+    g_atomic_int_set (&stopping, 1);
+    wake_writer ();
+    g_thread_join (writer_thread);
+    writer_thread = NULL;
+}
+
+static void
+applet_log_atexit (void)
+{
+    applet_log_shutdown ();
 }
 
 int
 applet_log_init (const char *ccnet_dir)
 {
     char *logdir = g_build_filename (ccnet_dir, "logs", NULL);
-    char *file = g_build_filename(logdir, "applet.log", NULL);
+    int i;
 
     checkdir_with_mkdir (logdir);
+    log_file = g_build_filename(logdir, "applet.log", NULL);
     g_free (logdir);
 
-    g_log_set_handler (NULL, G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL
-                       | G_LOG_FLAG_RECURSION, applet_log, NULL);
+    open_log_file ();
+    if (logfp == NULL) {
+        g_warning ("Open file %s failed errno=%d\n", log_file, errno);
+        return -1;
+    }
 
-    g_log_set_handler ("Ccnet", G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL
-                       | G_LOG_FLAG_RECURSION, applet_log, NULL);
+    slots = g_new0 (LogSlot, LOG_QUEUE_SIZE);
+    for (i = 0; i < LOG_QUEUE_SIZE; i++)
+        slots[i].seq = i;
+
+    wake_lock = log_mutex_new ();
+    wake_cond = log_cond_new ();
+    if (!categories_lock)
+        categories_lock = log_mutex_new ();
 
     /* record all log message */
-    applet_log_level = G_LOG_LEVEL_DEBUG;
+    load_levels_from_env ();
 
-    if ((logfp = (FILE *)(long)g_fopen (file, "a+")) == NULL) {
-        g_warning ("Open file %s failed errno=%d\n", file, errno);
-        g_free (file);
+#if GLIB_CHECK_VERSION(2, 32, 0)
+    writer_thread = g_thread_new ("applet-log", writer_thread_func, NULL);
+#else
+    writer_thread = g_thread_create (writer_thread_func, NULL, TRUE, NULL);
+#endif
+    if (!writer_thread) {
+        g_warning ("Failed to start log writer thread\n");
         return -1;
     }
+    atexit (applet_log_atexit);
+
+    g_log_set_handler (NULL, G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL
+                       | G_LOG_FLAG_RECURSION, applet_log, NULL);
 
-    g_free (file);
+    g_log_set_handler ("Ccnet", G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL
+                       | G_LOG_FLAG_RECURSION, applet_log, NULL);
 
     return 0;
 }
-
@@ -8,8 +8,38 @@
 
 G_BEGIN_DECLS
 
+/*
+ * Log messages are queued in a lock-free ring buffer by the calling thread
+ * and written to <ccnet_dir>/logs/applet.log in batches by a background
+ * thread. The log file is rotated when it grows larger than the max size
+ * (applet.log -> applet.log.1 -> applet.log.2 ...).
+ *
+ * Levels can be set for each category at runtime. The category of a
+ * message is its glib log domain, or for messages without a domain, the
+ * "[Name]" prefix of the message if any, e.g. "[MessageListener] connected
+ * to daemon". The SEAFILE_APPLET_LOG_LEVELS environment variable can set
+ * them at startup, e.g. "default=message,MessageListener=debug".
+ */
+
 int applet_log_init (const char *ccnet_dir);
 
+/* Set the level of a category. NULL or "default" sets the default level */
+void applet_log_set_level (const char *category, GLogLevelFlags level);
+
+/* Log files larger than this are rotated. Default is 10MB. */
+void applet_log_set_max_file_size (gint64 max_size);
+
+/* Wait until all the queued messages are written to the log file */
+void applet_log_flush (void);
+
+/* Total number of messages dropped because the queue was full, since
+ * applet_log_init. It never goes down, even though the log file only
+ * reports the drops since its previous "messages dropped" line. */
+guint applet_log_dropped_count (void);
+
+/* Stop the writer thread, after writing the queued messages */
+void applet_log_shutdown (void);
+
 G_END_DECLS
 
 #endif // SEAFILE_CLIENT_UTILS_LOG_H
@@ -0,0 +1,288 @@
+#include <algorithm>
+
+#include <QEvent>
+#include <QTimer>
+#include <QStringList>
+#include <QMetaObject>
+#include <QCoreApplication>
+
+#include "perf-stats.h"
+
+namespace {
+
+const int kRecentSamples = 256;
+
+const qint64 kHistogramBoundsUs[] = {
+    1000, 5000, 10000, 25000, 50000, 100000, 250000,
+    500000, 1000000, 2500000, 5000000, 10000000,
+};
+const int kHistogramBoundsCount = sizeof(kHistogramBoundsUs) / sizeof(kHistogramBoundsUs[0]);
+
+// The timer wakeups per second are computed over this window
+const qint64 kTimerRateWindowMSecs = 5000;
+
+bool isIdSegment(const QString& segment)
+{
+    if (segment.length() == 36 && segment.count('-') == 4) {
+        return true;
+    }
+    // 40 char commit ids
+    if (segment.length() == 40) {
+        return true;
+    }
+    return false;
+}
+
+bool isNumberSegment(const QString& segment)
+{
+    bool ok;
+    segment.toLongLong(&ok);
+    return ok;
+}
+
+qint64 percentile(const QVector<qint64>& sorted, int percent)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    int index = (sorted.size() - 1) * percent / 100;
+    return sorted[index];
+}
+
+} // namespace
+
+PerfStats* PerfStats::singleton_;
+
+PerfStats* PerfStats::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new PerfStats;
+    }
+
+    return singleton_;
+}
+
+PerfStats::PerfStats()
+    : counting_timers_(false)
+{
+    clock_.start();
+}
+
+void PerfStats::recordCall(Kind kind, const QString& name, qint64 duration_us,
+                           qint64 bytes, bool failed)
+{
+    if (kind < 0 || kind >= N_KINDS) {
+        return;
+    }
+
+    QMutexLocker lock(&mutex_);
+    CallCounter& counter = calls_[kind][name];
+
+    if (counter.recent_us.size() < kRecentSamples) {
+        counter.recent_us.append(duration_us);
+    } else {
+        counter.recent_us[counter.count % kRecentSamples] = duration_us;
+    }
+
+    if (counter.buckets.isEmpty()) {
+        counter.buckets.fill(0, kHistogramBoundsCount + 1);
+    }
+    int bucket = 0;
+    while (bucket < kHistogramBoundsCount && duration_us > kHistogramBoundsUs[bucket]) {
+        bucket++;
+    }
+    counter.buckets[bucket]++;
+
+    counter.count++;
+    counter.sum_us += duration_us;
+    counter.bytes += qMax(bytes, (qint64)0);
+    if (failed) {
+        counter.errors++;
+    }
+    counter.max_us = qMax(counter.max_us, duration_us);
+}
+
+QList<PerfStats::CallSummary> PerfStats::callSummaries(Kind kind, bool since_reset) const
+{
+    QList<CallSummary> ret;
+    if (kind < 0 || kind >= N_KINDS) {
+        return ret;
+    }
+
+    QMutexLocker lock(&mutex_);
+    QHash<QString, CallCounter>::const_iterator it;
+    for (it = calls_[kind].begin(); it != calls_[kind].end(); ++it) {
+        const CallCounter& counter = it.value();
+        if (since_reset && counter.count == counter.at_reset.count) {
+            continue;
+        }
+
+        QVector<qint64> sorted = counter.recent_us;
+        std::sort(sorted.begin(), sorted.end());
+
+        CallSummary summary;
+        summary.name = it.key();
+        summary.count = counter.count;
+        summary.errors = counter.errors;
+        summary.bytes = counter.bytes;
+        summary.p50_us = percentile(sorted, 50);
+        summary.p99_us = percentile(sorted, 99);
+        summary.max_us = counter.max_us;
+        summary.sum_us = counter.sum_us;
+        summary.buckets = counter.buckets;
+
+        if (since_reset) {
+            const CallCounter::Totals& base = counter.at_reset;
+            summary.count -= base.count;
+            summary.errors -= base.errors;
+            summary.bytes -= base.bytes;
+            summary.sum_us -= base.sum_us;
+            for (int i = 0; i < base.buckets.size() && i < summary.buckets.size(); i++) {
+                summary.buckets[i] -= base.buckets[i];
+            }
+        }
+
+        ret.append(summary);
+    }
+
+    return ret;
+}
+
+QList<PerfStats::TimerSummary> PerfStats::timerSummaries(bool since_reset) const
+{
+    QList<TimerSummary> ret;
+    qint64 now = clock_.elapsed();
+
+    QMutexLocker lock(&mutex_);
+    QHash<TimerKey, TimerCounter>::const_iterator it;
+    for (it = timers_.begin(); it != timers_.end(); ++it) {
+        const TimerCounter& counter = it.value();
+        qint64 elapsed = now - counter.window_start_ms;
+
+        TimerSummary summary;
+        summary.name = counter.name;
+        summary.wakeups = counter.wakeups;
+        if (since_reset) {
+            if (counter.wakeups == counter.wakeups_at_reset) {
+                continue;
+            }
+            summary.wakeups -= counter.wakeups_at_reset;
+        }
+        if (counter.per_second >= 0 && elapsed < 2 * kTimerRateWindowMSecs) {
+            summary.per_second = counter.per_second;
+        } else {
+            // No complete window yet, or the timer has stopped
+            summary.per_second = elapsed > 0
+                ? (counter.wakeups - counter.window_wakeups) * 1000.0 / elapsed
+                : 0;
+        }
+        ret.append(summary);
+    }
+
+    return ret;
+}
+
+void PerfStats::startCountingTimers()
+{
+    if (counting_timers_ || !QCoreApplication::instance()) {
+        return;
+    }
+
+    counting_timers_ = true;
+    // An application event filter sees the events of all the objects in
+    // the main thread
+    QCoreApplication::instance()->installEventFilter(this);
+}
+
+bool PerfStats::eventFilter(QObject *obj, QEvent *event)
+{
+    if (event->type() != QEvent::Timer) {
+        return false;
+    }
+
+    // A QTimer is counted as a timer of the object owning it, and
+    // distinguished from the others timers of that object by its interval
+    TimerKey key;
+    QTimer *timer = qobject_cast<QTimer *>(obj);
+    if (timer && timer->parent()) {
+        key = TimerKey(timer->parent()->metaObject(), timer->interval());
+    } else {
+        key = TimerKey(obj->metaObject(), timer ? timer->interval() : -1);
+    }
+
+    qint64 now = clock_.elapsed();
+
+    QMutexLocker lock(&mutex_);
+    QHash<TimerKey, TimerCounter>::iterator it = timers_.find(key);
+    if (it == timers_.end()) {
+        TimerCounter counter;
+        counter.name = QString::fromLatin1(key.first->className());
+        if (key.second >= 0) {
+            counter.name += QString(" (%1 ms)").arg(key.second);
+        }
+        counter.window_start_ms = now;
+        it = timers_.insert(key, counter);
+    }
+
+    TimerCounter& counter = it.value();
+    counter.wakeups++;
+
+    qint64 elapsed = now - counter.window_start_ms;
+    if (elapsed >= kTimerRateWindowMSecs) {
+        counter.per_second = (counter.wakeups - counter.window_wakeups) * 1000.0 / elapsed;
+        counter.window_wakeups = counter.wakeups;
+        counter.window_start_ms = now;
+    }
+
+    return false;
+}
+
+void PerfStats::reset()
+{
+    QMutexLocker lock(&mutex_);
+    for (int i = 0; i < N_KINDS; i++) {
+        QHash<QString, CallCounter>::iterator it;
+        for (it = calls_[i].begin(); it != calls_[i].end(); ++it) {
+            CallCounter& counter = it.value();
+            counter.at_reset.count = counter.count;
+            counter.at_reset.errors = counter.errors;
+            counter.at_reset.bytes = counter.bytes;
+            counter.at_reset.sum_us = counter.sum_us;
+            counter.at_reset.buckets = counter.buckets;
+            counter.max_us = 0;
+            counter.recent_us.clear();
+        }
+    }
+
+    QHash<TimerKey, TimerCounter>::iterator it;
+    for (it = timers_.begin(); it != timers_.end(); ++it) {
+        it.value().wakeups_at_reset = it.value().wakeups;
+    }
+}
+
+int PerfStats::histogramBoundsCount()
+{
+    return kHistogramBoundsCount;
+}
+
+qint64 PerfStats::histogramBoundUs(int i)
+{
+    return kHistogramBoundsUs[i];
+}
+
+QString PerfStats::endpointName(const QString& path)
+{
+    QStringList segments = path.split("/");
+    for (int i = 0; i < segments.size(); i++) {
+        const QString& segment = segments[i];
+        if (isIdSegment(segment)) {
+            segments[i] = "<id>";
+        } else if (segment.contains('@')) {
+            segments[i] = "<user>";
+        } else if (!segment.isEmpty() && isNumberSegment(segment)) {
+            segments[i] = "<n>";
+        }
+    }
+
+    return segments.join("/");
+}
@@ -0,0 +1,178 @@
+#ifndef SEAFILE_CLIENT_UTILS_PERF_STATS_H
+#define SEAFILE_CLIENT_UTILS_PERF_STATS_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+
+class QEvent;
+class QMetaObject;
+
+/**
+ * Lightweight performance counters shown in the "Performance" tab of the
+ * server status dialog: the number of calls, latency percentiles and bytes
+ * of the rpc calls, api requests and model rebuilds, and the number of
+ * timer wakeups per second.
+ *
+ * Unlike the TraceRecorder, the counters are always on. Recording a call
+ * costs a hash lookup under a mutex. The percentiles are computed from the
+ * last kRecentSamples calls of each name.
+ *
+ * reset() only resets the view of the dialog: the totals, as exported by
+ * the MetricsServer, keep counting so that they never go backwards.
+ */
+class PerfStats : public QObject {
+    Q_OBJECT
+public:
+    enum Kind {
+        RPC = 0,
+        API,
+        MODEL,
+        N_KINDS
+    };
+
+    struct CallSummary {
+        QString name;
+        quint64 count;
+        quint64 errors;
+        quint64 bytes;
+        qint64 p50_us;
+        qint64 p99_us;
+        qint64 max_us;
+        qint64 sum_us;
+        // number of calls in each latency bucket (not cumulative), the last
+        // one is for the calls slower than all the bounds
+        QVector<quint64> buckets;
+    };
+
+    struct TimerSummary {
+        QString name;
+        quint64 wakeups;
+        double per_second;
+    };
+
+    static PerfStats* instance();
+
+    /**
+     * Count a call of @name taking @duration_us. Thread safe.
+     */
+    void recordCall(Kind kind, const QString& name, qint64 duration_us,
+                    qint64 bytes=0, bool failed=false);
+
+    // Since the last reset(), or since the start if since_reset is false.
+    // The percentiles and the max are always since the last reset().
+    QList<CallSummary> callSummaries(Kind kind, bool since_reset=true) const;
+    QList<TimerSummary> timerSummaries(bool since_reset=true) const;
+
+    /**
+     * Start counting the timer events delivered in the main thread
+     */
+    void startCountingTimers();
+
+    void reset();
+
+    /**
+     * Collapse the variable parts (library ids, numbers) of an api url path,
+     * so that requests to the same endpoint are counted together, e.g.
+     * "/api2/repos/<id>/dir/".
+     */
+    static QString endpointName(const QString& path);
+
+    /**
+     * Upper bounds of the latency histogram buckets
+     */
+    static int histogramBoundsCount();
+    static qint64 histogramBoundUs(int i);
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event);
+
+private:
+    Q_DISABLE_COPY(PerfStats)
+
+    PerfStats();
+
+    struct CallCounter {
+        CallCounter() : count(0), errors(0), bytes(0), max_us(0), sum_us(0) {}
+        quint64 count;
+        quint64 errors;
+        quint64 bytes;
+        qint64 max_us;
+        qint64 sum_us;
+        QVector<quint64> buckets;
+        // ring of the durations of the most recent calls
+        QVector<qint64> recent_us;
+        // the totals at the last reset(), max_us and recent_us are cleared
+        struct Totals {
+            Totals() : count(0), errors(0), bytes(0), sum_us(0) {}
+            quint64 count;
+            quint64 errors;
+            quint64 bytes;
+            qint64 sum_us;
+            QVector<quint64> buckets;
+        } at_reset;
+    };
+
+    // (class of the object the timer belongs to, interval or -1)
+    typedef QPair<const QMetaObject*, int> TimerKey;
+
+    struct TimerCounter {
+        TimerCounter() : wakeups(0), wakeups_at_reset(0), window_wakeups(0), per_second(-1) {}
+        QString name;
+        quint64 wakeups;
+        quint64 wakeups_at_reset;
+        // wakeups at the start of the current rate window
+        quint64 window_wakeups;
+        qint64 window_start_ms;
+        double per_second;
+    };
+
+    static PerfStats *singleton_;
+
+    mutable QMutex mutex_;
+
+    QHash<QString, CallCounter> calls_[N_KINDS];
+
+    QHash<TimerKey, TimerCounter> timers_;
+    bool counting_timers_;
+
+    QElapsedTimer clock_;
+};
+
+/**
+ * Records the time between its construction and destruction as a call,
+ * unless it's disabled
+ */
+class PerfScope {
+public:
+    PerfScope(PerfStats::Kind kind, const char *name, bool enabled=true)
+        : kind_(kind),
+          name_(name),
+          enabled_(enabled) {
+        if (enabled_) {
+            timer_.start();
+        }
+    }
+
+    ~PerfScope() {
+        if (enabled_) {
+            PerfStats::instance()->recordCall(kind_, QString::fromLatin1(name_),
+                                              timer_.nsecsElapsed() / 1000);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(PerfScope)
+
+    PerfStats::Kind kind_;
+    const char *name_;
+    bool enabled_;
+    QElapsedTimer timer_;
+};
+
+#endif // SEAFILE_CLIENT_UTILS_PERF_STATS_H
@@ -0,0 +1,21 @@
+#include "probes.h"
+
+#ifdef SEAFILE_USDT_PROBES
+
+// The tracer finds the semaphores through the probe notes, and increments
+// them when it attaches to the probe.
+#define SEAFILE_DEFINE_PROBE_SEMAPHORE(name) \
+    volatile unsigned short SEAFILE_PROBE_SEMAPHORE(name) \
+        __attribute__((section(".probes"))) = 0
+
+extern "C" {
+SEAFILE_DEFINE_PROBE_SEMAPHORE(rpc__start);
+SEAFILE_DEFINE_PROBE_SEMAPHORE(rpc__done);
+SEAFILE_DEFINE_PROBE_SEMAPHORE(api__start);
+SEAFILE_DEFINE_PROBE_SEMAPHORE(api__done);
+SEAFILE_DEFINE_PROBE_SEMAPHORE(message);
+SEAFILE_DEFINE_PROBE_SEMAPHORE(paint__start);
+SEAFILE_DEFINE_PROBE_SEMAPHORE(paint__done);
+}
+
+#endif // SEAFILE_USDT_PROBES
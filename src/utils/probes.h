@@ -0,0 +1,61 @@
+#ifndef SEAFILE_CLIENT_UTILS_PROBES_H
+#define SEAFILE_CLIENT_UTILS_PROBES_H
+
+/**
+ * USDT (user-level statically defined tracing) probes, for observing a
+ * release build with bpftrace, perf or systemtap. See tools/bpftrace for
+ * examples.
+ *
+ * The probes are only compiled in when configured with
+ * -DENABLE_USDT_PROBES=ON (Linux only, needs sys/sdt.h). A probe that is
+ * compiled in but not attached costs a nop. Use SEAFILE_PROBE_ENABLED() to
+ * skip computing expensive arguments when nobody is listening: it reads the
+ * probe's semaphore, which the tracer increments when it attaches.
+ *
+ * Probes (provider "seafile_client"):
+ *
+ *   rpc__start(const char *method)
+ *   rpc__done(const char *method, long duration_us), not fired for a call
+ *     already running when the tracer attached
+ *   api__start(const char *method, const char *url)
+ *   api__done(const char *url, int status, long bytes, long duration_us)
+ *   message(const char *app, const char *type)
+ *   paint__start(int row)
+ *   paint__done(int row)
+ */
+
+#ifdef SEAFILE_USDT_PROBES
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define SEAFILE_PROBE_SEMAPHORE(name) seafile_client_##name##_semaphore
+
+extern "C" {
+extern volatile unsigned short SEAFILE_PROBE_SEMAPHORE(rpc__start);
+extern volatile unsigned short SEAFILE_PROBE_SEMAPHORE(rpc__done);
+extern volatile unsigned short SEAFILE_PROBE_SEMAPHORE(api__start);
+extern volatile unsigned short SEAFILE_PROBE_SEMAPHORE(api__done);
+extern volatile unsigned short SEAFILE_PROBE_SEMAPHORE(message);
+extern volatile unsigned short SEAFILE_PROBE_SEMAPHORE(paint__start);
+extern volatile unsigned short SEAFILE_PROBE_SEMAPHORE(paint__done);
+}
+
+#define SEAFILE_PROBE_ENABLED(name) \
+    (__builtin_expect(SEAFILE_PROBE_SEMAPHORE(name) != 0, 0))
+
+#define SEAFILE_PROBE1(name, a) STAP_PROBE1(seafile_client, name, a)
+#define SEAFILE_PROBE2(name, a, b) STAP_PROBE2(seafile_client, name, a, b)
+#define SEAFILE_PROBE4(name, a, b, c, d) STAP_PROBE4(seafile_client, name, a, b, c, d)
+
+#else
+
+#define SEAFILE_PROBE_ENABLED(name) (false)
+
+#define SEAFILE_PROBE1(name, a) do {} while (0)
+#define SEAFILE_PROBE2(name, a, b) do {} while (0)
+#define SEAFILE_PROBE4(name, a, b, c, d) do {} while (0)
+
+#endif // SEAFILE_USDT_PROBES
+
+#endif // SEAFILE_CLIENT_UTILS_PROBES_H
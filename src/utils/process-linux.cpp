@@ -109,3 +109,19 @@ int count_process(const char *process_name)
     return count;
 }
 
+long long process_resident_memory(void)
+{
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp) {
+        return -1;
+    }
+
+    long pages_total = 0, pages_resident = 0;
+    int n = fscanf(fp, "%ld %ld", &pages_total, &pages_resident);
+    fclose(fp);
+    if (n != 2) {
+        return -1;
+    }
+
+    return (long long)pages_resident * sysconf(_SC_PAGESIZE);
+}
@@ -1,6 +1,7 @@
 #include "process.h"
 
 #include <sys/sysctl.h>
+#include <mach/mach.h>
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
@@ -155,3 +156,16 @@ int count_process(const char *process_name)
     free (mylist);
     return count;
 }
+
+long long process_resident_memory(void)
+{
+    struct task_basic_info info;
+    mach_msg_type_number_t count = TASK_BASIC_INFO_COUNT;
+
+    if (task_info(mach_task_self(), TASK_BASIC_INFO,
+                  (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return -1;
+    }
+
+    return (long long)info.resident_size;
+}
@@ -139,3 +139,13 @@ int count_process (const char *process_name_in)
 
     return count;
 }
+
+long long process_resident_memory(void)
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+
+    return (long long)counters.WorkingSetSize;
+}
@@ -8,4 +8,7 @@ void shutdown_process (const char *name);
 
 int count_process(const char *name);
 
+// resident memory of the current process in bytes, or -1 on error
+long long process_resident_memory(void);
+
 #endif // SEAFILE_CLIENT_UTILS_PROCESS_H
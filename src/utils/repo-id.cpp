@@ -0,0 +1,80 @@
+#include "repo-id.h"
+
+namespace {
+
+const int kRepoIdHexDigits = 32;
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+} // namespace
+
+RepoId RepoId::fromLatin1(const char *id)
+{
+    RepoId ret;
+    if (!id) {
+        return ret;
+    }
+
+    quint64 hi = 0, lo = 0;
+    int ndigits = 0;
+
+    for (const char *p = id; *p; p++) {
+        if (*p == '-') {
+            continue;
+        }
+
+        int v = hexValue(*p);
+        if (v < 0 || ndigits >= kRepoIdHexDigits) {
+            return RepoId();
+        }
+
+        if (ndigits < kRepoIdHexDigits / 2) {
+            hi = (hi << 4) | v;
+        } else {
+            lo = (lo << 4) | v;
+        }
+        ndigits++;
+    }
+
+    if (ndigits != kRepoIdHexDigits) {
+        return RepoId();
+    }
+
+    ret.hi_ = hi;
+    ret.lo_ = lo;
+    return ret;
+}
+
+RepoId RepoId::fromString(const QString& id)
+{
+    return fromLatin1(id.toLatin1().constData());
+}
+
+QString RepoId::toString() const
+{
+    if (isNull()) {
+        return QString();
+    }
+
+    // 8-4-4-4-12
+    QString hex = QString("%1%2")
+        .arg(hi_, 16, 16, QChar('0'))
+        .arg(lo_, 16, 16, QChar('0'));
+
+    return QString("%1-%2-%3-%4-%5")
+        .arg(hex.mid(0, 8))
+        .arg(hex.mid(8, 4))
+        .arg(hex.mid(12, 4))
+        .arg(hex.mid(16, 4))
+        .arg(hex.mid(20, 12));
+}
@@ -0,0 +1,60 @@
+#ifndef SEAFILE_CLIENT_UTILS_REPO_ID_H
+#define SEAFILE_CLIENT_UTILS_REPO_ID_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QMetaType>
+
+/**
+ * Binary form of a library id. Library ids are 36-char uuids like
+ * "3c1d9a5e-8d3a-4b0c-9d2f-0a1b2c3d4e5f", which take more than 70 bytes as a
+ * QString. A RepoId packs them into 128 bits, and is cheap to compare and
+ * to hash. Use it as the key when indexing large numbers of libraries.
+ */
+class RepoId {
+public:
+    RepoId() : hi_(0), lo_(0) {}
+
+    /**
+     * Returns a null RepoId if the string is not a valid uuid
+     */
+    static RepoId fromString(const QString& id);
+    static RepoId fromLatin1(const char *id);
+
+    bool isNull() const { return hi_ == 0 && lo_ == 0; }
+
+    QString toString() const;
+
+    bool operator==(const RepoId& rhs) const {
+        return hi_ == rhs.hi_ && lo_ == rhs.lo_;
+    }
+
+    bool operator!=(const RepoId& rhs) const {
+        return !(*this == rhs);
+    }
+
+    bool operator<(const RepoId& rhs) const {
+        return hi_ < rhs.hi_ || (hi_ == rhs.hi_ && lo_ < rhs.lo_);
+    }
+
+    // accessors
+    quint64 high() const { return hi_; }
+    quint64 low() const { return lo_; }
+
+private:
+    quint64 hi_;
+    quint64 lo_;
+};
+
+inline uint qHash(const RepoId& id)
+{
+    // uuids are random enough, folding the bits together is good enough
+    quint64 h = id.high() ^ (id.low() * Q_UINT64_C(0x9E3779B97F4A7C15));
+    return uint(h ^ (h >> 32));
+}
+
+Q_DECLARE_TYPEINFO(RepoId, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(RepoId)
+
+#endif // SEAFILE_CLIENT_UTILS_REPO_ID_H
@@ -0,0 +1,67 @@
+#include <cstring>
+
+#include "string-pool.h"
+
+StringPool* StringPool::singleton_;
+
+StringPool* StringPool::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new StringPool;
+    }
+
+    return singleton_;
+}
+
+QString StringPool::intern(const char *utf8)
+{
+    if (!utf8 || *utf8 == '\0') {
+        return QString();
+    }
+
+    // fromRawData() doesn't copy, so a lookup hit costs no allocation at all
+    const QByteArray key = QByteArray::fromRawData(utf8, strlen(utf8));
+    QHash<QByteArray, QString>::const_iterator iter = pool_.constFind(key);
+    if (iter != pool_.constEnd()) {
+        return iter.value();
+    }
+
+    if (pool_.size() >= kMaxSize) {
+        pool_.clear();
+    }
+
+    QString value = QString::fromUtf8(utf8);
+    pool_.insert(QByteArray(utf8), value);
+    return value;
+}
+
+QString StringPool::intern(const QString& str)
+{
+    if (str.isEmpty()) {
+        return QString();
+    }
+
+    const QByteArray key = str.toUtf8();
+    QHash<QByteArray, QString>::const_iterator iter = pool_.constFind(key);
+    if (iter != pool_.constEnd()) {
+        return iter.value();
+    }
+
+    if (pool_.size() >= kMaxSize) {
+        pool_.clear();
+    }
+
+    pool_.insert(key, str);
+    return str;
+}
+
+qint64 StringPool::bytesUsed() const
+{
+    qint64 total = 0;
+    QHash<QByteArray, QString>::const_iterator iter;
+    for (iter = pool_.constBegin(); iter != pool_.constEnd(); ++iter) {
+        total += iter.key().size() + iter.value().size() * sizeof(QChar);
+    }
+
+    return total;
+}
@@ -0,0 +1,47 @@
+#ifndef SEAFILE_CLIENT_UTILS_STRING_POOL_H
+#define SEAFILE_CLIENT_UTILS_STRING_POOL_H
+
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+
+/**
+ * Interns strings which are repeated across many objects, e.g. the owner
+ * or the group name of the libraries returned by seahub. All the objects
+ * holding the same value then share one implicitly shared QString buffer
+ * instead of each keeping its own UTF-16 copy.
+ *
+ * The pool is only a cache, emptied once it holds kMaxSize strings so it
+ * doesn't keep growing with every account listed. The strings already
+ * handed out stay valid.
+ *
+ * The pool is not thread safe and must only be used from the main thread.
+ */
+class StringPool {
+public:
+    static const int kMaxSize = 20000;
+
+    static StringPool* instance();
+
+    QString intern(const char *utf8);
+    QString intern(const QString& str);
+
+    // accessors
+    int size() const { return pool_.size(); }
+
+    // Approximate memory held by the pooled strings, in bytes
+    qint64 bytesUsed() const;
+
+    void clear() { pool_.clear(); }
+
+private:
+    Q_DISABLE_COPY(StringPool)
+
+    StringPool() {}
+
+    static StringPool *singleton_;
+
+    QHash<QByteArray, QString> pool_;
+};
+
+#endif // SEAFILE_CLIENT_UTILS_STRING_POOL_H
@@ -0,0 +1,194 @@
+#include <QFile>
+#include <QThread>
+#include <QThreadStorage>
+#include <QCoreApplication>
+#include <QAtomicInt>
+
+#include "trace-recorder.h"
+
+namespace {
+
+// Per thread. An event is 32 bytes, so that's 1MB per thread.
+const int kEventsPerThread = 32 * 1024;
+
+struct TraceEvent {
+    const char *category;
+    const char *name;
+    qint64 start_us;
+    qint64 duration_us;
+};
+
+QByteArray jsonEscape(const char *str)
+{
+    QByteArray ret;
+    for (const char *p = str; p && *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            ret += '\\';
+            ret += *p;
+        } else if ((unsigned char)*p < 0x20) {
+            ret += ' ';
+        } else {
+            ret += *p;
+        }
+    }
+    return ret;
+}
+
+} // namespace
+
+/**
+ * Ring buffer of the events of one thread. Only the owner thread writes to
+ * it, exportToFile() reads it from another thread without locking. The
+ * events being overwritten while exporting may be garbled, which is fine
+ * for a diagnostic tool.
+ */
+class TraceEventBuffer {
+public:
+    TraceEventBuffer(int tid, const QString& thread_name)
+        : tid(tid),
+          thread_name(thread_name),
+          events(new TraceEvent[kEventsPerThread]) {}
+
+    ~TraceEventBuffer() { delete[] events; }
+
+    void append(const TraceEvent& event) {
+        int n = count;
+        events[n % kEventsPerThread] = event;
+        // publish the event
+        count.fetchAndAddRelease(1);
+    }
+
+    const int tid;
+    const QString thread_name;
+    TraceEvent *events;
+    // total number of events written, including the overwritten ones
+    QAtomicInt count;
+};
+
+namespace {
+
+// QThreadStorage deletes its data when the thread exits, but the buffer
+// must outlive the thread so its events can still be exported.
+struct TraceEventBufferRef {
+    TraceEventBuffer *buffer;
+};
+
+QThreadStorage<TraceEventBufferRef*> thread_buffers;
+
+} // namespace
+
+TraceRecorder* TraceRecorder::singleton_;
+volatile bool TraceRecorder::enabled_ = false;
+
+TraceRecorder* TraceRecorder::instance()
+{
+    if (singleton_ == NULL) {
+        singleton_ = new TraceRecorder;
+    }
+
+    return singleton_;
+}
+
+TraceRecorder::TraceRecorder()
+{
+    timer_.start();
+}
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+    enabled_ = enabled;
+}
+
+TraceEventBuffer* TraceRecorder::bufferForCurrentThread()
+{
+    if (!thread_buffers.hasLocalData()) {
+        QString name;
+        QThread *thread = QThread::currentThread();
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+            name = "main";
+        } else {
+            name = thread ? thread->objectName() : QString();
+        }
+
+        QMutexLocker lock(&buffers_mutex_);
+        if (name.isEmpty()) {
+            name = QString("thread %1").arg(buffers_.size());
+        }
+        TraceEventBufferRef *ref = new TraceEventBufferRef;
+        ref->buffer = new TraceEventBuffer(buffers_.size() + 1, name);
+        buffers_.push_back(ref->buffer);
+        thread_buffers.setLocalData(ref);
+    }
+
+    return thread_buffers.localData()->buffer;
+}
+
+void TraceRecorder::addEvent(const char *category, const char *name,
+                             qint64 start_us, qint64 duration_us)
+{
+    TraceEvent event;
+    event.category = category;
+    event.name = name;
+    event.start_us = start_us;
+    event.duration_us = duration_us;
+
+    bufferForCurrentThread()->append(event);
+}
+
+bool TraceRecorder::exportToFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("failed to open trace file %s", path.toUtf8().data());
+        return false;
+    }
+
+    QList<TraceEventBuffer*> buffers;
+    {
+        QMutexLocker lock(&buffers_mutex_);
+        buffers = buffers_;
+    }
+
+    QByteArray out;
+    out += "{\"traceEvents\":[\n";
+
+    bool first = true;
+    foreach (TraceEventBuffer *buffer, buffers) {
+        if (!first) {
+            out += ",\n";
+        }
+        first = false;
+        out += QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,"
+                       "\"args\":{\"name\":\"%2\"}}")
+            .arg(buffer->tid)
+            .arg(QString::fromUtf8(jsonEscape(buffer->thread_name.toUtf8().data())))
+            .toUtf8();
+
+        int total = buffer->count.fetchAndAddAcquire(0);
+        int start = qMax(0, total - kEventsPerThread);
+        for (int i = start; i < total; i++) {
+            const TraceEvent& event = buffer->events[i % kEventsPerThread];
+            out += ",\n{\"name\":\"";
+            out += jsonEscape(event.name);
+            out += "\",\"cat\":\"";
+            out += jsonEscape(event.category);
+            out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+            out += QByteArray::number(buffer->tid);
+            out += ",\"ts\":";
+            out += QByteArray::number(event.start_us);
+            out += ",\"dur\":";
+            out += QByteArray::number(event.duration_us);
+            out += "}";
+        }
+
+        if (out.size() > 1024 * 1024) {
+            file.write(out);
+            out.clear();
+        }
+    }
+
+    out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    file.write(out);
+
+    return file.error() == QFile::NoError;
+}
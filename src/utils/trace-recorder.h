@@ -0,0 +1,92 @@
+#ifndef SEAFILE_CLIENT_UTILS_TRACE_RECORDER_H
+#define SEAFILE_CLIENT_UTILS_TRACE_RECORDER_H
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QElapsedTimer>
+
+class TraceEventBuffer;
+
+/**
+ * Records timing spans (RPC calls, api requests, model rebuilds, painting,
+ * timers ...) and exports them in the Chrome trace event format, which can
+ * be loaded in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Recording is off by default, in which case a span only costs a check of
+ * a flag. Each thread records into its own fixed size ring buffer, so only
+ * the most recent events are kept.
+ *
+ * The category and name of a span must be string literals (or otherwise
+ * live forever), they are not copied.
+ */
+class TraceRecorder {
+public:
+    static TraceRecorder* instance();
+
+    static bool isEnabled() { return enabled_; }
+    void setEnabled(bool enabled);
+
+    // Microseconds since the recorder was created
+    qint64 now() const { return timer_.nsecsElapsed() / 1000; }
+
+    void addEvent(const char *category, const char *name,
+                  qint64 start_us, qint64 duration_us);
+
+    /**
+     * Write the recorded events of all threads to @path as JSON. Returns
+     * false on failure.
+     */
+    bool exportToFile(const QString& path);
+
+private:
+    Q_DISABLE_COPY(TraceRecorder)
+
+    TraceRecorder();
+
+    TraceEventBuffer *bufferForCurrentThread();
+
+    static TraceRecorder *singleton_;
+    static volatile bool enabled_;
+
+    QElapsedTimer timer_;
+
+    QMutex buffers_mutex_;
+    QList<TraceEventBuffer*> buffers_;
+};
+
+/**
+ * Records the time between its construction and destruction
+ */
+class TraceSpan {
+public:
+    TraceSpan(const char *category, const char *name)
+        : category_(category),
+          name_(name),
+          start_(TraceRecorder::isEnabled() ? TraceRecorder::instance()->now() : -1) {}
+
+    ~TraceSpan() {
+        if (start_ >= 0 && TraceRecorder::isEnabled()) {
+            TraceRecorder *recorder = TraceRecorder::instance();
+            recorder->addEvent(category_, name_, start_, recorder->now() - start_);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char *category_;
+    const char *name_;
+    qint64 start_;
+};
+
+#define SEAFILE_TRACE_SPAN_CONCAT2(a, b) a##b
+#define SEAFILE_TRACE_SPAN_CONCAT(a, b) SEAFILE_TRACE_SPAN_CONCAT2(a, b)
+
+/**
+ * Record the time spent in the current scope
+ */
+#define SEAFILE_TRACE_SPAN(category, name) \
+    TraceSpan SEAFILE_TRACE_SPAN_CONCAT(trace_span_, __LINE__)(category, name)
+
+#endif // SEAFILE_CLIENT_UTILS_TRACE_RECORDER_H
@@ -0,0 +1,76 @@
+#include <stdarg.h>
+#include <QtDebug>
+#include <QStringList>
+
+#include "trace.h"
+
+#ifdef SEAFILE_TRACE_ENABLED
+bool seafile_trace_enabled[TRACE_N_CATEGORIES];
+#endif
+
+namespace {
+
+const char *kTraceCategoryNames[] = {
+    "api",
+    "rpc",
+    "model",
+    "ui",
+    "message",
+};
+
+} // namespace
+
+const char *traceCategoryName(TraceCategory category)
+{
+    if (category < 0 || category >= TRACE_N_CATEGORIES) {
+        return "unknown";
+    }
+    return kTraceCategoryNames[category];
+}
+
+void traceMessage(TraceCategory category, const char *format, ...)
+{
+    char buf[1024];
+    va_list args;
+
+    va_start(args, format);
+    qvsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    qDebug("[trace:%s] %s", traceCategoryName(category), buf);
+}
+
+void setTraceCategoryEnabled(TraceCategory category, bool enabled)
+{
+#ifdef SEAFILE_TRACE_ENABLED
+    if (category >= 0 && category < TRACE_N_CATEGORIES) {
+        seafile_trace_enabled[category] = enabled;
+    }
+#else
+    Q_UNUSED(category);
+    Q_UNUSED(enabled);
+#endif
+}
+
+void setTraceCategories(const QString& spec)
+{
+    QStringList names = spec.split(",", QString::SkipEmptyParts);
+    foreach (const QString& name, names) {
+        QString n = name.trimmed().toLower();
+        for (int i = 0; i < TRACE_N_CATEGORIES; i++) {
+            if (n == "all" || n == kTraceCategoryNames[i]) {
+                setTraceCategoryEnabled((TraceCategory)i, true);
+            }
+        }
+    }
+}
+
+void initTraceFromEnv()
+{
+#ifdef SEAFILE_TRACE_ENABLED
+    QByteArray spec = qgetenv("SEAFILE_TRACE");
+    if (!spec.isEmpty()) {
+        setTraceCategories(QString::fromLatin1(spec));
+    }
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef SEAFILE_CLIENT_UTILS_TRACE_H
+#define SEAFILE_CLIENT_UTILS_TRACE_H
+
+#include <QString>
+
+/**
+ * Trace messages for hot paths.
+ *
+ * SEAFILE_TRACE(category, fmt, ...) logs a printf-style message through
+ * qDebug, prefixed with "[trace:<category>]".
+ *
+ * In Release builds (SEAFILE_TRACE_ENABLED not defined) the macro expands to
+ * nothing: the arguments are not even evaluated, so it's fine to leave
+ * calls like SEAFILE_TRACE(TRACE_API, "%s", toCStr(url.toString())) in hot
+ * code.
+ *
+ * In Debug builds all categories are disabled by default, and only cost a
+ * check of a flag. They can be enabled at runtime with
+ * setTraceCategories(), or with the SEAFILE_TRACE environment variable,
+ * e.g. SEAFILE_TRACE=api,rpc or SEAFILE_TRACE=all.
+ */
+
+enum TraceCategory {
+    TRACE_API = 0,
+    TRACE_RPC,
+    TRACE_MODEL,
+    TRACE_UI,
+    TRACE_MESSAGE,
+    TRACE_N_CATEGORIES
+};
+
+#ifdef SEAFILE_TRACE_ENABLED
+
+extern bool seafile_trace_enabled[TRACE_N_CATEGORIES];
+
+#define SEAFILE_TRACE(category, ...)                            \
+    do {                                                        \
+        if (seafile_trace_enabled[category]) {                  \
+            traceMessage(category, __VA_ARGS__);                \
+        }                                                       \
+    } while (0)
+
+#define SEAFILE_TRACE_ON(category) (seafile_trace_enabled[category])
+
+#else
+
+#define SEAFILE_TRACE(category, ...) do {} while (0)
+
+#define SEAFILE_TRACE_ON(category) (false)
+
+#endif
+
+void traceMessage(TraceCategory category, const char *format, ...)
+#if defined(Q_CC_GNU) && !defined(__INSURE__)
+    __attribute__ ((format (printf, 2, 3)))
+#endif
+    ;
+
+const char *traceCategoryName(TraceCategory category);
+
+void setTraceCategoryEnabled(TraceCategory category, bool enabled);
+
+/**
+ * Enable the categories in a comma separated list of names, "all" enables
+ * all of them. Unknown names are ignored.
+ */
+void setTraceCategories(const QString& spec);
+
+/**
+ * Read the SEAFILE_TRACE environment variable. Does nothing in Release
+ * builds.
+ */
+void initTraceFromEnv();
+
+#endif // SEAFILE_CLIENT_UTILS_TRACE_H
@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Starts seafile-applet once in the gui mode and once with --headless
+# against fake-seaf-daemon.py, and prints the startup time and resident
+# memory each mode logs once the daemon is up, as "key=value" lines, e.g.
+#
+#   mode=gui startup_ms=412 rss_kb=61240
+#   mode=headless startup_ms=95 rss_kb=23112
+#
+# usage: compare-modes.sh path/to/seafile-applet path/to/ccnet-dir [repos]
+#
+# The ccnet dir must be configured with at least one account, otherwise
+# the gui mode stops at the login dialog and the headless mode refuses to
+# start. The gui mode needs a display; without one it runs under xvfb-run.
+# The applet must be built with -DENABLE_FAKE_DAEMON=ON.
+
+set -e
+
+APPLET=${1:?usage: compare-modes.sh seafile-applet ccnet-dir [repos]}
+CCNET_DIR=${2:?usage: compare-modes.sh seafile-applet ccnet-dir [repos]}
+REPOS=${3:-1000}
+HERE=$(cd "$(dirname "$0")" && pwd)
+TMPDIR=$(mktemp -d)
+SOCKET="$TMPDIR/fake-seaf.sock"
+LOG="$CCNET_DIR/logs/applet.log"
+DAEMON_PID=
+
+cleanup() {
+    if [ -n "$DAEMON_PID" ]; then
+        kill $DAEMON_PID 2>/dev/null || true
+    fi
+    rm -rf "$TMPDIR"
+}
+trap cleanup EXIT
+
+python3 "$HERE/fake-seaf-daemon.py" --socket "$SOCKET" --repos $REPOS --seed 1 \
+    2>"$TMPDIR/daemon.log" &
+DAEMON_PID=$!
+sleep 1
+
+# run <mode> <pattern of the startup line> <command...>
+run() {
+    local mode=$1 pattern=$2 line pid
+    shift 2
+    local before=$(wc -l < "$LOG" 2>/dev/null || echo 0)
+
+    SEAFILE_FAKE_DAEMON="$SOCKET" "$@" -c "$CCNET_DIR" >/dev/null 2>&1 &
+    pid=$!
+    for i in $(seq 300); do
+        line=$(tail -n +$((before + 1)) "$LOG" 2>/dev/null | grep "$pattern" | tail -1) || true
+        if [ -n "$line" ]; then
+            break
+        fi
+        sleep 0.1
+    done
+    kill $pid 2>/dev/null || true
+    wait $pid 2>/dev/null || true
+
+    if [ -z "$line" ]; then
+        echo "mode=$mode timeout=1"
+        return
+    fi
+    # "... started ... in 412 ms, resident memory 61240 KB"
+    echo "$line" | sed -E "s/.* in ([0-9]+) ms, resident memory ([0-9]+) KB.*/mode=$mode startup_ms=\1 rss_kb=\2/"
+}
+
+if [ -n "$DISPLAY" ]; then
+    run gui "started in [0-9]* ms" "$APPLET"
+else
+    run gui "started in [0-9]* ms" xvfb-run -a "$APPLET"
+fi
+run headless "started in headless mode" "$APPLET" --headless
@@ -0,0 +1,390 @@
+#!/usr/bin/env python3
+"""
+A stand-in for ccnet and seaf-daemon, answering the rpc calls of
+seafile-applet with generated libraries, so the rpc layer and the views of
+the applet can be measured without a real daemon.
+
+Start it, then start the applet (built with -DENABLE_FAKE_DAEMON=ON) with
+SEAFILE_FAKE_DAEMON set to its socket:
+
+    ./fake-seaf-daemon.py --socket /tmp/fake-seaf.sock --repos 5000 --latency-ms 2
+    SEAFILE_FAKE_DAEMON=/tmp/fake-seaf.sock seafile-applet
+
+The applet sends the same searpc json calls as to the real daemon, framed on
+a unix socket: each message is a 4-byte big endian length followed by the
+payload, and the first message of a connection is the name of the rpc
+service ("seafile-rpcserver" or "ccnet-rpcserver").
+
+On exit (ctrl-c), and every --stats-interval seconds, it prints one line of
+"key=value" pairs per method with the number of calls and their rate.
+"""
+
+import argparse
+import json
+import os
+import random
+import signal
+import socket
+import struct
+import sys
+import threading
+import time
+
+SEAFILE_SERVICE = "seafile-rpcserver"
+CCNET_SERVICE = "ccnet-rpcserver"
+
+# Sync states reported by seafile_get_repo_sync_task, with their weights
+SYNC_STATES = [
+    ("synchronized", 80),
+    ("uploading", 5),
+    ("downloading", 5),
+    ("committing", 3),
+    ("initializing", 2),
+    ("error", 5),
+]
+
+SYNC_ERRORS = [
+    "Server has been removed",
+    "Access denied to service",
+    "Library is too large to sync",
+]
+
+
+class Stats(object):
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.calls = {}
+        self.errors = {}
+        self.start = time.time()
+
+    def count(self, method, failed):
+        with self.lock:
+            self.calls[method] = self.calls.get(method, 0) + 1
+            if failed:
+                self.errors[method] = self.errors.get(method, 0) + 1
+
+    def report(self, out=sys.stdout):
+        with self.lock:
+            elapsed = max(time.time() - self.start, 0.001)
+            total = sum(self.calls.values())
+            for method in sorted(self.calls):
+                calls = self.calls[method]
+                out.write("fake-daemon method=%s calls=%d errors=%d per_sec=%.2f\n"
+                          % (method, calls, self.errors.get(method, 0), calls / elapsed))
+            out.write("fake-daemon total calls=%d elapsed_s=%.1f per_sec=%.2f\n"
+                      % (total, elapsed, total / elapsed))
+            out.flush()
+
+
+class FakeDaemon(object):
+    def __init__(self, args):
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.lock = threading.Lock()
+        self.stats = Stats()
+        self.seafile_config = {
+            "notify_sync": "on",
+            "download_limit": "0",
+            "upload_limit": "0",
+        }
+        self.ccnet_config = {}
+        self.method_latency = {}
+        for spec in args.method_latency:
+            name, _, ms = spec.partition("=")
+            self.method_latency[name] = float(ms)
+
+        self.repos = []
+        self.repos_by_id = {}
+        for i in range(args.repos):
+            self.add_repo(i)
+
+        self.clone_tasks = []
+        for i in range(args.clone_tasks):
+            self.clone_tasks.append({
+                "state": "fetch" if i % 2 == 0 else "checkout",
+                "error_str": "",
+                "repo_id": self.repo_id(args.repos + i),
+                "peer_id": "0" * 40,
+                "repo_name": "cloning %d" % i,
+                "worktree": os.path.join(args.worktree, "cloning %d" % i),
+                "tx_id": "%08x" % i,
+            })
+
+    def repo_id(self, i):
+        return "%08x-0000-4000-8000-000000000000" % i
+
+    def add_repo(self, i):
+        name = "library %d" % i
+        repo = {
+            "id": self.repo_id(i),
+            "name": name,
+            "desc": "a library of the stand-in daemon",
+            "encrypted": i % 10 == 0,
+            "worktree": os.path.join(self.args.worktree, name),
+            "auto-sync": i % 25 != 0,
+            "last-sync-time": int(time.time()) - i * 60,
+            "worktree-invalid": False,
+        }
+        self.repos.append(repo)
+        self.repos_by_id[repo["id"]] = (i, repo)
+
+    def sync_state(self, index):
+        # The state of a library changes every --churn-seconds
+        period = int(time.time() / self.args.churn_seconds) if self.args.churn_seconds > 0 else 0
+        rng = random.Random("%d-%d-%d" % (self.args.seed, index, period))
+        total = sum(weight for _, weight in SYNC_STATES)
+        pick = rng.uniform(0, total)
+        for state, weight in SYNC_STATES:
+            pick -= weight
+            if pick <= 0:
+                break
+        error = rng.choice(SYNC_ERRORS) if state == "error" else ""
+        return state, error
+
+    def sleep_latency(self, method):
+        latency = self.method_latency.get(method, self.args.latency_ms)
+        if self.args.jitter_ms > 0:
+            with self.lock:
+                latency += self.rng.uniform(0, self.args.jitter_ms)
+        if latency > 0:
+            time.sleep(latency / 1000.0)
+
+    def should_fail(self):
+        if self.args.error_rate <= 0:
+            return False
+        with self.lock:
+            return self.rng.random() < self.args.error_rate
+
+    def call(self, service, fcall):
+        method = fcall[0]
+        params = fcall[1:]
+        self.sleep_latency(method)
+
+        if self.should_fail():
+            self.stats.count(method, True)
+            return {"err_code": 500, "err_msg": "injected failure"}
+
+        try:
+            if service == CCNET_SERVICE:
+                ret = self.call_ccnet(method, params)
+            else:
+                ret = self.call_seafile(method, params)
+        except KeyError:
+            self.stats.count(method, True)
+            return {"err_code": 500, "err_msg": "unknown function %s" % method}
+        except (IndexError, TypeError, ValueError) as e:
+            self.stats.count(method, True)
+            return {"err_code": 500, "err_msg": "bad arguments: %s" % e}
+
+        self.stats.count(method, False)
+        return {"ret": ret}
+
+    def call_ccnet(self, method, params):
+        if method == "get_config":
+            return self.ccnet_config.get(params[0])
+        elif method == "set_config":
+            self.ccnet_config[params[0]] = params[1]
+            return 0
+        elif method == "get_peers_by_role":
+            return []
+        raise KeyError(method)
+
+    def call_seafile(self, method, params):
+        if method == "seafile_get_repo_list":
+            start, limit = int(params[0] or 0), int(params[1] or -1)
+            with self.lock:
+                repos = self.repos[start:] if limit <= 0 else self.repos[start:start + limit]
+                return list(repos)
+
+        elif method == "seafile_get_repo":
+            with self.lock:
+                found = self.repos_by_id.get(params[0])
+            return found[1] if found else None
+
+        elif method == "seafile_get_repo_sync_task":
+            with self.lock:
+                found = self.repos_by_id.get(params[0])
+            if not found:
+                return None
+            state, error = self.sync_state(found[0])
+            return {"state": state, "error": error}
+
+        elif method == "seafile_find_transfer_task":
+            with self.lock:
+                found = self.repos_by_id.get(params[0])
+            if not found or self.sync_state(found[0])[0] not in ("uploading", "downloading"):
+                return None
+            return {"rate": 512 * 1024, "block_total": 1000, "block_done": found[0] % 1000}
+
+        elif method == "seafile_get_checkout_task":
+            return {"total_files": 100, "finished_files": 42}
+
+        elif method == "seafile_get_clone_tasks":
+            with self.lock:
+                return list(self.clone_tasks)
+
+        elif method in ("seafile_get_download_rate", "seafile_get_upload_rate"):
+            return self.args.rate
+
+        elif method == "seafile_get_config":
+            return self.seafile_config.get(params[0])
+
+        elif method == "seafile_get_config_int":
+            return int(self.seafile_config.get(params[0], 0))
+
+        elif method in ("seafile_set_config", "seafile_set_config_int"):
+            self.seafile_config[params[0]] = str(params[1])
+            return 0
+
+        elif method == "seafile_set_upload_rate_limit":
+            self.seafile_config["upload_limit"] = str(params[0])
+            return 0
+
+        elif method == "seafile_set_download_rate_limit":
+            self.seafile_config["download_limit"] = str(params[0])
+            return 0
+
+        elif method in ("seafile_clone", "seafile_download"):
+            repo_id, name, worktree = params[0], params[3], params[4]
+            with self.lock:
+                self.clone_tasks.append({
+                    "state": "fetch", "error_str": "", "repo_id": repo_id,
+                    "peer_id": "0" * 40, "repo_name": name,
+                    "worktree": worktree or os.path.join(self.args.worktree, name),
+                    "tx_id": "",
+                })
+            return repo_id
+
+        elif method in ("seafile_cancel_clone_task", "seafile_remove_clone_task"):
+            with self.lock:
+                self.clone_tasks = [t for t in self.clone_tasks if t["repo_id"] != params[0]]
+            return 0
+
+        elif method == "seafile_destroy_repo":
+            with self.lock:
+                found = self.repos_by_id.pop(params[0], None)
+                if found:
+                    self.repos.remove(found[1])
+            return 0
+
+        elif method in ("seafile_sync",
+                        "seafile_enable_auto_sync",
+                        "seafile_disable_auto_sync",
+                        "seafile_set_repo_property",
+                        "seafile_check_path_for_clone",
+                        "seafile_unsync_repos_by_account",
+                        "seafile_update_repos_server_host"):
+            return 0
+
+        raise KeyError(method)
+
+
+def read_exactly(conn, size):
+    data = b""
+    while len(data) < size:
+        chunk = conn.recv(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def read_message(conn):
+    header = read_exactly(conn, 4)
+    if header is None:
+        return None
+    (size,) = struct.unpack(">I", header)
+    return read_exactly(conn, size)
+
+
+def write_message(conn, payload):
+    conn.sendall(struct.pack(">I", len(payload)) + payload)
+
+
+def serve_connection(daemon, conn):
+    try:
+        service = read_message(conn)
+        if service is None:
+            return
+        service = service.decode("utf-8")
+        while True:
+            request = read_message(conn)
+            if request is None:
+                return
+            try:
+                fcall = json.loads(request.decode("utf-8"))
+                response = daemon.call(service, fcall)
+            except ValueError as e:
+                response = {"err_code": 500, "err_msg": "invalid call: %s" % e}
+            write_message(conn, json.dumps(response).encode("utf-8"))
+    except (IOError, OSError):
+        pass
+    finally:
+        conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stand-in seaf-daemon for seafile-applet")
+    parser.add_argument("--socket", default="/tmp/seafile-fake-daemon.sock",
+                        help="path of the unix socket to listen on")
+    parser.add_argument("--repos", type=int, default=100,
+                        help="number of local libraries")
+    parser.add_argument("--clone-tasks", type=int, default=0,
+                        help="number of clone tasks in progress")
+    parser.add_argument("--latency-ms", type=float, default=0,
+                        help="latency added to every call")
+    parser.add_argument("--jitter-ms", type=float, default=0,
+                        help="random latency added on top of --latency-ms")
+    parser.add_argument("--method-latency", action="append", default=[],
+                        metavar="METHOD=MS",
+                        help="latency of one method, overrides --latency-ms")
+    parser.add_argument("--error-rate", type=float, default=0,
+                        help="fraction of the calls which fail")
+    parser.add_argument("--churn-seconds", type=float, default=10,
+                        help="the sync states change every N seconds, 0 to never change")
+    parser.add_argument("--rate", type=int, default=0,
+                        help="upload/download rate reported, in bytes per second")
+    parser.add_argument("--worktree", default="/tmp/seafile-fake-worktree",
+                        help="parent directory of the libraries")
+    parser.add_argument("--seed", type=int, default=0,
+                        help="seed of the random states, latencies and failures")
+    parser.add_argument("--stats-interval", type=float, default=0,
+                        help="print the call counts every N seconds")
+    args = parser.parse_args()
+
+    daemon = FakeDaemon(args)
+
+    if os.path.exists(args.socket):
+        os.unlink(args.socket)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(args.socket)
+    server.listen(16)
+
+    def stop(signum, frame):
+        daemon.stats.report()
+        try:
+            os.unlink(args.socket)
+        except OSError:
+            pass
+        os._exit(0)
+
+    signal.signal(signal.SIGINT, stop)
+    signal.signal(signal.SIGTERM, stop)
+
+    if args.stats_interval > 0:
+        def report_loop():
+            while True:
+                time.sleep(args.stats_interval)
+                daemon.stats.report()
+        threading.Thread(target=report_loop, daemon=True).start()
+
+    sys.stderr.write("fake-seaf-daemon listening on %s with %d libraries\n"
+                     % (args.socket, args.repos))
+
+    while True:
+        conn, _ = server.accept()
+        threading.Thread(target=serve_connection, args=(daemon, conn), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
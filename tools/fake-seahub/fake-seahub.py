@@ -0,0 +1,525 @@
+#!/usr/bin/env python3
+"""
+A stand-in for the Seahub web api, serving the api2 endpoints used by
+seafile-applet from generated or recorded fixtures, with injectable faults.
+
+    ./fake-seahub.py --port 8000 --repos 10000 --latency-ms 20
+    ./fake-seahub.py --port 8443 --tls-cert cert.pem --tls-key key.pem
+
+Faults are rules matched against the path of each request, given as a json
+file with --faults, on the command line (--latency-ms, --error-rate, ...),
+or replaced at runtime by POSTing a json list to /__faults__:
+
+    [{"path": "^/api2/repos/$", "latency_ms": 200, "jitter_ms": 50},
+     {"path": "^/api2/events/", "status": 500, "rate": 0.2},
+     {"path": "^/api2/starredfiles/", "redirects": 2},
+     {"path": "^/api2/avatars/", "not_modified": true},
+     {"path": "^/api2/repos/$", "gzip": "force"},
+     {"path": "^/media/", "drop": true, "rate": 0.1}]
+
+A rule applies with probability "rate" (default 1). Every matching rule
+applies, in order. GET /__stats__ returns the number of requests, bytes and
+faults per endpoint, and POST /__reset__ clears them.
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import os
+import random
+import re
+import socket
+import ssl
+import struct
+import sys
+import threading
+import time
+import zlib
+
+try:
+    from http.server import BaseHTTPRequestHandler, HTTPServer
+    from socketserver import ThreadingMixIn
+    from urllib.parse import urlparse, parse_qs
+except ImportError:
+    sys.exit("fake-seahub needs python 3")
+
+REDIRECT_PREFIX = "/__redirect__/"
+
+
+def png_bytes(width, height, rgb):
+    """A plain colored png, without depending on PIL"""
+    def chunk(kind, data):
+        return (struct.pack(">I", len(data)) + kind + data
+                + struct.pack(">I", zlib.crc32(kind + data) & 0xffffffff))
+    row = b"\x00" + bytes(rgb) * width
+    raw = row * height
+    return (b"\x89PNG\r\n\x1a\n"
+            + chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0))
+            + chunk(b"IDAT", zlib.compress(raw))
+            + chunk(b"IEND", b""))
+
+
+class Fixtures(object):
+    """The bodies served by the endpoints, generated or loaded from a dir"""
+
+    def __init__(self, args):
+        self.args = args
+        self.repos = self.load("repos.json") or self.gen_repos(args.repos)
+        self.starred = self.load("starredfiles.json") or self.gen_starred(args.starred)
+        self.events = self.load("events.json") or self.gen_events(args.events)
+        self.commit = self.load("repo_history_changes.json") or self.gen_commit(args.commit_files)
+        self.avatar = self.load_raw("avatar.png") or png_bytes(72, 72, (0x3b, 0x82, 0xc4))
+
+    def load_raw(self, name):
+        if not self.args.fixtures:
+            return None
+        path = os.path.join(self.args.fixtures, name)
+        if not os.path.exists(path):
+            return None
+        with open(path, "rb") as f:
+            return f.read()
+
+    def load(self, name):
+        data = self.load_raw(name)
+        return json.loads(data.decode("utf-8")) if data is not None else None
+
+    @staticmethod
+    def repo_id(i):
+        return "%08x-0000-4000-8000-000000000000" % i
+
+    def gen_repos(self, n):
+        repos = []
+        for i in range(n):
+            kind = "srepo" if i % 4 == 0 else ("grepo" if i % 4 == 1 else "repo")
+            repo = {
+                "id": self.repo_id(i),
+                "name": "library %d" % i,
+                "desc": "a library of the stand-in server",
+                "mtime": 1400000000 + i,
+                "size": 1024 * i,
+                "root": "0" * 40,
+                "encrypted": i % 10 == 0,
+                "type": kind,
+                "owner": "user%d@example.com" % (i % 50),
+                "permission": "r" if i % 3 == 0 else "rw",
+                "virtual": i % 20 == 0,
+            }
+            if kind == "grepo":
+                repo["groupid"] = i % 30
+                repo["owner"] = "group %d" % (i % 30)
+            repos.append(repo)
+        return repos
+
+    def gen_starred(self, n):
+        return [{
+            "repo": self.repo_id(i % 100),
+            "repo_name": "library %d" % (i % 100),
+            "path": "/dir%d/file%d.txt" % (i % 10, i),
+            "mtime": 1400000000 + i,
+            "size": 4096,
+        } for i in range(n)]
+
+    def gen_events(self, n):
+        descs = ["Added \"report.docx\".", "Modified \"budget.xlsx\".",
+                 "Deleted \"old.txt\" and 3 more files.", "Renamed \"a.txt\" to \"b.txt\""]
+        return [{
+            "author": "user%d@example.com" % (i % 50),
+            "nick": "user %d" % (i % 50),
+            "repo_id": self.repo_id(i % 100),
+            "repo_name": "library %d" % (i % 100),
+            "commit_id": hashlib.sha1(str(i).encode()).hexdigest(),
+            "etype": "repo-update",
+            "desc": descs[i % len(descs)],
+            "time": 1400000000 - i * 60,
+        } for i in range(n)]
+
+    def gen_commit(self, n):
+        files = ["/dir%d/file%d.txt" % (i % 100, i) for i in range(n)]
+        return {
+            "added_files": files[0::3],
+            "modified_files": files[1::3],
+            "deleted_files": files[2::3],
+            "renamed_files": [],
+            "added_dirs": [],
+            "deleted_dirs": [],
+        }
+
+
+class Stats(object):
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        with self.lock:
+            self.endpoints = {}
+            self.start = time.time()
+
+    def count(self, endpoint, status, nbytes, faults):
+        with self.lock:
+            e = self.endpoints.setdefault(endpoint, {
+                "requests": 0, "bytes": 0, "statuses": {}, "faults": {}})
+            e["requests"] += 1
+            e["bytes"] += nbytes
+            e["statuses"][str(status)] = e["statuses"].get(str(status), 0) + 1
+            for fault in faults:
+                e["faults"][fault] = e["faults"].get(fault, 0) + 1
+
+    def to_json(self):
+        with self.lock:
+            return {"elapsed_s": time.time() - self.start, "endpoints": self.endpoints}
+
+
+def endpoint_name(path):
+    """/api2/repos/<id>/download-info/ and the like"""
+    path = re.sub(r"[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}", "<id>", path)
+    path = re.sub(r"/[^/]+@[^/]+/", "/<user>/", path)
+    return re.sub(r"/\d+/", "/<n>/", path)
+
+
+class FakeSeahub(object):
+    def __init__(self, args):
+        self.args = args
+        self.fixtures = Fixtures(args)
+        self.stats = Stats()
+        self.rng = random.Random(args.seed)
+        self.lock = threading.Lock()
+        self.faults = []
+        if args.faults:
+            with open(args.faults) as f:
+                self.faults = json.load(f)
+        self.faults += self.command_line_faults(args)
+        self.tls_abort_rate = args.tls_abort_rate
+
+    @staticmethod
+    def command_line_faults(args):
+        faults = []
+        if args.latency_ms or args.jitter_ms:
+            faults.append({"latency_ms": args.latency_ms, "jitter_ms": args.jitter_ms})
+        if args.error_rate:
+            faults.append({"status": args.error_status, "rate": args.error_rate})
+        if args.drop_rate:
+            faults.append({"drop": True, "rate": args.drop_rate})
+        if args.redirects:
+            faults.append({"redirects": args.redirects})
+        if args.gzip:
+            faults.append({"gzip": args.gzip})
+        return faults
+
+    def chance(self, rate):
+        with self.lock:
+            return rate >= 1 or self.rng.random() < rate
+
+    def matching_faults(self, method, path):
+        with self.lock:
+            faults = list(self.faults)
+        matched = []
+        for fault in faults:
+            if "path" in fault and not re.search(fault["path"], path):
+                continue
+            if "method" in fault and fault["method"] != method:
+                continue
+            if self.chance(fault.get("rate", 1)):
+                matched.append(fault)
+        return matched
+
+    def set_faults(self, faults):
+        with self.lock:
+            self.faults = faults
+
+    def base_url(self, handler):
+        scheme = "https" if self.args.tls_cert else "http"
+        host = handler.headers.get("Host") or "127.0.0.1:%d" % self.args.port
+        return "%s://%s" % (scheme, host)
+
+    def route(self, handler, method, path, query, form):
+        """Returns (status, content type, body)"""
+        fx = self.fixtures
+
+        if method == "POST" and path == "/api2/auth-token/":
+            if not form.get("username") or not form.get("password"):
+                return 400, "application/json", {"non_field_errors": ["Unable to login"]}
+            token = hashlib.sha1(form["username"][0].encode("utf-8")).hexdigest()
+            return 200, "application/json", {"token": token}
+
+        if method == "GET" and path in ("/api2/ping/", "/api2/auth/ping/"):
+            return 200, "application/json", "pong"
+
+        if not self.authorized(handler, path):
+            return 401, "application/json", {"detail": "Invalid token"}
+
+        if method == "GET" and path == "/api2/repos/":
+            return 200, "application/json", fx.repos
+
+        if method == "GET" and path == "/api2/starredfiles/":
+            return 200, "application/json", fx.starred
+
+        if method == "GET" and path == "/api2/events/":
+            start = int(query.get("start", ["0"])[0])
+            page = fx.events[start:start + self.args.events_page]
+            more = start + len(page) < len(fx.events)
+            body = {"events": page, "more": more}
+            if more:
+                body["more_offset"] = start + len(page)
+            return 200, "application/json", body
+
+        m = re.match(r"^/api2/repo_history_changes/([^/]+)/$", path)
+        if method == "GET" and m:
+            return 200, "application/json", fx.commit
+
+        m = re.match(r"^/api2/avatars/user/([^/]+)/resized/(\d+)/$", path)
+        if method == "GET" and m:
+            return 200, "application/json", {
+                "url": "%s/media/avatars/%s.png" % (self.base_url(handler), m.group(1)),
+                "is_default": False,
+                "mtime": 1400000000,
+            }
+
+        if method == "GET" and path.startswith("/media/avatars/"):
+            return 200, "image/png", fx.avatar
+
+        m = re.match(r"^/api2/repos/([^/]+)/download-info/$", path)
+        if method == "GET" and m:
+            return 200, "application/json", {
+                "relay_id": "0" * 40, "relay_addr": "127.0.0.1", "relay_port": "10001",
+                "email": "user@example.com", "token": "0" * 40,
+                "repo_id": m.group(1), "repo_name": "library", "repo_version": 1,
+                "encrypted": "", "magic": "", "random_key": "", "enc_version": 1,
+            }
+
+        if method == "GET" and path == "/api2/unseen_messages/":
+            return 200, "application/json", {"count": 0}
+
+        if method == "GET" and path == "/api2/default-repo/":
+            return 200, "application/json", {"exists": True, "repo_id": fx.repo_id(0)}
+
+        return 404, "application/json", {"error_msg": "not found"}
+
+    def authorized(self, handler, path):
+        if not self.args.require_token or path.startswith("/media/"):
+            return True
+        return (handler.headers.get("Authorization") or "").startswith("Token ")
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "fake-seahub"
+
+    def log_message(self, fmt, *args):
+        if self.server.seahub.args.verbose:
+            BaseHTTPRequestHandler.log_message(self, fmt, *args)
+
+    def do_GET(self):
+        self.handle_request("GET")
+
+    def do_POST(self):
+        self.handle_request("POST")
+
+    def send_body(self, status, content_type, body, extra_headers=None, faults=()):
+        seahub = self.server.seahub
+        if isinstance(body, (dict, list)) or content_type == "application/json":
+            body = json.dumps(body).encode("utf-8") if not isinstance(body, bytes) else body
+        elif isinstance(body, str):
+            body = body.encode("utf-8")
+
+        headers = dict(extra_headers or {})
+        raw_size = len(body)
+
+        if body and status == 200:
+            etag = '"%s"' % hashlib.sha1(body).hexdigest()
+            headers["ETag"] = etag
+            if self.headers.get("If-None-Match") == etag:
+                status, body = 304, b""
+
+        gzip_mode = None
+        for fault in faults:
+            gzip_mode = fault.get("gzip", gzip_mode)
+        accepts_gzip = "gzip" in (self.headers.get("Accept-Encoding") or "")
+        if body and (gzip_mode == "force" or (gzip_mode and accepts_gzip)):
+            body = gzip.compress(body)
+            headers["Content-Encoding"] = "gzip"
+
+        self.send_response(status)
+        if body or status != 304:
+            self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        for key, value in headers.items():
+            self.send_header(key, value)
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+        seahub.stats.count(endpoint_name(urlparse(self.path).path), status, len(body),
+                           [self.fault_name(f) for f in faults])
+        if seahub.args.verbose:
+            sys.stderr.write("  %d bytes (%d before compression)\n" % (len(body), raw_size))
+
+    @staticmethod
+    def fault_name(fault):
+        for key in ("drop", "status", "redirects", "not_modified", "gzip"):
+            if key in fault:
+                return key
+        return "latency"
+
+    def handle_control(self, method, path, body):
+        seahub = self.server.seahub
+        if path == "/__stats__":
+            self.send_body(200, "application/json", seahub.stats.to_json())
+        elif path == "/__reset__" and method == "POST":
+            seahub.stats.reset()
+            self.send_body(200, "application/json", {"ok": True})
+        elif path == "/__faults__" and method == "POST":
+            faults = json.loads(body or "[]")
+            seahub.set_faults(faults)
+            self.send_body(200, "application/json", {"faults": len(faults)})
+        elif path == "/__faults__":
+            self.send_body(200, "application/json", seahub.faults)
+        else:
+            self.send_body(404, "application/json", {"error_msg": "not found"})
+
+    def handle_request(self, method):
+        seahub = self.server.seahub
+        url = urlparse(self.path)
+        path = url.path
+        query = parse_qs(url.query)
+
+        body = ""
+        if method == "POST":
+            length = int(self.headers.get("Content-Length") or 0)
+            body = self.rfile.read(length).decode("utf-8") if length else ""
+        form = parse_qs(body)
+
+        if path.startswith("/__") and not path.startswith(REDIRECT_PREFIX):
+            self.handle_control(method, path, body)
+            return
+
+        # The later hops of an injected redirect chain, which ends at
+        # /__redirect__/0/<path>
+        redirected = False
+        if path.startswith(REDIRECT_PREFIX):
+            hops, _, target = path[len(REDIRECT_PREFIX):].partition("/")
+            hops = int(hops)
+            if hops > 0:
+                location = "%s%d/%s" % (REDIRECT_PREFIX, hops - 1, target)
+                if url.query:
+                    location += "?" + url.query
+                self.send_body(302, "application/json", {}, {"Location": location},
+                               [{"redirects": hops}])
+                return
+            path = "/" + target
+            redirected = True
+
+        faults = seahub.matching_faults(method, path)
+        if redirected:
+            faults = [f for f in faults if not f.get("redirects")]
+
+        delay = 0
+        for fault in faults:
+            delay += fault.get("latency_ms", 0)
+            if fault.get("jitter_ms"):
+                with seahub.lock:
+                    delay += seahub.rng.uniform(0, fault["jitter_ms"])
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+
+        for fault in faults:
+            if fault.get("drop"):
+                seahub.stats.count(endpoint_name(path), 0, 0, ["drop"])
+                self.close_connection = True
+                self.connection.shutdown(socket.SHUT_RDWR)
+                return
+            if fault.get("status"):
+                self.send_body(fault["status"], "application/json",
+                               {"error_msg": "injected failure"}, faults=faults)
+                return
+            if fault.get("redirects"):
+                hops = int(fault["redirects"])
+                location = "%s%d%s" % (REDIRECT_PREFIX, hops - 1, self.path)
+                self.send_body(302, "application/json", {}, {"Location": location}, faults)
+                return
+            if fault.get("not_modified"):
+                self.send_body(304, "application/json", b"", faults=faults)
+                return
+
+        status, content_type, body = seahub.route(self, method, path, query, form)
+        self.send_body(status, content_type, body, faults=faults)
+
+
+class Server(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, address, seahub):
+        HTTPServer.__init__(self, address, Handler)
+        self.seahub = seahub
+        self.ssl_context = None
+        if seahub.args.tls_cert:
+            self.ssl_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            self.ssl_context.load_cert_chain(seahub.args.tls_cert, seahub.args.tls_key)
+
+    def finish_request(self, request, client_address):
+        # The handshake is done in the handler thread
+        if self.ssl_context:
+            if self.seahub.tls_abort_rate and self.seahub.chance(self.seahub.tls_abort_rate):
+                self.seahub.stats.count("<tls>", 0, 0, ["tls_abort"])
+                request.close()
+                return
+            try:
+                request = self.ssl_context.wrap_socket(request, server_side=True)
+            except (ssl.SSLError, OSError) as e:
+                self.seahub.stats.count("<tls>", 0, 0, ["tls_error"])
+                if self.seahub.args.verbose:
+                    sys.stderr.write("tls handshake failed: %s\n" % e)
+                return
+        HTTPServer.finish_request(self, request, client_address)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stand-in Seahub api server")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--fixtures", help="dir with repos.json, starredfiles.json, events.json, "
+                        "repo_history_changes.json and avatar.png, instead of generated ones")
+    parser.add_argument("--repos", type=int, default=1000)
+    parser.add_argument("--starred", type=int, default=100)
+    parser.add_argument("--events", type=int, default=1000)
+    parser.add_argument("--events-page", type=int, default=25)
+    parser.add_argument("--commit-files", type=int, default=1000)
+    parser.add_argument("--require-token", action="store_true",
+                        help="answer 401 to the requests without a token")
+    parser.add_argument("--faults", help="json file with the fault rules")
+    parser.add_argument("--latency-ms", type=float, default=0)
+    parser.add_argument("--jitter-ms", type=float, default=0)
+    parser.add_argument("--error-rate", type=float, default=0)
+    parser.add_argument("--error-status", type=int, default=500)
+    parser.add_argument("--drop-rate", type=float, default=0,
+                        help="fraction of the requests whose connection is closed without a response")
+    parser.add_argument("--redirects", type=int, default=0,
+                        help="redirect every request through N hops")
+    parser.add_argument("--gzip", choices=["auto", "force"],
+                        help="gzip the bodies when the client accepts it (auto) or always (force)")
+    parser.add_argument("--tls-cert", help="serve https with this certificate")
+    parser.add_argument("--tls-key")
+    parser.add_argument("--tls-abort-rate", type=float, default=0,
+                        help="fraction of the tls handshakes aborted")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--verbose", action="store_true")
+    args = parser.parse_args()
+
+    if args.tls_cert and not args.tls_key:
+        parser.error("--tls-key is needed with --tls-cert")
+
+    seahub = FakeSeahub(args)
+    server = Server((args.host, args.port), seahub)
+    sys.stderr.write("fake-seahub serving %s://%s:%d/ (%d libraries)\n"
+                     % ("https" if args.tls_cert else "http", args.host, args.port,
+                        len(seahub.fixtures.repos)))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
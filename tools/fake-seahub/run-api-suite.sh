@@ -0,0 +1,109 @@
+#!/bin/bash
+#
+# Runs seafile-api-bench against fake-seahub.py under a set of network
+# conditions, and prints one "key=value" line per run, so the results of two
+# builds can be diffed.
+#
+# usage: run-api-suite.sh [path/to/seafile-api-bench] > results.txt
+#
+# Build the bench with cmake -DBUILD_BENCHMARKS=ON. The tls scenarios need
+# openssl to create a self-signed certificate.
+
+set -e
+
+BENCH=${1:-./seafile-api-bench}
+HERE=$(cd "$(dirname "$0")" && pwd)
+PORT=${FAKE_SEAHUB_PORT:-18080}
+COUNT=${API_SUITE_COUNT:-200}
+TMPDIR=$(mktemp -d)
+SERVER_PID=
+
+cleanup() {
+    stop_server
+    rm -rf "$TMPDIR"
+}
+trap cleanup EXIT
+
+if [ ! -x "$BENCH" ]; then
+    echo "seafile-api-bench not found at $BENCH" >&2
+    exit 1
+fi
+
+start_server() {
+    python3 "$HERE/fake-seahub.py" --port $PORT --seed 1 "$@" 2>"$TMPDIR/server.log" &
+    SERVER_PID=$!
+    for i in $(seq 50); do
+        if (exec 3<>/dev/tcp/127.0.0.1/$PORT) 2>/dev/null; then
+            return
+        fi
+        sleep 0.1
+    done
+    echo "fake-seahub didn't start:" >&2
+    cat "$TMPDIR/server.log" >&2
+    exit 1
+}
+
+stop_server() {
+    if [ -n "$SERVER_PID" ]; then
+        kill $SERVER_PID 2>/dev/null || true
+        wait $SERVER_PID 2>/dev/null || true
+        SERVER_PID=
+    fi
+}
+
+# run <scenario> <scheme> <request> <count> <concurrency>
+run() {
+    local line
+    line=$(timeout 300 "$BENCH" "$2://127.0.0.1:$PORT/" "$3" "$4" "$5" 2>/dev/null | grep '^api-bench') \
+        || line="api-bench request=$3 count=$4 concurrency=$5 timeout=1"
+    echo "scenario=$1 ${line#api-bench }"
+}
+
+# scenario <name> [fake-seahub options]: the requests of the applet
+scenario() {
+    local name=$1
+    shift
+    start_server "$@"
+    for concurrency in 1 8; do
+        run $name http repos $((COUNT / 10)) $concurrency
+        run $name http events $COUNT $concurrency
+        run $name http starred $COUNT $concurrency
+        run $name http avatar $COUNT $concurrency
+    done
+    stop_server
+}
+
+scenario baseline --repos 1000
+scenario large-repos --repos 50000
+scenario latency-50ms --repos 1000 --latency-ms 50 --jitter-ms 10
+scenario gzip --repos 50000 --gzip auto
+scenario redirects --repos 1000 --redirects 2
+scenario errors-10pct --repos 1000 --error-rate 0.1
+scenario drops-5pct --repos 1000 --drop-rate 0.05
+
+# A large commit
+start_server --commit-files 200000
+run large-commit http commit 20 1
+stop_server
+
+# 304 without a cached copy: the api layer must fail cleanly
+echo '[{"path": "^/api2/", "not_modified": true}]' > "$TMPDIR/not-modified.json"
+start_server --faults "$TMPDIR/not-modified.json"
+run not-modified http repos $COUNT 4
+stop_server
+
+if command -v openssl >/dev/null; then
+    openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=127.0.0.1 \
+        -keyout "$TMPDIR/key.pem" -out "$TMPDIR/cert.pem" 2>/dev/null
+
+    # The certificate is not trusted: every request must fail
+    start_server --repos 1000 --tls-cert "$TMPDIR/cert.pem" --tls-key "$TMPDIR/key.pem"
+    run tls-untrusted https repos 20 1
+    SEAFILE_API_BENCH_INSECURE=1 run tls https repos $((COUNT / 10)) 4
+    stop_server
+
+    start_server --repos 1000 --tls-cert "$TMPDIR/cert.pem" --tls-key "$TMPDIR/key.pem" \
+        --tls-abort-rate 0.2
+    SEAFILE_API_BENCH_INSECURE=1 run tls-aborts https repos $((COUNT / 10)) 4
+    stop_server
+fi